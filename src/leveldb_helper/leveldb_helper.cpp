@@ -62,6 +62,27 @@ void LevelIter::next()
     }
 }
 
+void LevelIter::seek(const std::string & key)
+{
+    if (nullptr == m_iter)
+    {
+        return;
+    }
+
+    m_iter->Seek(key);
+    if (!m_forward)
+    {
+        if (!m_iter->Valid())
+        {
+            m_iter->SeekToLast();
+        }
+        else if (m_iter->key().compare(key) > 0)
+        {
+            m_iter->Prev();
+        }
+    }
+}
+
 std::string LevelIter::get_key()
 {
     return good() ? m_iter->key().ToString() : "";
@@ -336,3 +357,81 @@ bool LevelDB::get(const std::string & key, double & value)
 {
     return get(key, &value, sizeof(value));
 }
+
+class LevelKVCursor : public SQLiteKVCursor
+{
+public:
+    explicit LevelKVCursor(LevelDB & db);
+
+public:
+    virtual void seek(const SQLiteView & key) override;
+    virtual bool valid() const override;
+    virtual void next() override;
+    virtual SQLiteView key() const override;
+    virtual SQLiteView value() const override;
+
+private:
+    void load();
+
+private:
+    LevelIter               m_iter;
+    bool                    m_valid;
+    std::string             m_key;
+    std::string             m_value;
+};
+
+LevelKVCursor::LevelKVCursor(LevelDB & db)
+    : m_iter(db)
+    , m_valid(false)
+    , m_key()
+    , m_value()
+{
+
+}
+
+void LevelKVCursor::seek(const SQLiteView & key)
+{
+    m_iter.seek(std::string(key.data, key.size));
+    load();
+}
+
+bool LevelKVCursor::valid() const
+{
+    return m_valid;
+}
+
+void LevelKVCursor::next()
+{
+    m_iter.next();
+    load();
+}
+
+SQLiteView LevelKVCursor::key() const
+{
+    SQLiteView view = { m_key.data(), m_key.size() };
+    return view;
+}
+
+SQLiteView LevelKVCursor::value() const
+{
+    SQLiteView view = { m_value.data(), m_value.size() };
+    return view;
+}
+
+void LevelKVCursor::load()
+{
+    m_valid = m_iter.good();
+    m_key = m_valid ? m_iter.get_key() : std::string();
+    m_value = m_valid ? m_iter.get_value() : std::string();
+}
+
+LevelKVStore::LevelKVStore(LevelDB & db)
+    : m_db(db)
+{
+
+}
+
+SQLiteKVCursor * LevelKVStore::open_cursor()
+{
+    return new LevelKVCursor(m_db);
+}
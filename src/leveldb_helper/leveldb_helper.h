@@ -13,6 +13,7 @@
 #include <cstdint>
 #include <string>
 #include "macros.h"
+#include "sqlite_kv_store.h"
 
 namespace leveldb
 {
@@ -35,6 +36,7 @@ public:
 public:
     bool good();
     void next();
+    void seek(const std::string & key); // forward: first key >= key, backward: last key <= key
     std::string get_key();
     std::string get_value();
 
@@ -105,5 +107,17 @@ private:
     std::string             m_path;
 };
 
+class GOOFER_API LevelKVStore : public SQLiteKVStore // for SQLiteDB::register_kv_table(), the db must outlive the table
+{
+public:
+    explicit LevelKVStore(LevelDB & db);
+
+public:
+    virtual SQLiteKVCursor * open_cursor() override;
+
+private:
+    LevelDB               & m_db;
+};
+
 
 #endif // LEVELDB_HELPER_H
@@ -12,13 +12,24 @@
 #else
     #include <sys/time.h>
 #endif // GOOFER_OS_IS_WIN
+#ifdef GOOFER_OS_IS_LINUX
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif // GOOFER_OS_IS_LINUX
 #include <cstring>
 #include <cstdio>
 #include <string>
 #include <list>
 #include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
 #include "base.h"
 #include "hiredis.h"
+#include "async.h"
 #include "hircluster.h"
 #include "redis_helper.h"
 
@@ -28,6 +39,106 @@
     #define strcmp_ignore_case strcasecmp
 #endif // _MSC_VER
 
+static const size_t s_pipeline_batch = 1024; // commands written before their replies are read, bounds both output and reply buffers
+static const size_t s_multi_key_batch = 1024; // keys of one mget, mset or del command
+static const size_t s_command_capacity = 8; // arguments of a single command held on the stack, longer ones fall back to the heap
+static const size_t s_async_event_count = 64; // epoll events handled per loop round
+
+static void redis_reply_to_result(const redisReply * redis_reply, RedisResult & result)
+{
+    result.integer = 0;
+    result.str.clear();
+    result.elements.clear();
+
+    switch (redis_reply->type)
+    {
+        case REDIS_REPLY_STRING:
+        case REDIS_REPLY_VERB:
+        case REDIS_REPLY_DOUBLE:
+        case REDIS_REPLY_BIGNUM:
+        {
+            result.type = RedisReplyType::string;
+            result.str.assign(redis_reply->str, redis_reply->len);
+            break;
+        }
+        case REDIS_REPLY_STATUS:
+        {
+            result.type = RedisReplyType::status;
+            result.str.assign(redis_reply->str, redis_reply->len);
+            break;
+        }
+        case REDIS_REPLY_ERROR:
+        {
+            result.type = RedisReplyType::error;
+            result.str.assign(redis_reply->str, redis_reply->len);
+            break;
+        }
+        case REDIS_REPLY_INTEGER:
+        case REDIS_REPLY_BOOL:
+        {
+            result.type = RedisReplyType::integer;
+            result.integer = static_cast<int64_t>(redis_reply->integer);
+            break;
+        }
+        case REDIS_REPLY_ARRAY:
+        case REDIS_REPLY_SET:
+        case REDIS_REPLY_MAP:
+        case REDIS_REPLY_PUSH:
+        {
+            result.type = RedisReplyType::array;
+            for (size_t index = 0; index < redis_reply->elements; ++index)
+            {
+                const redisReply * element = redis_reply->element[index];
+                if (nullptr != element && nullptr != element->str)
+                {
+                    result.elements.push_back(std::string(element->str, element->len));
+                }
+                else if (nullptr != element && REDIS_REPLY_INTEGER == element->type)
+                {
+                    result.elements.push_back(std::to_string(element->integer));
+                }
+                else
+                {
+                    result.elements.push_back(std::string());
+                }
+            }
+            break;
+        }
+        default:
+        {
+            result.type = RedisReplyType::nil;
+            break;
+        }
+    }
+}
+
+static std::string format_command(const char * const * argv, const size_t * argvlen, size_t argc)
+{
+    std::string command;
+    for (size_t index = 0; index < argc; ++index)
+    {
+        if (0 == index)
+        {
+            command.assign(argv[index], argvlen[index]);
+        }
+        else
+        {
+            command += " \"";
+            command.append(argv[index], argvlen[index]);
+            command += "\"";
+        }
+    }
+    return command;
+}
+
+RedisScanCursor::RedisScanCursor()
+    : node()
+    , position("0")
+    , done(false)
+{
+
+}
+
 RedisClient::RedisClient()
     : m_running(false)
     , m_redis_address()
@@ -213,44 +324,62 @@ void RedisClient::logoff()
     }
 }
 
-bool RedisClient::execute(const std::list<std::string> & command_line, int reply_type, void * reply_value)
+RedisClient::arg_t::arg_t(const char * arg)
+    : data(arg)
+    , size(strlen(arg))
 {
-    if (!m_running || command_line.empty() || !login())
+
+}
+
+RedisClient::arg_t::arg_t(const std::string & arg)
+    : data(arg.c_str())
+    , size(arg.size())
+{
+
+}
+
+bool RedisClient::execute(std::initializer_list<arg_t> command_line, int reply_type, void * reply_value)
+{
+    if (!m_running || 0 == command_line.size() || !login())
     {
         return false;
     }
 
-    std::string command;
-    std::vector<const char *> arg_ptr;
-    std::vector<size_t> arg_len;
-    for (std::list<std::string>::const_iterator iter = command_line.begin(); command_line.end() != iter; ++iter)
+    // the arguments are only viewed, the quoted command text is formatted when a log line needs it
+    const char * stack_ptr[s_command_capacity];
+    size_t stack_len[s_command_capacity];
+    std::vector<const char *> heap_ptr;
+    std::vector<size_t> heap_len;
+    const size_t argc = command_line.size();
+    const char ** arg_ptr = stack_ptr;
+    size_t * arg_len = stack_len;
+    if (argc > s_command_capacity)
     {
-        const std::string & arg = *iter;
-        if (command.empty())
-        {
-            command = arg;
-        }
-        else
-        {
-            command += " \"" + arg + "\"";
-        }
-        arg_ptr.push_back(arg.c_str());
-        arg_len.push_back(arg.size());
+        heap_ptr.resize(argc);
+        heap_len.resize(argc);
+        arg_ptr = &heap_ptr[0];
+        arg_len = &heap_len[0];
+    }
+    size_t index = 0;
+    for (std::initializer_list<arg_t>::const_iterator iter = command_line.begin(); command_line.end() != iter; ++iter, ++index)
+    {
+        arg_ptr[index] = iter->data;
+        arg_len[index] = iter->size;
     }
 
     redisReply * redis_reply = nullptr;
     if (nullptr != m_redis_context)
     {
-        redis_reply = reinterpret_cast<redisReply *>(redisCommandArgv(m_redis_context, static_cast<int>(command_line.size()), &arg_ptr[0], &arg_len[0]));
+        redis_reply = reinterpret_cast<redisReply *>(redisCommandArgv(m_redis_context, static_cast<int>(argc), arg_ptr, arg_len));
     }
     else
     {
-        redis_reply = reinterpret_cast<redisReply *>(redisClusterCommandArgv(m_redis_cluster_context, static_cast<int>(command_line.size()), &arg_ptr[0], &arg_len[0]));
+        redis_reply = reinterpret_cast<redisReply *>(redisClusterCommandArgv(m_redis_cluster_context, static_cast<int>(argc), arg_ptr, arg_len));
     }
 
     if (nullptr == redis_reply)
     {
-        RUN_LOG_ERR("redis client execute command [%s] failure", command.c_str());
+        RUN_LOG_ERR("redis client execute command [%s] failure", format_command(arg_ptr, arg_len, argc).c_str());
         logoff();
         return false;
     }
@@ -265,7 +394,7 @@ bool RedisClient::execute(const std::list<std::string> & command_line, int reply
             case REDIS_REPLY_STRING:
             {
                 std::string & value = *reinterpret_cast<std::string *>(reply_value);
-                value = redis_reply->str;
+                value.assign(redis_reply->str, redis_reply->len);
                 result = true;
                 break;
             }
@@ -309,17 +438,17 @@ bool RedisClient::execute(const std::list<std::string> & command_line, int reply
         {
             if (good)
             {
-                RUN_LOG_TRK("redis client execute command [%s] failure (%s)", command.c_str(), REDIS_REPLY_ERROR == redis_reply->type ? redis_reply->str : "unknown");
+                RUN_LOG_TRK("redis client execute command [%s] failure (%s)", format_command(arg_ptr, arg_len, argc).c_str(), REDIS_REPLY_ERROR == redis_reply->type ? redis_reply->str : "unknown");
             }
             else
             {
-                RUN_LOG_ERR("redis client execute command [%s] exception (%s)", command.c_str(), REDIS_REPLY_ERROR == redis_reply->type ? redis_reply->str : "unknown");
+                RUN_LOG_ERR("redis client execute command [%s] exception (%s)", format_command(arg_ptr, arg_len, argc).c_str(), REDIS_REPLY_ERROR == redis_reply->type ? redis_reply->str : "unknown");
             }
         }
     }
     else
     {
-        RUN_LOG_TRK("redis client execute command [%s] failure while unexpected reply type (%d != %d)", command.c_str(), reply_type, redis_reply->type);
+        RUN_LOG_TRK("redis client execute command [%s] failure while unexpected reply type (%d != %d)", format_command(arg_ptr, arg_len, argc).c_str(), reply_type, redis_reply->type);
     }
 
     freeReplyObject(redis_reply);
@@ -332,189 +461,610 @@ bool RedisClient::execute(const std::list<std::string> & command_line, int reply
     return result;
 }
 
-bool RedisClient::authenticate()
+bool RedisClient::execute(const std::vector<std::string> & args, const std::vector<size_t> & argcs, const std::function<bool (size_t command, const redisReply * redis_reply)> & handler)
 {
-    if (m_redis_password.empty())
+    if (!m_running || !login())
     {
-        return true;
+        return false;
     }
-    std::list<std::string> command_line;
-    command_line.push_back("auth");
-    command_line.push_back(m_redis_password);
-    return execute(command_line, REDIS_REPLY_STATUS, nullptr);
-}
 
-bool RedisClient::select_table()
-{
-    std::list<std::string> command_line;
-    command_line.push_back("select");
-    command_line.push_back(m_redis_table);
-    return execute(command_line, REDIS_REPLY_STATUS, nullptr);
-}
+    std::vector<const char *> arg_ptr(args.size());
+    std::vector<size_t> arg_len(args.size());
+    for (size_t index = 0; index < args.size(); ++index)
+    {
+        arg_ptr[index] = args[index].c_str();
+        arg_len[index] = args[index].size();
+    }
 
-bool RedisClient::flush_db()
-{
-    std::list<std::string> command_line;
-    command_line.push_back("flushdb");
-    return execute(command_line, REDIS_REPLY_STATUS, nullptr);
-}
+    bool ret = true;
+    size_t arg_index = 0;
+    size_t command_index = 0;
+    while (command_index < argcs.size())
+    {
+        const size_t batch_begin = command_index;
+        const size_t batch_end = std::min(argcs.size(), command_index + s_pipeline_batch);
 
-bool RedisClient::find(const std::string & key)
-{
-    std::list<std::string> command_line;
-    command_line.push_back("exists");
-    command_line.push_back(key);
-    return execute(command_line, REDIS_REPLY_INTEGER, nullptr);
+        for (; command_index < batch_end; ++command_index)
+        {
+            const int argc = static_cast<int>(argcs[command_index]);
+            const int append_result = (nullptr != m_redis_context)
+                ? redisAppendCommandArgv(m_redis_context, argc, &arg_ptr[arg_index], &arg_len[arg_index])
+                : redisClusterAppendCommandArgv(m_redis_cluster_context, argc, &arg_ptr[arg_index], &arg_len[arg_index]);
+            if (REDIS_OK != append_result)
+            {
+                RUN_LOG_ERR("redis client execute pipeline command (%s) failure while append command error (%s)", args[arg_index].c_str(), nullptr != m_redis_context ? m_redis_context->errstr : m_redis_cluster_context->errstr);
+                logoff();
+                return false;
+            }
+            arg_index += argcs[command_index];
+        }
+
+        // cluster pipelines do not follow MOVED or ASK, such replies come back as errors and the slot map is refreshed by the reset
+        for (size_t index = batch_begin; index < batch_end; ++index)
+        {
+            void * reply = nullptr;
+            const int reply_result = (nullptr != m_redis_context)
+                ? redisGetReply(m_redis_context, &reply)
+                : redisClusterGetReply(m_redis_cluster_context, &reply);
+            if (REDIS_OK != reply_result || nullptr == reply)
+            {
+                RUN_LOG_ERR("redis client execute pipeline failure while get reply (%u) error (%s)", static_cast<uint32_t>(index), nullptr != m_redis_context ? m_redis_context->errstr : m_redis_cluster_context->errstr);
+                if (nullptr != reply)
+                {
+                    freeReplyObject(reply);
+                }
+                logoff();
+                return false;
+            }
+            if (!handler(index, reinterpret_cast<redisReply *>(reply)))
+            {
+                ret = false;
+            }
+            freeReplyObject(reply);
+        }
+
+        if (nullptr != m_redis_cluster_context)
+        {
+            redisClusterReset(m_redis_cluster_context);
+        }
+    }
+
+    return ret;
 }
 
-bool RedisClient::find(const std::string & pattern, std::list<std::string> & keys)
+void RedisClient::group_keys(const std::vector<const std::string *> & keys, std::vector<std::vector<size_t>> & groups) const
 {
-    if (nullptr == m_redis_context && nullptr != m_redis_cluster_context)
+    groups.clear();
+
+    // a cluster takes a multi-key command only when all its keys hash to one slot
+    std::vector<std::vector<size_t>> slots;
+    if (nullptr != m_redis_cluster_context)
     {
-        RUN_LOG_ERR("redis client find pattern failure while cluster not support");
-        return false;
+        std::unordered_map<unsigned int, size_t> slot_groups;
+        for (size_t index = 0; index < keys.size(); ++index)
+        {
+            const unsigned int slot = redisClusterGetSlotByKey(const_cast<char *>(keys[index]->c_str()));
+            std::unordered_map<unsigned int, size_t>::iterator iter = slot_groups.find(slot);
+            if (slot_groups.end() == iter)
+            {
+                iter = slot_groups.insert(std::make_pair(slot, slots.size())).first;
+                slots.push_back(std::vector<size_t>());
+            }
+            slots[iter->second].push_back(index);
+        }
+    }
+    else
+    {
+        slots.push_back(std::vector<size_t>());
+        for (size_t index = 0; index < keys.size(); ++index)
+        {
+            slots[0].push_back(index);
+        }
     }
-    std::list<std::string> command_line;
-    command_line.push_back("keys");
-    command_line.push_back(pattern);
-    return execute(command_line, REDIS_REPLY_ARRAY, &keys);
-}
 
-bool RedisClient::erase(const std::string & key)
-{
-    std::list<std::string> command_line;
-    command_line.push_back("del");
-    command_line.push_back(key);
-    return execute(command_line, REDIS_REPLY_INTEGER, nullptr);
+    for (std::vector<std::vector<size_t>>::const_iterator iter = slots.begin(); slots.end() != iter; ++iter)
+    {
+        for (size_t begin = 0; begin < iter->size(); begin += s_multi_key_batch)
+        {
+            const size_t end = std::min(iter->size(), begin + s_multi_key_batch);
+            groups.push_back(std::vector<size_t>(iter->begin() + begin, iter->begin() + end));
+        }
+    }
 }
 
-bool RedisClient::erase(const std::list<std::string> & keys)
+bool RedisClient::mget(const std::list<std::string> & keys, std::list<std::string> & values, std::list<bool> * exists)
 {
-    bool result = true;
+    values.clear();
+    if (nullptr != exists)
+    {
+        exists->clear();
+    }
+
+    if (keys.empty())
+    {
+        return true;
+    }
+
+    std::vector<const std::string *> key_ptrs;
+    key_ptrs.reserve(keys.size());
     for (std::list<std::string>::const_iterator iter = keys.begin(); keys.end() != iter; ++iter)
     {
-        if (!erase(*iter))
+        key_ptrs.push_back(&*iter);
+    }
+
+    std::vector<std::vector<size_t>> groups;
+    group_keys(key_ptrs, groups);
+
+    std::vector<std::string> args;
+    std::vector<size_t> argcs;
+    args.reserve(keys.size() + groups.size());
+    argcs.reserve(groups.size());
+    for (std::vector<std::vector<size_t>>::const_iterator group = groups.begin(); groups.end() != group; ++group)
+    {
+        args.push_back("mget");
+        for (std::vector<size_t>::const_iterator index = group->begin(); group->end() != index; ++index)
         {
-            result = false;
+            args.push_back(*key_ptrs[*index]);
         }
+        argcs.push_back(group->size() + 1);
     }
-    return result;
-}
 
-bool RedisClient::persist(const std::string & key)
-{
-    std::list<std::string> command_line;
-    command_line.push_back("persist");
-    command_line.push_back(key);
-    return execute(command_line, REDIS_REPLY_INTEGER, nullptr);
-}
+    std::vector<std::string> found_values(keys.size());
+    std::vector<bool> found(keys.size(), false);
+    const bool ret = execute(args, argcs, [&groups, &found_values, &found](size_t command, const redisReply * redis_reply) -> bool {
+        const std::vector<size_t> & group = groups[command];
+        if (REDIS_REPLY_ARRAY != redis_reply->type || group.size() != redis_reply->elements)
+        {
+            RUN_LOG_ERR("redis client mget failure while unexpected reply type (%d) (%s)", redis_reply->type, REDIS_REPLY_ERROR == redis_reply->type ? redis_reply->str : "unknown");
+            return false;
+        }
+        for (size_t index = 0; index < group.size(); ++index)
+        {
+            const redisReply * element = redis_reply->element[index];
+            if (nullptr != element && REDIS_REPLY_STRING == element->type)
+            {
+                found_values[group[index]].assign(element->str, element->len);
+                found[group[index]] = true;
+            }
+        }
+        return true;
+    });
+    if (!ret)
+    {
+        return false;
+    }
 
-bool RedisClient::persist(const std::list<std::string> & keys)
-{
-    bool result = true;
-    for (std::list<std::string>::const_iterator iter = keys.begin(); keys.end() != iter; ++iter)
+    for (size_t index = 0; index < found_values.size(); ++index)
     {
-        if (!persist(*iter))
+        values.push_back(std::string());
+        values.back().swap(found_values[index]);
+        if (nullptr != exists)
         {
-            result = false;
+            exists->push_back(found[index]);
         }
     }
-    return result;
-}
 
-bool RedisClient::expire(const std::string & key, const std::string & seconds)
-{
-    std::list<std::string> command_line;
-    command_line.push_back("expire");
-    command_line.push_back(key);
-    command_line.push_back(seconds);
-    return execute(command_line, REDIS_REPLY_INTEGER, nullptr);
+    return true;
 }
 
-bool RedisClient::expire(const std::string & key, int64_t seconds)
+bool RedisClient::mset(const std::list<std::pair<std::string, std::string>> & pairs)
 {
-    return expire(key, std::to_string(seconds));
-}
+    if (pairs.empty())
+    {
+        return true;
+    }
 
-bool RedisClient::expire(const std::list<std::string> & keys, int64_t seconds)
-{
-    bool result = true;
-    std::string timeout = std::to_string(seconds);
-    for (std::list<std::string>::const_iterator iter = keys.begin(); keys.end() != iter; ++iter)
+    std::vector<const std::string *> key_ptrs;
+    std::vector<const std::string *> value_ptrs;
+    key_ptrs.reserve(pairs.size());
+    value_ptrs.reserve(pairs.size());
+    for (std::list<std::pair<std::string, std::string>>::const_iterator iter = pairs.begin(); pairs.end() != iter; ++iter)
+    {
+        key_ptrs.push_back(&iter->first);
+        value_ptrs.push_back(&iter->second);
+    }
+
+    std::vector<std::vector<size_t>> groups;
+    group_keys(key_ptrs, groups);
+
+    std::vector<std::string> args;
+    std::vector<size_t> argcs;
+    args.reserve(pairs.size() * 2 + groups.size());
+    argcs.reserve(groups.size());
+    for (std::vector<std::vector<size_t>>::const_iterator group = groups.begin(); groups.end() != group; ++group)
     {
-        if (!expire(*iter, timeout))
+        args.push_back("mset");
+        for (std::vector<size_t>::const_iterator index = group->begin(); group->end() != index; ++index)
         {
-            result = false;
+            args.push_back(*key_ptrs[*index]);
+            args.push_back(*value_ptrs[*index]);
         }
+        argcs.push_back(group->size() * 2 + 1);
     }
-    return result;
-}
 
-bool RedisClient::set(const std::string & key, const std::string & value)
-{
-    std::list<std::string> command_line;
-    command_line.push_back("set");
-    command_line.push_back(key);
-    command_line.push_back(value);
-    return execute(command_line, REDIS_REPLY_STATUS, nullptr);
+    return execute(args, argcs, [](size_t command, const redisReply * redis_reply) -> bool {
+        if (REDIS_REPLY_STATUS != redis_reply->type || 0 != strcmp_ignore_case(redis_reply->str, "ok"))
+        {
+            RUN_LOG_ERR("redis client mset failure while unexpected reply type (%d) (%s)", redis_reply->type, REDIS_REPLY_ERROR == redis_reply->type ? redis_reply->str : "unknown");
+            return false;
+        }
+        return true;
+    });
 }
 
-bool RedisClient::get(const std::string & key, std::string & value)
+bool RedisClient::mdel(const std::list<std::string> & keys, size_t * erased)
 {
-    std::list<std::string> command_line;
-    command_line.push_back("get");
-    command_line.push_back(key);
-    return execute(command_line, REDIS_REPLY_STRING, &value);
-}
+    if (nullptr != erased)
+    {
+        *erased = 0;
+    }
 
-bool RedisClient::push_back(const std::string & queue, const std::string & value)
-{
-    std::list<std::string> command_line;
-    command_line.push_back("rpush");
-    command_line.push_back(queue);
-    command_line.push_back(value);
-    return execute(command_line, REDIS_REPLY_INTEGER, nullptr);
-}
+    if (keys.empty())
+    {
+        return true;
+    }
 
-bool RedisClient::pop_front(const std::string & queue, std::string & value)
-{
-    std::list<std::string> command_line;
-    command_line.push_back("lpop");
-    command_line.push_back(queue);
-    return execute(command_line, REDIS_REPLY_STRING, &value);
-}
+    std::vector<const std::string *> key_ptrs;
+    key_ptrs.reserve(keys.size());
+    for (std::list<std::string>::const_iterator iter = keys.begin(); keys.end() != iter; ++iter)
+    {
+        key_ptrs.push_back(&*iter);
+    }
 
-bool RedisClient::set(const std::string & key, const char * value)
-{
-    return nullptr != value && set(key, std::string(value));
+    std::vector<std::vector<size_t>> groups;
+    group_keys(key_ptrs, groups);
+
+    std::vector<std::string> args;
+    std::vector<size_t> argcs;
+    args.reserve(keys.size() + groups.size());
+    argcs.reserve(groups.size());
+    for (std::vector<std::vector<size_t>>::const_iterator group = groups.begin(); groups.end() != group; ++group)
+    {
+        args.push_back("del");
+        for (std::vector<size_t>::const_iterator index = group->begin(); group->end() != index; ++index)
+        {
+            args.push_back(*key_ptrs[*index]);
+        }
+        argcs.push_back(group->size() + 1);
+    }
+
+    size_t count = 0;
+    const bool ret = execute(args, argcs, [&count](size_t command, const redisReply * redis_reply) -> bool {
+        if (REDIS_REPLY_INTEGER != redis_reply->type)
+        {
+            RUN_LOG_ERR("redis client mdel failure while unexpected reply type (%d) (%s)", redis_reply->type, REDIS_REPLY_ERROR == redis_reply->type ? redis_reply->str : "unknown");
+            return false;
+        }
+        count += static_cast<size_t>(redis_reply->integer);
+        return true;
+    });
+
+    if (nullptr != erased)
+    {
+        *erased = count;
+    }
+
+    return ret;
 }
 
-bool RedisClient::set(const std::string & key, bool value)
+bool RedisClient::authenticate()
 {
-    return set(key, std::to_string(value));
+    if (m_redis_password.empty())
+    {
+        return true;
+    }
+    return execute({ "auth", m_redis_password }, REDIS_REPLY_STATUS, nullptr);
 }
 
-bool RedisClient::set(const std::string & key, int8_t value)
+bool RedisClient::select_table()
 {
-    return set(key, std::to_string(value));
+    return execute({ "select", m_redis_table }, REDIS_REPLY_STATUS, nullptr);
 }
 
-bool RedisClient::set(const std::string & key, uint8_t value)
+bool RedisClient::flush_db()
 {
-    return set(key, std::to_string(value));
+    return execute({ "flushdb" }, REDIS_REPLY_STATUS, nullptr);
 }
 
-bool RedisClient::set(const std::string & key, int16_t value)
+bool RedisClient::find(const std::string & key)
 {
-    return set(key, std::to_string(value));
+    return execute({ "exists", key }, REDIS_REPLY_INTEGER, nullptr);
 }
 
-bool RedisClient::set(const std::string & key, uint16_t value)
+bool RedisClient::find(const std::string & pattern, std::list<std::string> & keys)
 {
-    return set(key, std::to_string(value));
+    // SCAN may return a key more than once, KEYS never did
+    std::unordered_set<std::string> found;
+    return scan(pattern, [&keys, &found](const std::list<std::string> & batch) -> bool {
+        for (std::list<std::string>::const_iterator iter = batch.begin(); batch.end() != iter; ++iter)
+        {
+            if (found.insert(*iter).second)
+            {
+                keys.push_back(*iter);
+            }
+        }
+        return true;
+    });
 }
 
-bool RedisClient::set(const std::string & key, int32_t value)
+bool RedisClient::scan(RedisScanCursor & cursor, std::list<std::string> & keys, const std::string & pattern, uint32_t count, const std::string & type)
+{
+    keys.clear();
+
+    if (cursor.done)
+    {
+        return true;
+    }
+
+    if (!m_running || !login())
+    {
+        return false;
+    }
+
+    std::vector<std::string> args;
+    args.push_back("scan");
+    args.push_back(cursor.position.empty() ? std::string("0") : cursor.position);
+    args.push_back("match");
+    args.push_back(pattern.empty() ? std::string("*") : pattern);
+    args.push_back("count");
+    args.push_back(std::to_string(0 == count ? 1 : count));
+    if (!type.empty())
+    {
+        args.push_back("type");
+        args.push_back(type);
+    }
+
+    std::string position;
+    const std::function<bool (size_t command, const redisReply * redis_reply)> handler = [&position, &keys](size_t command, const redisReply * redis_reply) -> bool {
+        if (REDIS_REPLY_ARRAY != redis_reply->type || 2 != redis_reply->elements || nullptr == redis_reply->element[0] || nullptr == redis_reply->element[0]->str || nullptr == redis_reply->element[1] || REDIS_REPLY_ARRAY != redis_reply->element[1]->type)
+        {
+            RUN_LOG_ERR("redis client scan failure while unexpected reply type (%d) (%s)", redis_reply->type, REDIS_REPLY_ERROR == redis_reply->type ? redis_reply->str : "unknown");
+            return false;
+        }
+        position.assign(redis_reply->element[0]->str, redis_reply->element[0]->len);
+        const redisReply * key_array = redis_reply->element[1];
+        for (size_t index = 0; index < key_array->elements; ++index)
+        {
+            const redisReply * key = key_array->element[index];
+            if (nullptr != key && nullptr != key->str)
+            {
+                keys.push_back(std::string(key->str, key->len));
+            }
+        }
+        return true;
+    };
+
+    if (nullptr != m_redis_context)
+    {
+        if (!execute(args, std::vector<size_t>(1, args.size()), handler))
+        {
+            return false;
+        }
+        cursor.position = position;
+        cursor.done = ("0" == position);
+        return true;
+    }
+
+    // masters are sorted by address, a cursor whose node left the cluster resumes at the next address
+    std::vector<redisClusterNode *> masters;
+    redisClusterNodeIterator node_iterator;
+    redisClusterInitNodeIterator(&node_iterator, m_redis_cluster_context);
+    for (redisClusterNode * node = redisClusterNodeNext(&node_iterator); nullptr != node; node = redisClusterNodeNext(&node_iterator))
+    {
+        if (REDIS_ROLE_MASTER == node->role && nullptr != node->addr)
+        {
+            masters.push_back(node);
+        }
+    }
+    std::sort(masters.begin(), masters.end(), [](const redisClusterNode * lhs, const redisClusterNode * rhs) {
+        return strcmp(lhs->addr, rhs->addr) < 0;
+    });
+
+    std::vector<redisClusterNode *>::const_iterator master = std::find_if(masters.begin(), masters.end(), [&cursor](const redisClusterNode * node) {
+        return cursor.node.empty() || strcmp(node->addr, cursor.node.c_str()) >= 0;
+    });
+    if (masters.end() == master)
+    {
+        cursor.done = true;
+        return true;
+    }
+    if (cursor.node != (*master)->addr)
+    {
+        cursor.node = (*master)->addr;
+        args[1] = "0";
+    }
+
+    std::vector<const char *> arg_ptr(args.size());
+    std::vector<size_t> arg_len(args.size());
+    for (size_t index = 0; index < args.size(); ++index)
+    {
+        arg_ptr[index] = args[index].c_str();
+        arg_len[index] = args[index].size();
+    }
+
+    // redisClusterCommandToNode() takes a format string, the arguments are passed as binary safe %b
+    std::string format;
+    for (size_t index = 0; index < args.size(); ++index)
+    {
+        format += (0 == index ? "%b" : " %b");
+    }
+    redisReply * redis_reply = nullptr;
+    if (6 == args.size())
+    {
+        redis_reply = reinterpret_cast<redisReply *>(redisClusterCommandToNode(m_redis_cluster_context, *master, format.c_str(), arg_ptr[0], arg_len[0], arg_ptr[1], arg_len[1], arg_ptr[2], arg_len[2], arg_ptr[3], arg_len[3], arg_ptr[4], arg_len[4], arg_ptr[5], arg_len[5]));
+    }
+    else
+    {
+        redis_reply = reinterpret_cast<redisReply *>(redisClusterCommandToNode(m_redis_cluster_context, *master, format.c_str(), arg_ptr[0], arg_len[0], arg_ptr[1], arg_len[1], arg_ptr[2], arg_len[2], arg_ptr[3], arg_len[3], arg_ptr[4], arg_len[4], arg_ptr[5], arg_len[5], arg_ptr[6], arg_len[6], arg_ptr[7], arg_len[7]));
+    }
+    if (nullptr == redis_reply)
+    {
+        RUN_LOG_ERR("redis client scan node [%s] failure (%s)", cursor.node.c_str(), m_redis_cluster_context->errstr);
+        logoff();
+        return false;
+    }
+
+    const bool ret = handler(0, redis_reply);
+    freeReplyObject(redis_reply);
+    if (!ret)
+    {
+        return false;
+    }
+
+    cursor.position = position;
+    if ("0" == position)
+    {
+        ++master;
+        cursor.node = (masters.end() != master ? std::string((*master)->addr) : std::string());
+        cursor.done = (masters.end() == master);
+    }
+
+    return true;
+}
+
+bool RedisClient::scan(const std::string & pattern, const RedisScanCallback & callback, uint32_t count, const std::string & type)
+{
+    if (!callback)
+    {
+        return false;
+    }
+
+    RedisScanCursor cursor;
+    std::list<std::string> keys;
+    while (!cursor.done)
+    {
+        if (!scan(cursor, keys, pattern, count, type))
+        {
+            return false;
+        }
+        if (!keys.empty() && !callback(keys))
+        {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool RedisClient::erase(const std::string & key)
+{
+    return execute({ "del", key }, REDIS_REPLY_INTEGER, nullptr);
+}
+
+bool RedisClient::erase(const std::list<std::string> & keys)
+{
+    size_t erased = 0;
+    return mdel(keys, &erased) && keys.size() == erased;
+}
+
+bool RedisClient::persist(const std::string & key)
+{
+    return execute({ "persist", key }, REDIS_REPLY_INTEGER, nullptr);
+}
+
+bool RedisClient::persist(const std::list<std::string> & keys)
+{
+    if (keys.empty())
+    {
+        return true;
+    }
+
+    std::vector<std::string> args;
+    std::vector<size_t> argcs(keys.size(), 2);
+    args.reserve(keys.size() * 2);
+    for (std::list<std::string>::const_iterator iter = keys.begin(); keys.end() != iter; ++iter)
+    {
+        args.push_back("persist");
+        args.push_back(*iter);
+    }
+    return execute(args, argcs, [](size_t command, const redisReply * redis_reply) -> bool {
+        return REDIS_REPLY_INTEGER == redis_reply->type && redis_reply->integer > 0;
+    });
+}
+
+bool RedisClient::expire(const std::string & key, const std::string & seconds)
+{
+    return execute({ "expire", key, seconds }, REDIS_REPLY_INTEGER, nullptr);
+}
+
+bool RedisClient::expire(const std::string & key, int64_t seconds)
+{
+    return expire(key, std::to_string(seconds));
+}
+
+bool RedisClient::expire(const std::list<std::string> & keys, int64_t seconds)
+{
+    if (keys.empty())
+    {
+        return true;
+    }
+
+    const std::string timeout = std::to_string(seconds);
+    std::vector<std::string> args;
+    std::vector<size_t> argcs(keys.size(), 3);
+    args.reserve(keys.size() * 3);
+    for (std::list<std::string>::const_iterator iter = keys.begin(); keys.end() != iter; ++iter)
+    {
+        args.push_back("expire");
+        args.push_back(*iter);
+        args.push_back(timeout);
+    }
+    return execute(args, argcs, [](size_t command, const redisReply * redis_reply) -> bool {
+        return REDIS_REPLY_INTEGER == redis_reply->type && redis_reply->integer > 0;
+    });
+}
+
+bool RedisClient::set(const std::string & key, const std::string & value)
+{
+    return execute({ "set", key, value }, REDIS_REPLY_STATUS, nullptr);
+}
+
+bool RedisClient::get(const std::string & key, std::string & value)
+{
+    return execute({ "get", key }, REDIS_REPLY_STRING, &value);
+}
+
+bool RedisClient::push_back(const std::string & queue, const std::string & value)
+{
+    return execute({ "rpush", queue, value }, REDIS_REPLY_INTEGER, nullptr);
+}
+
+bool RedisClient::pop_front(const std::string & queue, std::string & value)
+{
+    return execute({ "lpop", queue }, REDIS_REPLY_STRING, &value);
+}
+
+bool RedisClient::set(const std::string & key, const char * value)
+{
+    return nullptr != value && set(key, std::string(value));
+}
+
+bool RedisClient::set(const std::string & key, bool value)
+{
+    return set(key, std::to_string(value));
+}
+
+bool RedisClient::set(const std::string & key, int8_t value)
+{
+    return set(key, std::to_string(value));
+}
+
+bool RedisClient::set(const std::string & key, uint8_t value)
+{
+    return set(key, std::to_string(value));
+}
+
+bool RedisClient::set(const std::string & key, int16_t value)
+{
+    return set(key, std::to_string(value));
+}
+
+bool RedisClient::set(const std::string & key, uint16_t value)
+{
+    return set(key, std::to_string(value));
+}
+
+bool RedisClient::set(const std::string & key, int32_t value)
 {
     return set(key, std::to_string(value));
 }
@@ -789,3 +1339,1144 @@ bool RedisClient::clear()
 {
     return flush_db();
 }
+
+bool RedisClient::ping()
+{
+    std::vector<std::string> args(1, "ping");
+    return execute(args, std::vector<size_t>(1, 1), [](size_t command, const redisReply * redis_reply) -> bool {
+        return REDIS_REPLY_STATUS == redis_reply->type && 0 == strcmp_ignore_case(redis_reply->str, "pong");
+    });
+}
+
+RedisPipeline RedisClient::create_pipeline()
+{
+    return RedisPipeline(this);
+}
+
+RedisPipeline::RedisPipeline()
+    : m_client(nullptr)
+    , m_args()
+    , m_argcs()
+{
+
+}
+
+RedisPipeline::RedisPipeline(RedisClient * client)
+    : m_client(client)
+    , m_args()
+    , m_argcs()
+{
+
+}
+
+RedisPipeline::RedisPipeline(RedisPipeline && other)
+    : m_client(other.m_client)
+    , m_args(std::move(other.m_args))
+    , m_argcs(std::move(other.m_argcs))
+{
+    other.m_client = nullptr;
+}
+
+RedisPipeline & RedisPipeline::operator = (RedisPipeline && other)
+{
+    if (&other != this)
+    {
+        m_client = other.m_client;
+        m_args = std::move(other.m_args);
+        m_argcs = std::move(other.m_argcs);
+        other.m_client = nullptr;
+    }
+    return *this;
+}
+
+RedisPipeline::~RedisPipeline()
+{
+    clear();
+}
+
+bool RedisPipeline::good() const
+{
+    return nullptr != m_client;
+}
+
+size_t RedisPipeline::size() const
+{
+    return m_argcs.size();
+}
+
+void RedisPipeline::clear()
+{
+    m_args.clear();
+    m_argcs.clear();
+}
+
+bool RedisPipeline::append(const std::list<std::string> & command_line)
+{
+    if (nullptr == m_client || command_line.empty())
+    {
+        return false;
+    }
+    m_args.insert(m_args.end(), command_line.begin(), command_line.end());
+    m_argcs.push_back(command_line.size());
+    return true;
+}
+
+bool RedisPipeline::set(const std::string & key, const std::string & value)
+{
+    std::list<std::string> command_line;
+    command_line.push_back("set");
+    command_line.push_back(key);
+    command_line.push_back(value);
+    return append(command_line);
+}
+
+bool RedisPipeline::get(const std::string & key)
+{
+    std::list<std::string> command_line;
+    command_line.push_back("get");
+    command_line.push_back(key);
+    return append(command_line);
+}
+
+bool RedisPipeline::erase(const std::string & key)
+{
+    std::list<std::string> command_line;
+    command_line.push_back("del");
+    command_line.push_back(key);
+    return append(command_line);
+}
+
+bool RedisPipeline::expire(const std::string & key, int64_t seconds)
+{
+    std::list<std::string> command_line;
+    command_line.push_back("expire");
+    command_line.push_back(key);
+    command_line.push_back(std::to_string(seconds));
+    return append(command_line);
+}
+
+bool RedisPipeline::push_back(const std::string & queue, const std::string & value)
+{
+    std::list<std::string> command_line;
+    command_line.push_back("rpush");
+    command_line.push_back(queue);
+    command_line.push_back(value);
+    return append(command_line);
+}
+
+bool RedisPipeline::execute(std::vector<RedisResult> & results)
+{
+    results.clear();
+
+    if (nullptr == m_client)
+    {
+        return false;
+    }
+
+    if (m_argcs.empty())
+    {
+        return true;
+    }
+
+    results.resize(m_argcs.size());
+    const bool ret = m_client->execute(m_args, m_argcs, [&results](size_t command, const redisReply * redis_reply) -> bool {
+        redis_reply_to_result(redis_reply, results[command]);
+        return true;
+    });
+    if (!ret)
+    {
+        results.clear();
+    }
+    clear();
+    return ret;
+}
+
+RedisLease::RedisLease()
+    : m_pool(nullptr)
+    , m_client(nullptr)
+{
+
+}
+
+RedisLease::RedisLease(RedisPool * pool, RedisClient * client)
+    : m_pool(pool)
+    , m_client(client)
+{
+
+}
+
+RedisLease::RedisLease(RedisLease && other)
+    : m_pool(other.m_pool)
+    , m_client(other.m_client)
+{
+    other.m_pool = nullptr;
+    other.m_client = nullptr;
+}
+
+RedisLease & RedisLease::operator = (RedisLease && other)
+{
+    if (&other != this)
+    {
+        release();
+        m_pool = other.m_pool;
+        m_client = other.m_client;
+        other.m_pool = nullptr;
+        other.m_client = nullptr;
+    }
+    return *this;
+}
+
+RedisLease::~RedisLease()
+{
+    release();
+}
+
+bool RedisLease::good() const
+{
+    return nullptr != m_client;
+}
+
+void RedisLease::release()
+{
+    if (nullptr != m_pool && nullptr != m_client)
+    {
+        m_pool->release(m_client);
+    }
+    m_pool = nullptr;
+    m_client = nullptr;
+}
+
+RedisClient * RedisLease::operator -> () const
+{
+    return m_client;
+}
+
+RedisClient & RedisLease::operator * () const
+{
+    return *m_client;
+}
+
+RedisPool::RedisPool()
+    : m_mutex()
+    , m_condition()
+    , m_running(false)
+    , m_health_check_ns(0)
+    , m_clients()
+    , m_idle_clients()
+    , m_leases(0)
+    , m_stats()
+{
+
+}
+
+RedisPool::~RedisPool()
+{
+    exit();
+}
+
+bool RedisPool::init(const std::string & address, const std::string & username, const std::string & password, uint16_t table_index, uint32_t timeout_ms, size_t connection_count, uint32_t health_check_ms)
+{
+    exit();
+
+    if (0 == connection_count)
+    {
+        RUN_LOG_ERR("redis pool init failure while connection count is zero");
+        return false;
+    }
+
+    for (size_t index = 0; index < connection_count; ++index)
+    {
+        RedisClient * client = new RedisClient;
+        if (!client->init(address, username, password, table_index, timeout_ms))
+        {
+            RUN_LOG_ERR("redis pool init failure while connection (%u) to [%s] init failed", static_cast<uint32_t>(index), address.c_str());
+            delete client;
+            exit();
+            return false;
+        }
+        m_clients.push_back(client);
+    }
+
+    std::lock_guard<std::mutex> locker(m_mutex);
+    const uint64_t now_ns = get_ns_time();
+    for (std::vector<RedisClient *>::iterator iter = m_clients.begin(); m_clients.end() != iter; ++iter)
+    {
+        m_idle_clients.push_back(std::make_pair(*iter, now_ns));
+    }
+    m_health_check_ns = static_cast<uint64_t>(health_check_ms) * 1000000;
+    m_stats = RedisPoolStats();
+    m_running = true;
+
+    return true;
+}
+
+void RedisPool::exit()
+{
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        m_running = false;
+        m_condition.notify_all();
+        if (0 != m_leases)
+        {
+            RUN_LOG_WAR("redis pool exit wait for (%u) leases", static_cast<uint32_t>(m_leases));
+            m_condition.wait(locker, [this]() { return 0 == m_leases; });
+        }
+        m_idle_clients.clear();
+    }
+
+    for (std::vector<RedisClient *>::iterator iter = m_clients.begin(); m_clients.end() != iter; ++iter)
+    {
+        delete *iter;
+    }
+    m_clients.clear();
+}
+
+bool RedisPool::is_open() const
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_running;
+}
+
+size_t RedisPool::connection_count() const
+{
+    return m_clients.size();
+}
+
+RedisLease RedisPool::acquire(uint32_t timeout_ms)
+{
+    const uint64_t begin_ns = get_ns_time();
+
+    RedisClient * client = nullptr;
+    bool health_check = false;
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+
+        auto available = [this]() { return !m_running || !m_idle_clients.empty(); };
+        if (0 == timeout_ms)
+        {
+            m_condition.wait(locker, available);
+        }
+        else if (!m_condition.wait_for(locker, std::chrono::milliseconds(timeout_ms), available))
+        {
+            ++m_stats.timeouts;
+            RUN_LOG_WAR("redis pool acquire failure while wait timeout (%u ms)", timeout_ms);
+            return RedisLease();
+        }
+
+        if (!m_running)
+        {
+            return RedisLease();
+        }
+
+        // the most recently released connection is reused first, the rest may sit idle until a health check is due
+        const uint64_t now_ns = get_ns_time();
+        client = m_idle_clients.back().first;
+        health_check = 0 != m_health_check_ns && now_ns - m_idle_clients.back().second > m_health_check_ns;
+        m_idle_clients.pop_back();
+        ++m_leases;
+
+        const uint64_t wait_ns = now_ns - begin_ns;
+        ++m_stats.acquires;
+        m_stats.total_wait_ns += wait_ns;
+        m_stats.max_wait_ns = std::max(m_stats.max_wait_ns, wait_ns);
+        m_stats.health_checks += (health_check ? 1 : 0);
+    }
+
+    // a failed ping drops the connection and the next command logs in again
+    if (health_check && !client->ping())
+    {
+        const bool reconnected = client->ping();
+        std::lock_guard<std::mutex> locker(m_mutex);
+        ++m_stats.health_failures;
+        if (!reconnected)
+        {
+            RUN_LOG_WAR("redis pool acquire health check failure while reconnect failed");
+        }
+    }
+
+    return RedisLease(this, client);
+}
+
+void RedisPool::get_stats(RedisPoolStats & stats)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    stats = m_stats;
+    stats.average_wait_ns = (0 != m_stats.acquires ? m_stats.total_wait_ns / m_stats.acquires : 0);
+    stats.idle = m_idle_clients.size();
+    stats.leased = m_leases;
+}
+
+void RedisPool::release(RedisClient * client)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_idle_clients.push_back(std::make_pair(client, get_ns_time()));
+    --m_leases;
+    if (!m_running && 0 == m_leases)
+    {
+        m_condition.notify_all();
+    }
+    else
+    {
+        m_condition.notify_one();
+    }
+}
+
+class RedisAsyncClient::event_loop_t // owned by the client and its loop thread, so a loop stopped from a callback outlives the client
+{
+public:
+    event_loop_t();
+    ~event_loop_t();
+
+public:
+    struct request_t
+    {
+        std::vector<std::string>    args;
+        RedisAsyncCallback          callback;
+    };
+
+    struct event_t
+    {
+        event_loop_t              * loop;
+        redisAsyncContext         * context;
+        uint64_t                    id;
+        uint32_t                    events;
+        bool                        registered;
+        uint64_t                    deadline_ns;
+    };
+
+public:
+    void run();
+    bool connect();
+    void submit();
+    void signal_ready(bool connected);
+    static void finish(request_t * request, const redisReply * redis_reply, const char * error);
+
+public:
+    static void on_reply(redisAsyncContext * context, void * reply, void * privdata);
+    static void on_cluster_reply(redisClusterAsyncContext * context, void * reply, void * privdata);
+    static void on_setup_reply(redisAsyncContext * context, void * reply, void * privdata);
+    static void on_connect(const redisAsyncContext * context, int status);
+    static void on_disconnect(const redisAsyncContext * context, int status);
+
+public: // hiredis event adapter on top of the epoll loop
+    static int event_attach(redisAsyncContext * context, void * loop);
+    static void event_add_read(void * data);
+    static void event_del_read(void * data);
+    static void event_add_write(void * data);
+    static void event_del_write(void * data);
+    static void event_cleanup(void * data);
+    static void event_schedule_timer(void * data, struct timeval tv);
+    static void event_update(event_t * event);
+
+public:
+    std::mutex                      m_mutex;
+    std::condition_variable         m_condition;
+    bool                            m_running;
+    bool                            m_ready;
+    bool                            m_connected;
+    std::string                     m_redis_address;
+    std::string                     m_redis_username;
+    std::string                     m_redis_password;
+    std::string                     m_redis_table;
+    uint32_t                        m_redis_timeout;
+    int                             m_epoll;
+    int                             m_wakeup;
+    std::deque<request_t *>         m_requests;
+    std::unordered_map<uint64_t, event_t *> m_events;
+    uint64_t                        m_event_sequence;
+    redisAsyncContext             * m_redis_context;
+    redisClusterAsyncContext      * m_redis_cluster_context;
+};
+
+RedisAsyncClient::event_loop_t::event_loop_t()
+    : m_mutex()
+    , m_condition()
+    , m_running(false)
+    , m_ready(false)
+    , m_connected(false)
+    , m_redis_address()
+    , m_redis_username()
+    , m_redis_password()
+    , m_redis_table("0")
+    , m_redis_timeout(0)
+    , m_epoll(-1)
+    , m_wakeup(-1)
+    , m_requests()
+    , m_events()
+    , m_event_sequence(0)
+    , m_redis_context(nullptr)
+    , m_redis_cluster_context(nullptr)
+{
+
+}
+
+RedisAsyncClient::event_loop_t::~event_loop_t()
+{
+#ifdef GOOFER_OS_IS_LINUX
+    if (m_wakeup >= 0)
+    {
+        ::close(m_wakeup);
+        m_wakeup = -1;
+    }
+
+    if (m_epoll >= 0)
+    {
+        ::close(m_epoll);
+        m_epoll = -1;
+    }
+#endif // GOOFER_OS_IS_LINUX
+}
+
+RedisAsyncClient::RedisAsyncClient()
+    : m_loop()
+    , m_thread()
+{
+
+}
+
+RedisAsyncClient::~RedisAsyncClient()
+{
+    exit();
+}
+
+bool RedisAsyncClient::init(const std::string & address, const std::string & username, const std::string & password, uint16_t table_index, uint32_t timeout_ms)
+{
+    if (std::this_thread::get_id() == m_thread.get_id())
+    {
+        RUN_LOG_ERR("redis async client init failure while called from a callback on the event loop thread");
+        return false;
+    }
+
+    exit();
+
+#ifdef GOOFER_OS_IS_LINUX
+    m_loop = std::make_shared<event_loop_t>();
+    event_loop_t & loop = *m_loop;
+
+    do
+    {
+        loop.m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        if (loop.m_epoll < 0)
+        {
+            RUN_LOG_ERR("redis async client init failure while epoll_create1 error (%d)", errno);
+            break;
+        }
+
+        loop.m_wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop.m_wakeup < 0)
+        {
+            RUN_LOG_ERR("redis async client init failure while eventfd error (%d)", errno);
+            break;
+        }
+
+        struct epoll_event wakeup_event;
+        wakeup_event.events = EPOLLIN;
+        wakeup_event.data.u64 = 0;
+        if (0 != epoll_ctl(loop.m_epoll, EPOLL_CTL_ADD, loop.m_wakeup, &wakeup_event))
+        {
+            RUN_LOG_ERR("redis async client init failure while epoll_ctl error (%d)", errno);
+            break;
+        }
+
+        loop.m_running = true;
+        loop.m_redis_address = address;
+        loop.m_redis_username = username;
+        loop.m_redis_password = password;
+        loop.m_redis_table = std::to_string(table_index);
+        loop.m_redis_timeout = timeout_ms;
+
+        m_thread = std::thread(&event_loop_t::run, m_loop);
+
+        std::unique_lock<std::mutex> locker(loop.m_mutex);
+        loop.m_condition.wait(locker, [&loop]() { return loop.m_ready; });
+        if (!loop.m_connected)
+        {
+            RUN_LOG_ERR("redis async client init failure while login to redis server [%s]", address.c_str());
+            break;
+        }
+
+        return true;
+    } while (false);
+
+    exit();
+
+    return false;
+#else
+    RUN_LOG_ERR("redis async client init failure while the event loop is not supported on this platform");
+    return false;
+#endif // GOOFER_OS_IS_LINUX
+}
+
+void RedisAsyncClient::exit()
+{
+#ifdef GOOFER_OS_IS_LINUX
+    // a callback cannot join its own thread, so the thread is detached and frees the connections and fds once the callback returns
+    if (std::this_thread::get_id() == m_thread.get_id())
+    {
+        {
+            std::lock_guard<std::mutex> locker(m_loop->m_mutex);
+            m_loop->m_running = false;
+        }
+        m_thread.detach();
+        return;
+    }
+
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> locker(m_loop->m_mutex);
+            m_loop->m_running = false;
+            const uint64_t value = 1;
+            ::write(m_loop->m_wakeup, &value, sizeof(value));
+        }
+        m_thread.join();
+    }
+
+    m_loop.reset();
+#endif // GOOFER_OS_IS_LINUX
+}
+
+bool RedisAsyncClient::execute(const std::list<std::string> & command_line, const RedisAsyncCallback & callback)
+{
+    if (command_line.empty() || !callback)
+    {
+        RUN_LOG_ERR("redis async client execute failure while invalid parameters");
+        return false;
+    }
+
+    event_loop_t::request_t * request = new event_loop_t::request_t;
+    request->args.assign(command_line.begin(), command_line.end());
+    request->callback = callback;
+
+#ifdef GOOFER_OS_IS_LINUX
+    if (nullptr != m_loop)
+    {
+        event_loop_t & loop = *m_loop;
+        std::lock_guard<std::mutex> locker(loop.m_mutex);
+        if (loop.m_running)
+        {
+            // the loop drains the whole queue per wakeup, so only the first queued command has to wake it
+            loop.m_requests.push_back(request);
+            if (1 == loop.m_requests.size())
+            {
+                const uint64_t value = 1;
+                ::write(loop.m_wakeup, &value, sizeof(value));
+            }
+            return true;
+        }
+    }
+#endif // GOOFER_OS_IS_LINUX
+
+    RUN_LOG_WAR("redis async client execute failure while client is not running");
+    delete request;
+
+    return false;
+}
+
+std::future<RedisResult> RedisAsyncClient::execute(const std::list<std::string> & command_line)
+{
+    std::shared_ptr<std::promise<RedisResult>> promise = std::make_shared<std::promise<RedisResult>>();
+    std::future<RedisResult> future = promise->get_future();
+
+    if (!execute(command_line, [promise](bool success, const RedisResult & result) { promise->set_value(result); }))
+    {
+        RedisResult result;
+        result.type = RedisReplyType::error;
+        result.integer = 0;
+        result.str = "redis async client is not running";
+        promise->set_value(result);
+    }
+
+    return future;
+}
+
+void RedisAsyncClient::event_loop_t::run()
+{
+#ifdef GOOFER_OS_IS_LINUX
+    // a standalone connection is ready once its setup commands are answered
+    if (!connect() || nullptr != m_redis_cluster_context)
+    {
+        signal_ready(nullptr != m_redis_cluster_context);
+    }
+
+    struct epoll_event events[s_async_event_count];
+    std::vector<uint64_t> expired_events;
+
+    while (true)
+    {
+        int wait_ms = -1;
+        uint64_t now_ns = get_ns_time();
+        for (std::unordered_map<uint64_t, event_t *>::const_iterator iter = m_events.begin(); m_events.end() != iter; ++iter)
+        {
+            if (0 != iter->second->deadline_ns)
+            {
+                const uint64_t remain_ns = (iter->second->deadline_ns > now_ns ? iter->second->deadline_ns - now_ns : 0);
+                const int remain_ms = static_cast<int>((remain_ns + 999999) / 1000000);
+                wait_ms = (wait_ms < 0 ? remain_ms : std::min(wait_ms, remain_ms));
+            }
+        }
+
+        const int count = epoll_wait(m_epoll, events, static_cast<int>(s_async_event_count), wait_ms);
+        if (count < 0 && EINTR != errno)
+        {
+            RUN_LOG_ERR("redis async client loop failure while epoll_wait error (%d)", errno);
+            break;
+        }
+
+        for (int index = 0; index < count; ++index)
+        {
+            const uint64_t id = events[index].data.u64;
+            if (0 == id)
+            {
+                uint64_t value = 0;
+                ::read(m_wakeup, &value, sizeof(value));
+                continue;
+            }
+
+            // a handler may free any context, so the event is looked up again before each call
+            std::unordered_map<uint64_t, event_t *>::iterator iter = m_events.find(id);
+            if (m_events.end() != iter && 0 != (events[index].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+            {
+                redisAsyncHandleRead(iter->second->context);
+                iter = m_events.find(id);
+            }
+            if (m_events.end() != iter && 0 != (events[index].events & EPOLLOUT))
+            {
+                redisAsyncHandleWrite(iter->second->context);
+            }
+        }
+
+        now_ns = get_ns_time();
+        expired_events.clear();
+        for (std::unordered_map<uint64_t, event_t *>::const_iterator iter = m_events.begin(); m_events.end() != iter; ++iter)
+        {
+            if (0 != iter->second->deadline_ns && iter->second->deadline_ns <= now_ns)
+            {
+                expired_events.push_back(iter->first);
+            }
+        }
+        for (std::vector<uint64_t>::const_iterator iter = expired_events.begin(); expired_events.end() != iter; ++iter)
+        {
+            std::unordered_map<uint64_t, event_t *>::iterator event_iter = m_events.find(*iter);
+            if (m_events.end() != event_iter)
+            {
+                event_iter->second->deadline_ns = 0;
+                redisAsyncHandleTimeout(event_iter->second->context);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> locker(m_mutex);
+            if (!m_running)
+            {
+                break;
+            }
+        }
+
+        submit();
+    }
+
+    // freeing the contexts fails their pending commands, then the commands never sent are failed too
+    if (nullptr != m_redis_context)
+    {
+        redisAsyncContext * redis_context = m_redis_context;
+        m_redis_context = nullptr;
+        redisAsyncFree(redis_context);
+    }
+
+    if (nullptr != m_redis_cluster_context)
+    {
+        redisClusterAsyncContext * redis_cluster_context = m_redis_cluster_context;
+        m_redis_cluster_context = nullptr;
+        redisClusterAsyncFree(redis_cluster_context);
+    }
+
+    std::deque<request_t *> requests;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_running = false;
+        requests.swap(m_requests);
+    }
+    for (std::deque<request_t *>::iterator iter = requests.begin(); requests.end() != iter; ++iter)
+    {
+        finish(*iter, nullptr, "redis async client exit");
+    }
+
+    signal_ready(false);
+#endif // GOOFER_OS_IS_LINUX
+}
+
+bool RedisAsyncClient::event_loop_t::connect()
+{
+    if (nullptr != m_redis_context || nullptr != m_redis_cluster_context)
+    {
+        return true;
+    }
+
+    timeval redis_timeout = { m_redis_timeout / 1000, m_redis_timeout % 1000 * 1000 };
+
+    if (std::string::npos == m_redis_address.find(','))
+    {
+        std::string redis_host;
+        uint16_t redis_port = 6379;
+        std::string::size_type pos = m_redis_address.find(':');
+        if (std::string::npos == pos)
+        {
+            redis_host = m_redis_address;
+        }
+        else
+        {
+            redis_host = m_redis_address.substr(0, pos);
+            redis_port = static_cast<uint16_t>(std::stoi(m_redis_address.substr(pos + 1)));
+        }
+
+        redisOptions redis_options;
+        memset(&redis_options, 0, sizeof(redis_options));
+        REDIS_OPTIONS_SET_TCP(&redis_options, redis_host.c_str(), redis_port);
+        redis_options.connect_timeout = &redis_timeout;
+        redis_options.command_timeout = &redis_timeout;
+
+        redisAsyncContext * redis_context = redisAsyncConnectWithOptions(&redis_options);
+        if (nullptr == redis_context || 0 != redis_context->err)
+        {
+            RUN_LOG_ERR("redis async client connect redis server [%s] failure while connect error (%s)", m_redis_address.c_str(), nullptr != redis_context ? redis_context->errstr : "unknown");
+            if (nullptr != redis_context)
+            {
+                redisAsyncFree(redis_context);
+            }
+            return false;
+        }
+
+        if (REDIS_OK != event_attach(redis_context, this))
+        {
+            RUN_LOG_ERR("redis async client connect redis server [%s] failure while attach event loop", m_redis_address.c_str());
+            redisAsyncFree(redis_context);
+            return false;
+        }
+
+        redis_context->data = this;
+        redisAsyncSetConnectCallback(redis_context, &event_loop_t::on_connect);
+        redisAsyncSetDisconnectCallback(redis_context, &event_loop_t::on_disconnect);
+        m_redis_context = redis_context;
+
+        // setup commands are queued ahead of any user command on the new connection
+        if (!m_redis_password.empty())
+        {
+            std::vector<const char *> argv;
+            std::vector<size_t> argvlen;
+            argv.push_back("AUTH");
+            argvlen.push_back(4);
+            if (!m_redis_username.empty())
+            {
+                argv.push_back(m_redis_username.c_str());
+                argvlen.push_back(m_redis_username.size());
+            }
+            argv.push_back(m_redis_password.c_str());
+            argvlen.push_back(m_redis_password.size());
+            redisAsyncCommandArgv(redis_context, &event_loop_t::on_setup_reply, const_cast<char *>("AUTH"), static_cast<int>(argv.size()), &argv[0], &argvlen[0]);
+        }
+
+        const char * argv[] = { "SELECT", m_redis_table.c_str() };
+        const size_t argvlen[] = { 6, m_redis_table.size() };
+        if (REDIS_OK != redisAsyncCommandArgv(redis_context, &event_loop_t::on_setup_reply, const_cast<char *>("SELECT"), 2, argv, argvlen))
+        {
+            RUN_LOG_ERR("redis async client connect redis server [%s] failure while select table error (%s)", m_redis_address.c_str(), redis_context->errstr);
+            return false;
+        }
+
+        return true;
+    }
+
+    redisClusterAsyncContext * redis_cluster_context = redisClusterAsyncContextInit();
+    if (nullptr == redis_cluster_context)
+    {
+        RUN_LOG_ERR("redis async client connect redis server [%s] failure while init redis cluster context", m_redis_address.c_str());
+        return false;
+    }
+
+    do
+    {
+        redisClusterContext * cc = redis_cluster_context->cc;
+
+        if (REDIS_OK != redisClusterSetOptionAddNodes(cc, m_redis_address.c_str()))
+        {
+            RUN_LOG_ERR("redis async client connect redis server [%s] failure while set redis cluster option (add nodes) error (%s)", m_redis_address.c_str(), cc->errstr);
+            break;
+        }
+
+        if (!m_redis_username.empty() && REDIS_OK != redisClusterSetOptionUsername(cc, m_redis_username.c_str()))
+        {
+            RUN_LOG_ERR("redis async client connect redis server [%s] failure while set redis cluster option (username) error (%s)", m_redis_address.c_str(), cc->errstr);
+            break;
+        }
+
+        if (!m_redis_password.empty() && REDIS_OK != redisClusterSetOptionPassword(cc, m_redis_password.c_str()))
+        {
+            RUN_LOG_ERR("redis async client connect redis server [%s] failure while set redis cluster option (password) error (%s)", m_redis_address.c_str(), cc->errstr);
+            break;
+        }
+
+        if (REDIS_OK != redisClusterSetOptionConnectTimeout(cc, redis_timeout) || REDIS_OK != redisClusterSetOptionTimeout(cc, redis_timeout))
+        {
+            RUN_LOG_ERR("redis async client connect redis server [%s] failure while set redis cluster option (timeout) error (%s)", m_redis_address.c_str(), cc->errstr);
+            break;
+        }
+
+        if (REDIS_OK != redisClusterSetOptionRouteUseSlots(cc))
+        {
+            RUN_LOG_ERR("redis async client connect redis server [%s] failure while set redis cluster option (route use slots) error (%s)", m_redis_address.c_str(), cc->errstr);
+            break;
+        }
+
+        // node connections are created on demand and attached to this loop, the slot map is loaded once up front
+        redis_cluster_context->adapter = this;
+        redis_cluster_context->attach_fn = &event_loop_t::event_attach;
+
+        if (REDIS_OK != redisClusterConnect2(cc))
+        {
+            RUN_LOG_ERR("redis async client connect redis server [%s] failure while connect redis cluster error (%s)", m_redis_address.c_str(), cc->errstr);
+            break;
+        }
+
+        m_redis_cluster_context = redis_cluster_context;
+
+        return true;
+    } while (false);
+
+    redisClusterAsyncFree(redis_cluster_context);
+
+    return false;
+}
+
+void RedisAsyncClient::event_loop_t::submit()
+{
+    std::deque<request_t *> requests;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        requests.swap(m_requests);
+    }
+
+    std::vector<const char *> argv;
+    std::vector<size_t> argvlen;
+    for (std::deque<request_t *>::iterator iter = requests.begin(); requests.end() != iter; ++iter)
+    {
+        request_t * request = *iter;
+
+        // a dropped standalone connection is reopened by the next command, hiredis cluster reconnects nodes itself
+        if (!connect())
+        {
+            finish(request, nullptr, "redis async client connect failure");
+            continue;
+        }
+
+        argv.clear();
+        argvlen.clear();
+        for (std::vector<std::string>::const_iterator arg_iter = request->args.begin(); request->args.end() != arg_iter; ++arg_iter)
+        {
+            argv.push_back(arg_iter->c_str());
+            argvlen.push_back(arg_iter->size());
+        }
+
+        if (nullptr != m_redis_context)
+        {
+            if (REDIS_OK != redisAsyncCommandArgv(m_redis_context, &event_loop_t::on_reply, request, static_cast<int>(argv.size()), &argv[0], &argvlen[0]))
+            {
+                finish(request, nullptr, m_redis_context->errstr);
+            }
+        }
+        else
+        {
+            if (REDIS_OK != redisClusterAsyncCommandArgv(m_redis_cluster_context, &event_loop_t::on_cluster_reply, request, static_cast<int>(argv.size()), &argv[0], &argvlen[0]))
+            {
+                finish(request, nullptr, m_redis_cluster_context->errstr);
+            }
+        }
+    }
+}
+
+void RedisAsyncClient::event_loop_t::signal_ready(bool connected)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (!m_ready)
+    {
+        m_ready = true;
+        m_connected = connected;
+        m_condition.notify_all();
+    }
+}
+
+void RedisAsyncClient::event_loop_t::finish(request_t * request, const redisReply * redis_reply, const char * error)
+{
+    RedisResult result;
+    if (nullptr != redis_reply)
+    {
+        redis_reply_to_result(redis_reply, result);
+    }
+    else
+    {
+        result.type = RedisReplyType::error;
+        result.integer = 0;
+        result.str = (nullptr != error && '\0' != error[0] ? error : "no reply");
+    }
+
+    request->callback(nullptr != redis_reply, result);
+    delete request;
+}
+
+void RedisAsyncClient::event_loop_t::on_reply(redisAsyncContext * context, void * reply, void * privdata)
+{
+    finish(reinterpret_cast<request_t *>(privdata), reinterpret_cast<redisReply *>(reply), context->errstr);
+}
+
+void RedisAsyncClient::event_loop_t::on_cluster_reply(redisClusterAsyncContext * context, void * reply, void * privdata)
+{
+    finish(reinterpret_cast<request_t *>(privdata), reinterpret_cast<redisReply *>(reply), context->errstr);
+}
+
+void RedisAsyncClient::event_loop_t::on_setup_reply(redisAsyncContext * context, void * reply, void * privdata)
+{
+    event_loop_t * loop = reinterpret_cast<event_loop_t *>(context->data);
+    const redisReply * redis_reply = reinterpret_cast<redisReply *>(reply);
+    const char * command = reinterpret_cast<const char *>(privdata);
+
+    if (nullptr == redis_reply || REDIS_REPLY_ERROR == redis_reply->type)
+    {
+        RUN_LOG_ERR("redis async client setup command (%s) failure while error (%s)", command, nullptr != redis_reply ? redis_reply->str : context->errstr);
+        loop->signal_ready(false);
+        if (nullptr != redis_reply)
+        {
+            redisAsyncDisconnect(context);
+        }
+        return;
+    }
+
+    if (0 == strcmp(command, "SELECT"))
+    {
+        loop->signal_ready(true);
+    }
+}
+
+void RedisAsyncClient::event_loop_t::on_connect(const redisAsyncContext * context, int status)
+{
+    if (REDIS_OK != status)
+    {
+        event_loop_t * loop = reinterpret_cast<event_loop_t *>(context->data);
+        RUN_LOG_ERR("redis async client connect redis server [%s] failure while error (%s)", loop->m_redis_address.c_str(), context->errstr);
+        loop->m_redis_context = nullptr;
+    }
+}
+
+void RedisAsyncClient::event_loop_t::on_disconnect(const redisAsyncContext * context, int status)
+{
+    event_loop_t * loop = reinterpret_cast<event_loop_t *>(context->data);
+    if (REDIS_OK != status)
+    {
+        RUN_LOG_WAR("redis async client disconnect redis server [%s] while error (%s)", loop->m_redis_address.c_str(), context->errstr);
+    }
+    loop->m_redis_context = nullptr;
+}
+
+int RedisAsyncClient::event_loop_t::event_attach(redisAsyncContext * context, void * loop)
+{
+    if (nullptr != context->ev.data)
+    {
+        return REDIS_ERR;
+    }
+
+    event_loop_t * event_loop = reinterpret_cast<event_loop_t *>(loop);
+    event_t * event = new event_t;
+    event->loop = event_loop;
+    event->context = context;
+    event->id = ++event_loop->m_event_sequence;
+    event->events = 0;
+    event->registered = false;
+    event->deadline_ns = 0;
+    event_loop->m_events[event->id] = event;
+
+    context->ev.data = event;
+    context->ev.addRead = &event_loop_t::event_add_read;
+    context->ev.delRead = &event_loop_t::event_del_read;
+    context->ev.addWrite = &event_loop_t::event_add_write;
+    context->ev.delWrite = &event_loop_t::event_del_write;
+    context->ev.cleanup = &event_loop_t::event_cleanup;
+    context->ev.scheduleTimer = &event_loop_t::event_schedule_timer;
+
+    return REDIS_OK;
+}
+
+void RedisAsyncClient::event_loop_t::event_add_read(void * data)
+{
+    event_t * event = reinterpret_cast<event_t *>(data);
+#ifdef GOOFER_OS_IS_LINUX
+    event->events |= EPOLLIN;
+#endif // GOOFER_OS_IS_LINUX
+    event_update(event);
+}
+
+void RedisAsyncClient::event_loop_t::event_del_read(void * data)
+{
+    event_t * event = reinterpret_cast<event_t *>(data);
+#ifdef GOOFER_OS_IS_LINUX
+    event->events &= ~static_cast<uint32_t>(EPOLLIN);
+#endif // GOOFER_OS_IS_LINUX
+    event_update(event);
+}
+
+void RedisAsyncClient::event_loop_t::event_add_write(void * data)
+{
+    event_t * event = reinterpret_cast<event_t *>(data);
+#ifdef GOOFER_OS_IS_LINUX
+    event->events |= EPOLLOUT;
+#endif // GOOFER_OS_IS_LINUX
+    event_update(event);
+}
+
+void RedisAsyncClient::event_loop_t::event_del_write(void * data)
+{
+    event_t * event = reinterpret_cast<event_t *>(data);
+#ifdef GOOFER_OS_IS_LINUX
+    event->events &= ~static_cast<uint32_t>(EPOLLOUT);
+#endif // GOOFER_OS_IS_LINUX
+    event_update(event);
+}
+
+void RedisAsyncClient::event_loop_t::event_cleanup(void * data)
+{
+    event_t * event = reinterpret_cast<event_t *>(data);
+    event->events = 0;
+    event_update(event);
+    event->loop->m_events.erase(event->id);
+    event->context->ev.data = nullptr;
+    delete event;
+}
+
+void RedisAsyncClient::event_loop_t::event_schedule_timer(void * data, struct timeval tv)
+{
+    event_t * event = reinterpret_cast<event_t *>(data);
+    event->deadline_ns = get_ns_time() + static_cast<uint64_t>(tv.tv_sec) * 1000000000 + static_cast<uint64_t>(tv.tv_usec) * 1000;
+}
+
+void RedisAsyncClient::event_loop_t::event_update(event_t * event)
+{
+#ifdef GOOFER_OS_IS_LINUX
+    if (0 == event->events)
+    {
+        if (event->registered)
+        {
+            epoll_ctl(event->loop->m_epoll, EPOLL_CTL_DEL, event->context->c.fd, nullptr);
+            event->registered = false;
+        }
+        return;
+    }
+
+    struct epoll_event epoll_event;
+    epoll_event.events = event->events;
+    epoll_event.data.u64 = event->id;
+    if (0 != epoll_ctl(event->loop->m_epoll, event->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, event->context->c.fd, &epoll_event))
+    {
+        RUN_LOG_ERR("redis async client event update failure while epoll_ctl error (%d)", errno);
+        return;
+    }
+    event->registered = true;
+#endif // GOOFER_OS_IS_LINUX
+}
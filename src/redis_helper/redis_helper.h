@@ -13,10 +13,71 @@
 #include <cstdint>
 #include <string>
 #include <list>
+#include <deque>
+#include <vector>
+#include <utility>
+#include <initializer_list>
+#include <functional>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <condition_variable>
 #include "macros.h"
 
+struct timeval;
+struct redisReply;
 struct redisContext;
 struct redisClusterContext;
+struct redisAsyncContext;
+struct redisClusterAsyncContext;
+
+class RedisPipeline;
+class RedisPool;
+
+enum class RedisReplyType
+{
+    nil,
+    status,
+    error,
+    integer,
+    string,
+    array
+};
+
+struct GOOFER_API RedisResult
+{
+    RedisReplyType                  type;
+    int64_t                         integer;
+    std::string                     str;        // string and status replies, the message of an error reply
+    std::list<std::string>          elements;   // array replies, nil elements are empty
+};
+
+struct GOOFER_API RedisScanCursor // a default cursor starts a new scan, a finished one stays done
+{
+    RedisScanCursor();
+
+    std::string                     node;       // cluster master being scanned, masters are walked in address order
+    std::string                     position;   // SCAN cursor on that node
+    bool                            done;
+};
+
+struct GOOFER_API RedisPoolStats
+{
+    uint64_t                        acquires;
+    uint64_t                        timeouts;
+    uint64_t                        health_checks;      // PINGs sent to connections idle longer than the health check interval
+    uint64_t                        health_failures;    // health checks that needed a reconnect
+    uint64_t                        total_wait_ns;
+    uint64_t                        max_wait_ns;
+    uint64_t                        average_wait_ns;
+    size_t                          idle;
+    size_t                          leased;
+};
+
+typedef std::function<bool (const std::list<std::string> & keys)> RedisScanCallback; // return false to stop the scan
+typedef std::function<void (bool success, const RedisResult & result)> RedisAsyncCallback; // success is false when no reply arrived, the result then holds the error
 
 class GOOFER_API RedisClient
 {
@@ -34,12 +95,21 @@ public:
 
 public:
     bool find(const std::string & key);
-    bool find(const std::string & pattern, std::list<std::string> & keys);
+    bool find(const std::string & pattern, std::list<std::string> & keys); // scans the whole keyspace, prefer scan() for large ones
+
+public: // SCAN with MATCH, COUNT and TYPE (redis 6.0), keys may repeat, in cluster mode every master is scanned in turn
+    bool scan(RedisScanCursor & cursor, std::list<std::string> & keys, const std::string & pattern = "*", uint32_t count = 1000, const std::string & type = std::string());
+    bool scan(const std::string & pattern, const RedisScanCallback & callback, uint32_t count = 1000, const std::string & type = std::string());
 
 public:
     bool erase(const std::string & key);
     bool erase(const std::list<std::string> & keys);
 
+public: // one variadic command per hash slot in cluster mode, all pipelined, values and exists follow the order of keys
+    bool mget(const std::list<std::string> & keys, std::list<std::string> & values, std::list<bool> * exists = nullptr);
+    bool mset(const std::list<std::pair<std::string, std::string>> & pairs);
+    bool mdel(const std::list<std::string> & keys, size_t * erased = nullptr);
+
 public:
     bool persist(const std::string & key);
     bool persist(const std::list<std::string> & keys);
@@ -110,6 +180,15 @@ public:
     bool clear(const std::string & queue);
     bool clear();
 
+public:
+    bool ping();
+
+public:
+    RedisPipeline create_pipeline();
+
+private:
+    friend class RedisPipeline;
+
 private:
     bool login();
     void logoff();
@@ -118,8 +197,20 @@ private:
     bool flush_db();
 
 private:
-    bool execute(const std::list<std::string> & command_line, int reply_type, void * reply_value);
+    struct arg_t // a view of one command argument, the string must outlive execute()
+    {
+        arg_t(const char * arg);
+        arg_t(const std::string & arg);
+
+        const char                * data;
+        size_t                      size;
+    };
+
+private:
+    bool execute(std::initializer_list<arg_t> command_line, int reply_type, void * reply_value);
     bool expire(const std::string & key, const std::string & seconds);
+    bool execute(const std::vector<std::string> & args, const std::vector<size_t> & argcs, const std::function<bool (size_t command, const redisReply * redis_reply)> & handler);
+    void group_keys(const std::vector<const std::string *> & keys, std::vector<std::vector<size_t>> & groups) const;
 
 private:
     bool                            m_running;
@@ -132,5 +223,141 @@ private:
     redisClusterContext           * m_redis_cluster_context;
 };
 
+class GOOFER_API RedisPipeline // commands are queued locally, execute() writes them in batches and reads the replies in order
+{
+public:
+    RedisPipeline();
+    RedisPipeline(const RedisPipeline &) = delete;
+    RedisPipeline(RedisPipeline && other);
+    RedisPipeline & operator = (const RedisPipeline &) = delete;
+    RedisPipeline & operator = (RedisPipeline && other);
+    ~RedisPipeline();
+
+public:
+    bool good() const;
+    size_t size() const;
+    void clear();
+
+public:
+    bool append(const std::list<std::string> & command_line);
+    bool set(const std::string & key, const std::string & value);
+    bool get(const std::string & key);
+    bool erase(const std::string & key);
+    bool expire(const std::string & key, int64_t seconds);
+    bool push_back(const std::string & queue, const std::string & value);
+
+public: // one result per queued command, an error reply fails only its own command, the queue is empty afterwards
+    bool execute(std::vector<RedisResult> & results);
+
+private:
+    friend class RedisClient;
+
+private:
+    explicit RedisPipeline(RedisClient * client);
+
+private:
+    RedisClient                   * m_client;
+    std::vector<std::string>        m_args;
+    std::vector<size_t>             m_argcs;
+};
+
+class GOOFER_API RedisLease
+{
+public:
+    RedisLease();
+    RedisLease(const RedisLease &) = delete;
+    RedisLease(RedisLease && other);
+    RedisLease & operator = (const RedisLease &) = delete;
+    RedisLease & operator = (RedisLease && other);
+    ~RedisLease();
+
+public:
+    bool good() const;
+    void release();
+
+public:
+    RedisClient * operator -> () const;
+    RedisClient & operator * () const;
+
+private:
+    friend class RedisPool;
+
+private:
+    RedisLease(RedisPool * pool, RedisClient * client);
+
+private:
+    RedisPool                     * m_pool;
+    RedisClient                   * m_client;
+};
+
+class GOOFER_API RedisPool // connections are logged in by init(), a lease is used by one thread at a time and must be released before exit() or the destructor, which wait for every lease
+{
+public:
+    RedisPool();
+    RedisPool(const RedisPool &) = delete;
+    RedisPool(RedisPool &&) = delete;
+    RedisPool & operator = (const RedisPool &) = delete;
+    RedisPool & operator = (RedisPool &&) = delete;
+    ~RedisPool();
+
+public:
+    bool init(const std::string & address, const std::string & username, const std::string & password, uint16_t table_index = 0, uint32_t timeout_ms = 5000, size_t connection_count = 4, uint32_t health_check_ms = 30000);
+    void exit();
+
+public:
+    bool is_open() const;
+    size_t connection_count() const;
+
+public: // timeout_ms = 0 waits forever, the lease is not good() on timeout
+    RedisLease acquire(uint32_t timeout_ms = 0);
+    void get_stats(RedisPoolStats & stats);
+
+private:
+    friend class RedisLease;
+
+private:
+    void release(RedisClient * client);
+
+private:
+    typedef std::vector<std::pair<RedisClient *, uint64_t>> idle_client_list_t; // client and the time it was released
+
+private:
+    mutable std::mutex              m_mutex;
+    std::condition_variable         m_condition;
+    bool                            m_running;
+    uint64_t                        m_health_check_ns;
+    std::vector<RedisClient *>      m_clients;
+    idle_client_list_t              m_idle_clients;
+    size_t                          m_leases;
+    RedisPoolStats                  m_stats;
+};
+
+class GOOFER_API RedisAsyncClient // one event loop thread multiplexes the commands of all threads onto one connection per node, linux only
+{
+public:
+    RedisAsyncClient();
+    RedisAsyncClient(const RedisAsyncClient &) = delete;
+    RedisAsyncClient(RedisAsyncClient &&) = delete;
+    RedisAsyncClient & operator = (const RedisAsyncClient &) = delete;
+    RedisAsyncClient & operator = (RedisAsyncClient &&) = delete;
+    ~RedisAsyncClient();
+
+public:
+    bool init(const std::string & address, const std::string & username, const std::string & password, uint16_t table_index = 0, uint32_t timeout_ms = 5000);
+    void exit();
+
+public: // callbacks run on the event loop thread and must not block it, commands queued at exit() fail
+       // exit() or the destructor from a callback only stops the loop, its detached thread frees the connections once the callback returns
+    bool execute(const std::list<std::string> & command_line, const RedisAsyncCallback & callback);
+    std::future<RedisResult> execute(const std::list<std::string> & command_line);
+
+private:
+    class event_loop_t;
+
+private:
+    std::shared_ptr<event_loop_t>   m_loop;
+    std::thread                     m_thread;
+};
+
 
 #endif // REDIS_HELPER_H
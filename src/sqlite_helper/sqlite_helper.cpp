@@ -6,595 +6,4720 @@
  * Copyright(C): 2025
  ********************************************************/
 
+#include <sys/stat.h>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <utility>
 #include "sqlite_helper.h"
 #include "sqlite3.h"
 #include "base.h"
 
+static const size_t s_multi_row_max = 64;
+
+static std::mutex s_memory_mutex;
+static std::vector<uint64_t> s_page_cache_memory;
+static std::vector<uint64_t> s_heap_memory;
+
+static std::string sqlite_quote(const std::string & name)
+{
+    // a double quoted identifier, embedded quotes are doubled
+    std::string quoted("\"");
+    for (size_t index = 0; index < name.size(); ++index)
+    {
+        quoted += name[index];
+        if ('"' == name[index])
+        {
+            quoted += '"';
+        }
+    }
+    quoted += "\"";
+    return quoted;
+}
+
+static bool sqlite_execute(sqlite3 * sqlite, const char * sql)
+{
+    char * error_message = nullptr;
+    int result = sqlite3_exec(sqlite, sql, nullptr, nullptr, &error_message);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite execute failure while exec (%s) failed, error (%d: %s) message (%s)", sql, result, sqlite3_errstr(result), nullptr != error_message ? error_message : "unknown");
+    }
+
+    if (nullptr != error_message)
+    {
+        sqlite3_free(error_message);
+        error_message = nullptr;
+    }
+
+    return SQLITE_OK == result;
+}
+
+static bool sqlite_backup(sqlite3 * source, const std::string & source_path, sqlite3 * target, const std::string & target_path, int pages_per_step, uint32_t sleep_ms, const SQLiteBackupProgress & progress)
+{
+    if (nullptr == source || nullptr == target)
+    {
+        RUN_LOG_ERR("sqlite backup (%s) to (%s) failure while database is not open", source_path.c_str(), target_path.c_str());
+        return false;
+    }
+
+    sqlite3_backup * backup = sqlite3_backup_init(target, "main", source, "main");
+    if (nullptr == backup)
+    {
+        RUN_LOG_ERR("sqlite backup (%s) to (%s) failure while init failed, error (%d: %s)", source_path.c_str(), target_path.c_str(), sqlite3_errcode(target), sqlite3_errmsg(target));
+        return false;
+    }
+
+    bool aborted = false;
+    int result = SQLITE_OK;
+    do
+    {
+        result = sqlite3_backup_step(backup, 0 == pages_per_step ? -1 : pages_per_step);
+        if (SQLITE_BUSY == result || SQLITE_LOCKED == result)
+        {
+            // another connection holds the lock, retry the same step later
+            sqlite3_sleep(std::max<int>(static_cast<int>(sleep_ms), 1));
+            continue;
+        }
+        if (SQLITE_OK != result && SQLITE_DONE != result)
+        {
+            break;
+        }
+        if (progress && !progress(sqlite3_backup_remaining(backup), sqlite3_backup_pagecount(backup)))
+        {
+            aborted = true;
+            break;
+        }
+        if (SQLITE_OK == result && sleep_ms > 0)
+        {
+            sqlite3_sleep(static_cast<int>(sleep_ms));
+        }
+    } while (SQLITE_DONE != result);
+
+    int finish = sqlite3_backup_finish(backup);
+
+    if (aborted)
+    {
+        RUN_LOG_ERR("sqlite backup (%s) to (%s) failure while progress aborted", source_path.c_str(), target_path.c_str());
+        return false;
+    }
+
+    if (SQLITE_DONE != result)
+    {
+        RUN_LOG_ERR("sqlite backup (%s) to (%s) failure while step failed, error (%d: %s)", source_path.c_str(), target_path.c_str(), result, sqlite3_errstr(result));
+        return false;
+    }
+
+    if (SQLITE_OK != finish)
+    {
+        RUN_LOG_ERR("sqlite backup (%s) to (%s) failure while finish failed, error (%d: %s)", source_path.c_str(), target_path.c_str(), finish, sqlite3_errstr(finish));
+        return false;
+    }
+
+    return true;
+}
+
+static bool sqlite_backup_file(sqlite3 * sqlite, const std::string & sqlite_path, const std::string & path, bool to_file, int pages_per_step, uint32_t sleep_ms, const SQLiteBackupProgress & progress)
+{
+    if (path.empty())
+    {
+        RUN_LOG_ERR("sqlite backup failure while path is invalid");
+        return false;
+    }
+
+    sqlite3 * file = nullptr;
+    const int flags = (to_file ? SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE : SQLITE_OPEN_READONLY) | SQLITE_OPEN_URI;
+    int result = sqlite3_open_v2(path.c_str(), &file, flags, nullptr);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite backup failure while open (%s) failed, error (%d: %s)", path.c_str(), result, sqlite3_errstr(result));
+        sqlite3_close(file);
+        return false;
+    }
+
+    const bool ret = to_file
+        ? sqlite_backup(sqlite, sqlite_path, file, path, pages_per_step, sleep_ms, progress)
+        : sqlite_backup(file, path, sqlite, sqlite_path, pages_per_step, sleep_ms, progress);
+
+    sqlite3_close(file);
+
+    return ret;
+}
+
+struct kv_table_t : public sqlite3_vtab
+{
+    SQLiteKVStore                         * store;
+};
+
+struct kv_cursor_t : public sqlite3_vtab_cursor
+{
+    SQLiteKVCursor                        * cursor;
+    sqlite3_int64                           rowid;
+    bool                                    has_upper;
+    bool                                    upper_inclusive;
+    std::string                             upper;
+};
+
+enum kv_index_t
+{
+    kv_index_eq = 0x01,
+    kv_index_gt = 0x02,
+    kv_index_ge = 0x04,
+    kv_index_lt = 0x08,
+    kv_index_le = 0x10
+};
+
+static int kv_compare(const SQLiteView & key, const std::string & bound)
+{
+    const size_t size = std::min(key.size, bound.size());
+    const int result = (0 != size ? memcmp(key.data, bound.data(), size) : 0);
+    return 0 != result ? result : (key.size < bound.size() ? -1 : (key.size > bound.size() ? 1 : 0));
+}
+
+typedef std::unordered_map<std::string, SQLiteKVStore *> kv_store_map_t;
+
+static const char * s_kv_module_name = "kv_store";
+
+static std::string kv_store_key(const std::string & table)
+{
+    // table names compare without ascii case in sqlite
+    std::string key(table);
+    for (std::string::iterator iter = key.begin(); key.end() != iter; ++iter)
+    {
+        *iter = static_cast<char>(tolower(static_cast<unsigned char>(*iter)));
+    }
+    return key;
+}
+
+static int kv_create(sqlite3 * sqlite, void * aux, int argc, const char * const * argv, sqlite3_vtab ** vtab, char ** error)
+{
+    // the module is shared by the tables of a connection, each table finds its store by name in the registry
+    const kv_store_map_t * stores = reinterpret_cast<const kv_store_map_t *>(aux);
+    kv_store_map_t::const_iterator iter = (argc > 2 ? stores->find(kv_store_key(argv[2])) : stores->end());
+    if (stores->end() == iter)
+    {
+        *error = sqlite3_mprintf("no kv store is registered for table (%s)", argc > 2 ? argv[2] : "");
+        return SQLITE_ERROR;
+    }
+
+    int result = sqlite3_declare_vtab(sqlite, "CREATE TABLE x(key TEXT, value BLOB)");
+    if (SQLITE_OK != result)
+    {
+        return result;
+    }
+
+    kv_table_t * table = new kv_table_t;
+    memset(static_cast<sqlite3_vtab *>(table), 0, sizeof(sqlite3_vtab));
+    table->store = iter->second;
+    *vtab = table;
+
+    return SQLITE_OK;
+}
+
+static int kv_destroy(sqlite3_vtab * vtab)
+{
+    delete static_cast<kv_table_t *>(vtab);
+    return SQLITE_OK;
+}
+
+static int kv_best_index(sqlite3_vtab * vtab, sqlite3_index_info * info)
+{
+    int eq = -1;
+    int lower = -1;
+    int upper = -1;
+    int index_num = 0;
+    for (int index = 0; index < info->nConstraint; ++index)
+    {
+        const sqlite3_index_info::sqlite3_index_constraint & constraint = info->aConstraint[index];
+        if (0 != constraint.iColumn || !constraint.usable)
+        {
+            continue;
+        }
+        if (SQLITE_INDEX_CONSTRAINT_EQ == constraint.op && eq < 0)
+        {
+            eq = index;
+        }
+        else if ((SQLITE_INDEX_CONSTRAINT_GT == constraint.op || SQLITE_INDEX_CONSTRAINT_GE == constraint.op) && lower < 0)
+        {
+            lower = index;
+            index_num |= (SQLITE_INDEX_CONSTRAINT_GT == constraint.op ? kv_index_gt : kv_index_ge);
+        }
+        else if ((SQLITE_INDEX_CONSTRAINT_LT == constraint.op || SQLITE_INDEX_CONSTRAINT_LE == constraint.op) && upper < 0)
+        {
+            upper = index;
+            index_num |= (SQLITE_INDEX_CONSTRAINT_LT == constraint.op ? kv_index_lt : kv_index_le);
+        }
+    }
+
+    // sqlite still checks every constraint, the bounds only decide where the cursor seeks and stops
+    if (eq >= 0)
+    {
+        info->idxNum = kv_index_eq;
+        info->aConstraintUsage[eq].argvIndex = 1;
+        info->estimatedCost = 10.0;
+        info->estimatedRows = 1;
+        info->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+    }
+    else
+    {
+        int argv_index = 0;
+        if (lower >= 0)
+        {
+            info->aConstraintUsage[lower].argvIndex = ++argv_index;
+        }
+        if (upper >= 0)
+        {
+            info->aConstraintUsage[upper].argvIndex = ++argv_index;
+        }
+        info->idxNum = index_num;
+        info->estimatedCost = (lower >= 0 && upper >= 0 ? 1000.0 : (lower >= 0 || upper >= 0 ? 100000.0 : 1000000.0));
+        info->estimatedRows = static_cast<sqlite3_int64>(info->estimatedCost);
+    }
+
+    if (1 == info->nOrderBy && 0 == info->aOrderBy[0].iColumn && !info->aOrderBy[0].desc)
+    {
+        info->orderByConsumed = 1;
+    }
+
+    return SQLITE_OK;
+}
+
+static int kv_open(sqlite3_vtab * vtab, sqlite3_vtab_cursor ** cursor)
+{
+    SQLiteKVCursor * kv_cursor = static_cast<kv_table_t *>(vtab)->store->open_cursor();
+    if (nullptr == kv_cursor)
+    {
+        return SQLITE_ERROR;
+    }
+
+    kv_cursor_t * table_cursor = new kv_cursor_t;
+    memset(static_cast<sqlite3_vtab_cursor *>(table_cursor), 0, sizeof(sqlite3_vtab_cursor));
+    table_cursor->cursor = kv_cursor;
+    table_cursor->rowid = 0;
+    table_cursor->has_upper = false;
+    table_cursor->upper_inclusive = false;
+    *cursor = table_cursor;
+
+    return SQLITE_OK;
+}
+
+static int kv_close(sqlite3_vtab_cursor * cursor)
+{
+    kv_cursor_t * table_cursor = static_cast<kv_cursor_t *>(cursor);
+    delete table_cursor->cursor;
+    delete table_cursor;
+    return SQLITE_OK;
+}
+
+static SQLiteView kv_value_text(sqlite3_value * value)
+{
+    SQLiteView view = { reinterpret_cast<const char *>(sqlite3_value_text(value)), 0 };
+    view.size = static_cast<size_t>(sqlite3_value_bytes(value));
+    if (nullptr == view.data)
+    {
+        view.data = "";
+    }
+    return view;
+}
+
+static int kv_filter(sqlite3_vtab_cursor * cursor, int index_num, const char * index_str, int argc, sqlite3_value ** argv)
+{
+    kv_cursor_t * table_cursor = static_cast<kv_cursor_t *>(cursor);
+    SQLiteKVCursor * kv_cursor = table_cursor->cursor;
+
+    table_cursor->rowid = 0;
+    table_cursor->has_upper = false;
+    table_cursor->upper_inclusive = false;
+    table_cursor->upper.clear();
+
+    int argv_index = 0;
+    SQLiteView lower = { "", 0 };
+    bool lower_exclusive = false;
+    if (0 != (index_num & kv_index_eq))
+    {
+        lower = kv_value_text(argv[argv_index++]);
+        table_cursor->has_upper = true;
+        table_cursor->upper_inclusive = true;
+        table_cursor->upper.assign(lower.data, lower.size);
+    }
+    else
+    {
+        if (0 != (index_num & (kv_index_gt | kv_index_ge)))
+        {
+            lower = kv_value_text(argv[argv_index++]);
+            lower_exclusive = (0 != (index_num & kv_index_gt));
+        }
+        if (0 != (index_num & (kv_index_lt | kv_index_le)))
+        {
+            const SQLiteView upper = kv_value_text(argv[argv_index++]);
+            table_cursor->has_upper = true;
+            table_cursor->upper_inclusive = (0 != (index_num & kv_index_le));
+            table_cursor->upper.assign(upper.data, upper.size);
+        }
+    }
+
+    const std::string lower_key(lower.data, lower.size);
+    kv_cursor->seek(lower);
+    if (lower_exclusive && kv_cursor->valid() && 0 == kv_compare(kv_cursor->key(), lower_key))
+    {
+        kv_cursor->next();
+    }
+
+    return SQLITE_OK;
+}
+
+static int kv_next(sqlite3_vtab_cursor * cursor)
+{
+    kv_cursor_t * table_cursor = static_cast<kv_cursor_t *>(cursor);
+    table_cursor->cursor->next();
+    table_cursor->rowid += 1;
+    return SQLITE_OK;
+}
+
+static int kv_eof(sqlite3_vtab_cursor * cursor)
+{
+    kv_cursor_t * table_cursor = static_cast<kv_cursor_t *>(cursor);
+    if (!table_cursor->cursor->valid())
+    {
+        return 1;
+    }
+    if (table_cursor->has_upper)
+    {
+        const int result = kv_compare(table_cursor->cursor->key(), table_cursor->upper);
+        return (result > 0 || (0 == result && !table_cursor->upper_inclusive)) ? 1 : 0;
+    }
+    return 0;
+}
+
+static int kv_column(sqlite3_vtab_cursor * cursor, sqlite3_context * context, int column)
+{
+    SQLiteKVCursor * kv_cursor = static_cast<kv_cursor_t *>(cursor)->cursor;
+    if (0 == column)
+    {
+        const SQLiteView key = kv_cursor->key();
+        sqlite3_result_text(context, nullptr != key.data ? key.data : "", static_cast<int>(key.size), SQLITE_TRANSIENT);
+    }
+    else
+    {
+        const SQLiteView value = kv_cursor->value();
+        sqlite3_result_blob(context, nullptr != value.data ? value.data : "", static_cast<int>(value.size), SQLITE_TRANSIENT);
+    }
+    return SQLITE_OK;
+}
+
+static int kv_rowid(sqlite3_vtab_cursor * cursor, sqlite3_int64 * rowid)
+{
+    *rowid = static_cast<kv_cursor_t *>(cursor)->rowid;
+    return SQLITE_OK;
+}
+
+static sqlite3_module s_kv_module = {
+    0,                                      // iVersion
+    kv_create,                              // xCreate
+    kv_create,                              // xConnect
+    kv_best_index,                          // xBestIndex
+    kv_destroy,                             // xDisconnect
+    kv_destroy,                             // xDestroy
+    kv_open,                                // xOpen
+    kv_close,                               // xClose
+    kv_filter,                              // xFilter
+    kv_next,                                // xNext
+    kv_eof,                                 // xEof
+    kv_column,                              // xColumn
+    kv_rowid,                               // xRowid
+    nullptr,                                // xUpdate
+    nullptr,                                // xBegin
+    nullptr,                                // xSync
+    nullptr,                                // xCommit
+    nullptr,                                // xRollback
+    nullptr,                                // xFindFunction
+    nullptr,                                // xRename
+    nullptr,                                // xSavepoint
+    nullptr,                                // xRelease
+    nullptr                                 // xRollbackTo
+};
+
+SQLiteOptions::SQLiteOptions()
+    : journal_mode()
+    , synchronous(-1)
+    , mmap_size(-1)
+    , cache_size(0)
+    , page_size(0)
+    , temp_store(-1)
+    , busy_timeout(-1)
+    , wal_autocheckpoint(-1)
+    , statement_cache(32)
+    , read_only(false)
+    , no_mutex(false)
+{
+
+}
+
+SQLiteOptions SQLiteOptions::durable()
+{
+    SQLiteOptions options;
+    options.journal_mode = "WAL";
+    options.synchronous = 2;
+    options.cache_size = -8192;
+    options.temp_store = 2;
+    options.busy_timeout = 5000;
+    return options;
+}
+
+SQLiteOptions SQLiteOptions::fast_wal()
+{
+    SQLiteOptions options;
+    options.journal_mode = "WAL";
+    options.synchronous = 1;
+    options.mmap_size = 64 * 1024 * 1024;
+    options.cache_size = -32768;
+    options.page_size = 4096;
+    options.temp_store = 2;
+    options.busy_timeout = 5000;
+    return options;
+}
+
+SQLiteOptions SQLiteOptions::read_mostly()
+{
+    SQLiteOptions options;
+    options.journal_mode = "WAL";
+    options.synchronous = 1;
+    options.mmap_size = 256 * 1024 * 1024;
+    options.cache_size = -65536;
+    options.page_size = 4096;
+    options.temp_store = 2;
+    options.busy_timeout = 5000;
+    return options;
+}
+
+SQLiteOptions SQLiteOptions::profile(const std::string & name)
+{
+    if ("durable" == name)
+    {
+        return durable();
+    }
+    else if ("fast-wal" == name)
+    {
+        return fast_wal();
+    }
+    else if ("read-mostly" == name)
+    {
+        return read_mostly();
+    }
+    else
+    {
+        if (!name.empty())
+        {
+            RUN_LOG_WAR("sqlite options profile (%s) is unknown, use default options", name.c_str());
+        }
+        return SQLiteOptions();
+    }
+}
+
+SQLiteMemoryConfig::SQLiteMemoryConfig()
+    : page_cache_page_size(0)
+    , page_cache_pages(0)
+    , lookaside_slot_size(0)
+    , lookaside_slots(0)
+    , memory_status(true)
+    , heap_size(0)
+    , heap_min_alloc(64)
+{
+
+}
+
+SQLiteMemoryInit::SQLiteMemoryInit(const SQLiteMemoryConfig & config)
+    : m_good(SQLiteDB::configure_memory(config))
+{
+
+}
+
+bool SQLiteMemoryInit::good() const
+{
+    return m_good;
+}
+
+bool SQLiteDB::configure_memory(const SQLiteMemoryConfig & config)
+{
+    std::lock_guard<std::mutex> locker(s_memory_mutex);
+
+    // sqlite3_config() returns SQLITE_MISUSE once the library is initialized by the first open, so buffers in use are never replaced
+    int result = sqlite3_config(SQLITE_CONFIG_MEMSTATUS, config.memory_status ? 1 : 0);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite configure memory failure while set memory status failed, error (%d: %s)", result, sqlite3_errstr(result));
+        return false;
+    }
+
+    if (config.heap_size > 0)
+    {
+        s_heap_memory.assign((config.heap_size + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+        result = sqlite3_config(SQLITE_CONFIG_HEAP, s_heap_memory.data(), static_cast<int>(s_heap_memory.size() * sizeof(uint64_t)), config.heap_min_alloc);
+        if (SQLITE_OK != result)
+        {
+            RUN_LOG_ERR("sqlite configure memory failure while set heap (%u bytes) failed, error (%d: %s)", static_cast<uint32_t>(config.heap_size), result, sqlite3_errstr(result));
+            s_heap_memory.clear();
+            return false;
+        }
+    }
+
+    if (config.page_cache_page_size > 0 && config.page_cache_pages > 0)
+    {
+        int header_size = 0;
+        result = sqlite3_config(SQLITE_CONFIG_PCACHE_HDRSZ, &header_size);
+        if (SQLITE_OK != result)
+        {
+            RUN_LOG_ERR("sqlite configure memory failure while get page cache header size failed, error (%d: %s)", result, sqlite3_errstr(result));
+            return false;
+        }
+        const size_t slot_size = (static_cast<size_t>(config.page_cache_page_size + header_size) + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+        s_page_cache_memory.assign(slot_size / sizeof(uint64_t) * static_cast<size_t>(config.page_cache_pages), 0);
+        result = sqlite3_config(SQLITE_CONFIG_PAGECACHE, s_page_cache_memory.data(), static_cast<int>(slot_size), config.page_cache_pages);
+        if (SQLITE_OK != result)
+        {
+            RUN_LOG_ERR("sqlite configure memory failure while set page cache (%d x %u bytes) failed, error (%d: %s)", config.page_cache_pages, static_cast<uint32_t>(slot_size), result, sqlite3_errstr(result));
+            s_page_cache_memory.clear();
+            return false;
+        }
+    }
+
+    if (config.lookaside_slot_size > 0)
+    {
+        result = sqlite3_config(SQLITE_CONFIG_LOOKASIDE, config.lookaside_slot_size, config.lookaside_slots);
+        if (SQLITE_OK != result)
+        {
+            RUN_LOG_ERR("sqlite configure memory failure while set lookaside (%d x %d bytes) failed, error (%d: %s)", config.lookaside_slots, config.lookaside_slot_size, result, sqlite3_errstr(result));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int64_t sqlite_status(int operation, bool highwater, bool reset_highwater)
+{
+    sqlite3_int64 current = 0;
+    sqlite3_int64 highest = 0;
+    if (SQLITE_OK != sqlite3_status64(operation, &current, &highest, reset_highwater ? 1 : 0))
+    {
+        return 0;
+    }
+    return static_cast<int64_t>(highwater ? highest : current);
+}
+
+void SQLiteDB::get_process_memory_stats(SQLiteMemoryStats & stats, bool reset_highwater)
+{
+    stats.memory_used = sqlite_status(SQLITE_STATUS_MEMORY_USED, false, false);
+    stats.memory_highwater = sqlite_status(SQLITE_STATUS_MEMORY_USED, true, reset_highwater);
+    stats.malloc_count = sqlite_status(SQLITE_STATUS_MALLOC_COUNT, false, reset_highwater);
+    stats.malloc_size_highwater = sqlite_status(SQLITE_STATUS_MALLOC_SIZE, true, reset_highwater);
+    stats.page_cache_used = sqlite_status(SQLITE_STATUS_PAGECACHE_USED, false, reset_highwater);
+    stats.page_cache_overflow = sqlite_status(SQLITE_STATUS_PAGECACHE_OVERFLOW, false, reset_highwater);
+    stats.page_cache_size_highwater = sqlite_status(SQLITE_STATUS_PAGECACHE_SIZE, true, reset_highwater);
+    stats.lookaside_used = 0;
+    stats.lookaside_hits = 0;
+    stats.lookaside_misses = 0;
+    stats.cache_used = 0;
+}
+
+bool SQLiteDB::get_memory_stats(SQLiteMemoryStats & stats, bool reset_highwater) const
+{
+    get_process_memory_stats(stats, reset_highwater);
+
+    if (nullptr == m_sqlite)
+    {
+        return false;
+    }
+
+    int current = 0;
+    int highest = 0;
+    if (SQLITE_OK == sqlite3_db_status(m_sqlite, SQLITE_DBSTATUS_LOOKASIDE_USED, &current, &highest, reset_highwater ? 1 : 0))
+    {
+        stats.lookaside_used = current;
+    }
+    if (SQLITE_OK == sqlite3_db_status(m_sqlite, SQLITE_DBSTATUS_LOOKASIDE_HIT, &current, &highest, reset_highwater ? 1 : 0))
+    {
+        stats.lookaside_hits = highest;
+    }
+    if (SQLITE_OK == sqlite3_db_status(m_sqlite, SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, &current, &highest, reset_highwater ? 1 : 0))
+    {
+        stats.lookaside_misses = highest;
+    }
+    if (SQLITE_OK == sqlite3_db_status(m_sqlite, SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, &current, &highest, reset_highwater ? 1 : 0))
+    {
+        stats.lookaside_misses += highest;
+    }
+    if (SQLITE_OK == sqlite3_db_status(m_sqlite, SQLITE_DBSTATUS_CACHE_USED, &current, &highest, 0))
+    {
+        stats.cache_used = current;
+    }
+
+    return true;
+}
+
+struct SQLiteDB::statement_cache_t
+{
+    std::mutex                              mutex;
+    sqlite3                               * sqlite;     // nullptr once the db is closed
+    SQLiteDB                              * db;
+    statement_list_t                        list;
+    statement_map_t                         map;
+    size_t                                  capacity;
+    uint64_t                                hits;
+    uint64_t                                misses;
+    uint64_t                                evictions;
+    size_t                                  borrowed;
+};
+
 SQLiteDB::SQLiteDB()
     : m_path()
     , m_sqlite(nullptr)
+    , m_statement_cache()
+    , m_profiling(false)
+    , m_profile()
+    , m_change_subscribers()
+    , m_change_sequence(0)
+    , m_change_delivering(false)
+    , m_changes()
+    , m_change_savepoints()
+    , m_change_marks()
+    , m_change_finished()
+    , m_committed_changes()
+    , m_kv_module(false)
+    , m_kv_stores()
+{
+
+}
+
+SQLiteDB::~SQLiteDB()
+{
+    exit();
+}
+
+bool SQLiteDB::init(const std::string & path)
+{
+    return init(path, SQLiteOptions());
+}
+
+bool SQLiteDB::init(const std::string & path, const SQLiteOptions & options)
+{
+    exit();
+
+    if (path.empty())
+    {
+        RUN_LOG_ERR("sqlite db init failure while path is invalid");
+        return false;
+    }
+
+    const int flags = (options.read_only ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) | (options.no_mutex ? SQLITE_OPEN_NOMUTEX : 0) | SQLITE_OPEN_URI;
+    int result = sqlite3_open_v2(path.c_str(), &m_sqlite, flags, nullptr);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite db init failure while open (%s) failed, error (%d: %s)", path.c_str(), result, sqlite3_errstr(result));
+        sqlite3_close(m_sqlite);
+        m_sqlite = nullptr;
+        return false;
+    }
+
+    m_path = path;
+    m_statement_cache = std::make_shared<statement_cache_t>();
+    m_statement_cache->sqlite = m_sqlite;
+    m_statement_cache->db = this;
+    m_statement_cache->capacity = options.statement_cache;
+    m_statement_cache->hits = 0;
+    m_statement_cache->misses = 0;
+    m_statement_cache->evictions = 0;
+    m_statement_cache->borrowed = 0;
+
+    if (!apply_options(options))
+    {
+        RUN_LOG_ERR("sqlite db init failure while apply options to (%s) failed", path.c_str());
+        exit();
+        return false;
+    }
+
+    return true;
+}
+
+void SQLiteDB::exit()
+{
+    if (nullptr != m_sqlite)
+    {
+        if (m_statement_cache)
+        {
+            std::lock_guard<std::mutex> locker(m_statement_cache->mutex);
+            if (0 != m_statement_cache->borrowed)
+            {
+                RUN_LOG_ERR("sqlite db exit while (%u) statements of (%s) are still in use", static_cast<uint32_t>(m_statement_cache->borrowed), m_path.c_str());
+            }
+            shrink_statement_cache(*m_statement_cache, 0);
+            m_statement_cache->sqlite = nullptr;
+            m_statement_cache->db = nullptr;
+        }
+        m_statement_cache.reset();
+        // statements still borrowed keep the connection open until they are finalized
+        int result = sqlite3_close_v2(m_sqlite);
+        if (SQLITE_OK != result)
+        {
+            RUN_LOG_ERR("sqlite db exit failure while close (%s) failed, error (%d: %s)", m_path.c_str(), result, sqlite3_errstr(result));
+        }
+        m_sqlite = nullptr;
+        m_path.clear();
+        m_profiling = false;
+        m_profile.clear();
+        m_change_subscribers.clear();
+        m_change_delivering = false;
+        m_changes.clear();
+        m_change_savepoints.clear();
+        m_change_marks.clear();
+        m_change_finished = change_mark_t();
+        m_committed_changes.clear();
+        m_kv_module = false;
+        m_kv_stores.clear();
+    }
+}
+
+bool SQLiteDB::load(const std::string & path, const SQLiteOptions & options)
+{
+    SQLiteOptions memory_options(options);
+    memory_options.read_only = false;
+    memory_options.journal_mode.clear();
+    memory_options.mmap_size = -1;
+
+    if (!init(":memory:", memory_options))
+    {
+        return false;
+    }
+
+    // the page size of the memory database follows the file, one step reads the file sequentially
+    if (!restore_from(path, -1))
+    {
+        RUN_LOG_ERR("sqlite db load failure while restore from (%s) failed", path.c_str());
+        exit();
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteDB::backup_to(const std::string & path, int pages_per_step, uint32_t sleep_ms, const SQLiteBackupProgress & progress)
+{
+    return sqlite_backup_file(m_sqlite, m_path, path, true, pages_per_step, sleep_ms, progress);
+}
+
+bool SQLiteDB::backup_to(SQLiteDB & target, int pages_per_step, uint32_t sleep_ms, const SQLiteBackupProgress & progress)
+{
+    return sqlite_backup(m_sqlite, m_path, target.m_sqlite, target.m_path, pages_per_step, sleep_ms, progress);
+}
+
+bool SQLiteDB::restore_from(const std::string & path, int pages_per_step, uint32_t sleep_ms, const SQLiteBackupProgress & progress)
+{
+    return sqlite_backup_file(m_sqlite, m_path, path, false, pages_per_step, sleep_ms, progress);
+}
+
+bool SQLiteDB::restore_from(SQLiteDB & source, int pages_per_step, uint32_t sleep_ms, const SQLiteBackupProgress & progress)
+{
+    return sqlite_backup(source.m_sqlite, source.m_path, m_sqlite, m_path, pages_per_step, sleep_ms, progress);
+}
+
+bool SQLiteDB::is_open() const
+{
+    return nullptr != m_sqlite;
+}
+
+int SQLiteDB::error() const
+{
+    return nullptr != m_sqlite ? sqlite3_errcode(m_sqlite) : 999;
+}
+
+const char * SQLiteDB::what() const
+{
+    return nullptr != m_sqlite ? sqlite3_errmsg(m_sqlite) : "sqlite db is not open";
+}
+
+bool SQLiteDB::get_options(SQLiteOptions & options) const
+{
+    if (!is_open())
+    {
+        return false;
+    }
+
+    int64_t synchronous = 0;
+    int64_t page_size = 0;
+    int64_t temp_store = 0;
+    int64_t busy_timeout = 0;
+    int64_t wal_autocheckpoint = 0;
+
+    if (!pragma_get("journal_mode", options.journal_mode))
+    {
+        return false;
+    }
+    if (!pragma_get("synchronous", synchronous))
+    {
+        return false;
+    }
+    if (!pragma_get("mmap_size", options.mmap_size))
+    {
+        return false;
+    }
+    if (!pragma_get("cache_size", options.cache_size))
+    {
+        return false;
+    }
+    if (!pragma_get("page_size", page_size))
+    {
+        return false;
+    }
+    if (!pragma_get("temp_store", temp_store))
+    {
+        return false;
+    }
+    if (!pragma_get("busy_timeout", busy_timeout))
+    {
+        return false;
+    }
+    if (!pragma_get("wal_autocheckpoint", wal_autocheckpoint))
+    {
+        return false;
+    }
+
+    for (std::string::iterator iter = options.journal_mode.begin(); options.journal_mode.end() != iter; ++iter)
+    {
+        *iter = static_cast<char>(toupper(static_cast<unsigned char>(*iter)));
+    }
+    options.synchronous = static_cast<int>(synchronous);
+    options.page_size = static_cast<int>(page_size);
+    options.temp_store = static_cast<int>(temp_store);
+    options.busy_timeout = static_cast<int>(busy_timeout);
+    options.wal_autocheckpoint = static_cast<int>(wal_autocheckpoint);
+    options.no_mutex = (nullptr == sqlite3_db_mutex(m_sqlite));
+    {
+        std::lock_guard<std::mutex> locker(m_statement_cache->mutex);
+        options.statement_cache = m_statement_cache->capacity;
+    }
+
+    return true;
+}
+
+bool SQLiteDB::apply_options(const SQLiteOptions & options)
+{
+    // page size must go first, it can not be changed once the database is in wal mode
+    if (options.page_size > 0 && !pragma_set("page_size", std::to_string(options.page_size)))
+    {
+        return false;
+    }
+    if (!options.journal_mode.empty() && !pragma_set("journal_mode", options.journal_mode))
+    {
+        return false;
+    }
+    if (options.synchronous >= 0 && !pragma_set("synchronous", std::to_string(options.synchronous)))
+    {
+        return false;
+    }
+    if (0 != options.cache_size && !pragma_set("cache_size", std::to_string(options.cache_size)))
+    {
+        return false;
+    }
+    if (options.mmap_size >= 0 && !pragma_set("mmap_size", std::to_string(options.mmap_size)))
+    {
+        return false;
+    }
+    if (options.temp_store >= 0 && !pragma_set("temp_store", std::to_string(options.temp_store)))
+    {
+        return false;
+    }
+    if (options.busy_timeout >= 0)
+    {
+        int result = sqlite3_busy_timeout(m_sqlite, options.busy_timeout);
+        if (SQLITE_OK != result)
+        {
+            RUN_LOG_ERR("sqlite db (%s) set busy timeout (%d) failure, error (%d: %s)", m_path.c_str(), options.busy_timeout, result, sqlite3_errstr(result));
+            return false;
+        }
+    }
+    if (options.wal_autocheckpoint >= 0)
+    {
+        int result = sqlite3_wal_autocheckpoint(m_sqlite, options.wal_autocheckpoint);
+        if (SQLITE_OK != result)
+        {
+            RUN_LOG_ERR("sqlite db (%s) set wal autocheckpoint (%d) failure, error (%d: %s)", m_path.c_str(), options.wal_autocheckpoint, result, sqlite3_errstr(result));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SQLiteDB::pragma_set(const std::string & name, const std::string & value)
+{
+    return execute("PRAGMA " + name + " = " + value + ";");
+}
+
+bool SQLiteDB::pragma_get(const std::string & name, int64_t & value) const
+{
+    SQLiteReader reader(m_sqlite, "PRAGMA " + name + ";");
+    if (!reader.read())
+    {
+        RUN_LOG_ERR("sqlite db (%s) get pragma (%s) failure", m_path.c_str(), name.c_str());
+        return false;
+    }
+    return reader.get(value);
+}
+
+bool SQLiteDB::pragma_get(const std::string & name, std::string & value) const
+{
+    SQLiteReader reader(m_sqlite, "PRAGMA " + name + ";");
+    if (!reader.read())
+    {
+        RUN_LOG_ERR("sqlite db (%s) get pragma (%s) failure", m_path.c_str(), name.c_str());
+        return false;
+    }
+    return reader.get(value);
+}
+
+bool SQLiteDB::execute(const std::string & sql)
+{
+    if (!is_open() || sql.empty())
+    {
+        return false;
+    }
+
+    // stepped here instead of sqlite3_exec() so that the changes of the statement that failed can be dropped
+    int result = SQLITE_OK;
+    const char * tail = sql.c_str();
+    while (SQLITE_OK == result && '\0' != *tail)
+    {
+        sqlite3_stmt * statement = nullptr;
+        result = sqlite3_prepare_v2(m_sqlite, tail, -1, &statement, &tail);
+        if (SQLITE_OK != result || nullptr == statement)
+        {
+            continue;
+        }
+
+        do
+        {
+            result = sqlite3_step(statement);
+        } while (SQLITE_ROW == result);
+
+        if (SQLITE_DONE == result)
+        {
+            result = SQLITE_OK;
+        }
+        else
+        {
+            discard_changes(statement);
+        }
+
+        sqlite3_finalize(statement);
+    }
+
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite db execute failure while exec (%s) failed, error (%d: %s) message (%s)", sql.c_str(), result, sqlite3_errstr(result), sqlite3_errmsg(m_sqlite));
+    }
+
+    return SQLITE_OK == result;
+}
+
+bool SQLiteDB::transaction_begin()
+{
+    return execute("BEGIN TRANSACTION;");
+}
+
+bool SQLiteDB::transaction_end()
+{
+    return execute("END TRANSACTION;");
+}
+
+bool SQLiteDB::savepoint_begin(const std::string & name)
+{
+    if (!is_open() || name.empty())
+    {
+        return false;
+    }
+
+    sqlite3_mutex_enter(sqlite3_db_mutex(m_sqlite));
+    const bool ret = execute("SAVEPOINT " + sqlite_quote(name) + ";");
+    if (ret && !m_change_subscribers.empty())
+    {
+        m_change_savepoints.push_back(std::make_pair(name, m_changes.size()));
+    }
+    sqlite3_mutex_leave(sqlite3_db_mutex(m_sqlite));
+
+    return ret;
+}
+
+bool SQLiteDB::savepoint_release(const std::string & name)
+{
+    if (!is_open() || name.empty())
+    {
+        return false;
+    }
+
+    // RELEASE drops the savepoint and every one opened after it, their changes are kept
+    sqlite3_mutex_enter(sqlite3_db_mutex(m_sqlite));
+    const bool ret = execute("RELEASE SAVEPOINT " + sqlite_quote(name) + ";");
+    if (ret)
+    {
+        for (change_savepoint_list_t::reverse_iterator iter = m_change_savepoints.rbegin(); m_change_savepoints.rend() != iter; ++iter)
+        {
+            if (name == iter->first)
+            {
+                m_change_savepoints.erase(iter.base() - 1, m_change_savepoints.end());
+                break;
+            }
+        }
+    }
+    sqlite3_mutex_leave(sqlite3_db_mutex(m_sqlite));
+
+    return ret;
+}
+
+bool SQLiteDB::savepoint_rollback(const std::string & name)
+{
+    if (!is_open() || name.empty())
+    {
+        return false;
+    }
+
+    // ROLLBACK TO keeps the savepoint open and drops the savepoints and the changes after it
+    sqlite3_mutex_enter(sqlite3_db_mutex(m_sqlite));
+    const bool ret = execute("ROLLBACK TRANSACTION TO SAVEPOINT " + sqlite_quote(name) + ";");
+    if (ret)
+    {
+        for (change_savepoint_list_t::reverse_iterator iter = m_change_savepoints.rbegin(); m_change_savepoints.rend() != iter; ++iter)
+        {
+            if (name == iter->first)
+            {
+                m_changes.resize(std::min(m_changes.size(), iter->second));
+                m_change_savepoints.erase(iter.base(), m_change_savepoints.end());
+                break;
+            }
+        }
+    }
+    sqlite3_mutex_leave(sqlite3_db_mutex(m_sqlite));
+
+    return ret;
+}
+
+bool SQLiteDB::wal_checkpoint(int mode, int * log_frames, int * checkpointed_frames)
+{
+    if (nullptr == m_sqlite)
+    {
+        return false;
+    }
+
+    int result = sqlite3_wal_checkpoint_v2(m_sqlite, nullptr, mode, log_frames, checkpointed_frames);
+    if (SQLITE_OK != result)
+    {
+        if (SQLITE_BUSY != result)
+        {
+            RUN_LOG_ERR("sqlite db (%s) wal checkpoint (%d) failure, error (%d: %s)", m_path.c_str(), mode, result, sqlite3_errmsg(m_sqlite));
+        }
+        return false;
+    }
+
+    return true;
+}
+
+SQLiteReader SQLiteDB::create_reader(const std::string & sql)
+{
+    return SQLiteReader(this, sql);
+}
+
+SQLiteWriter SQLiteDB::create_writer(const std::string & sql)
+{
+    return SQLiteWriter(this, sql);
+}
+
+SQLiteUpsert SQLiteDB::create_upsert(const std::string & table, const std::vector<std::string> & columns, const std::vector<std::string> & keys, SQLiteConflict conflict)
+{
+    if (table.empty() || columns.empty() || (SQLiteConflict::update == conflict && keys.empty()))
+    {
+        RUN_LOG_ERR("sqlite db (%s) create upsert failure while table (%s) or columns are invalid", m_path.c_str(), table.c_str());
+        return SQLiteUpsert();
+    }
+
+    std::vector<size_t> key_indexes;
+    std::vector<size_t> value_indexes;
+    for (size_t index = 0; index < columns.size(); ++index)
+    {
+        if (keys.end() != std::find(keys.begin(), keys.end(), columns[index]))
+        {
+            key_indexes.push_back(index);
+        }
+        else
+        {
+            value_indexes.push_back(index);
+        }
+    }
+    if (SQLiteConflict::update == conflict && key_indexes.size() != keys.size())
+    {
+        RUN_LOG_ERR("sqlite db (%s) create upsert failure while keys of table (%s) are not all in columns", m_path.c_str(), table.c_str());
+        return SQLiteUpsert();
+    }
+
+    // UPSERT needs sqlite 3.24.0 at run time, older libraries update first and insert the rows nothing was updated for
+    const bool native = SQLiteConflict::update != conflict || sqlite3_libversion_number() >= 3024000;
+    const bool fallback_update = !native && !value_indexes.empty();
+
+    // names are quoted with embedded quotes doubled, so any table or column name yields valid sql
+    std::string insert_sql(SQLiteConflict::replace == conflict ? "INSERT OR REPLACE INTO " : (SQLiteConflict::ignore == conflict || (!native && !fallback_update) ? "INSERT OR IGNORE INTO " : "INSERT INTO "));
+    insert_sql += sqlite_quote(table) + " (";
+    std::string values_sql;
+    for (size_t index = 0; index < columns.size(); ++index)
+    {
+        insert_sql += (0 == index ? "" : ", ") + sqlite_quote(columns[index]);
+        values_sql += (0 == index ? "?" : ", ?");
+        if (fallback_update)
+        {
+            values_sql += std::to_string(index + 1);
+        }
+    }
+    insert_sql += ") VALUES (" + values_sql + ")";
+
+    if (native && SQLiteConflict::update == conflict)
+    {
+        insert_sql += " ON CONFLICT (";
+        for (size_t index = 0; index < keys.size(); ++index)
+        {
+            insert_sql += (0 == index ? "" : ", ") + sqlite_quote(keys[index]);
+        }
+        if (value_indexes.empty())
+        {
+            insert_sql += ") DO NOTHING";
+        }
+        else
+        {
+            insert_sql += ") DO UPDATE SET ";
+            for (size_t index = 0; index < value_indexes.size(); ++index)
+            {
+                const std::string column = sqlite_quote(columns[value_indexes[index]]);
+                insert_sql += (0 == index ? "" : ", ") + column + " = excluded." + column;
+            }
+        }
+    }
+    insert_sql += ";";
+
+    std::string update_sql;
+    if (fallback_update)
+    {
+        update_sql = "UPDATE " + sqlite_quote(table) + " SET ";
+        for (size_t index = 0; index < value_indexes.size(); ++index)
+        {
+            update_sql += (0 == index ? "" : ", ") + sqlite_quote(columns[value_indexes[index]]) + " = ?" + std::to_string(value_indexes[index] + 1);
+        }
+        update_sql += " WHERE ";
+        for (size_t index = 0; index < key_indexes.size(); ++index)
+        {
+            update_sql += (0 == index ? "" : " AND ") + sqlite_quote(columns[key_indexes[index]]) + " = ?" + std::to_string(key_indexes[index] + 1);
+        }
+        update_sql += ";";
+    }
+
+    return SQLiteUpsert(this, insert_sql, update_sql);
+}
+
+SQLiteBlob SQLiteDB::open_blob(const std::string & table, const std::string & column, int64_t rowid, bool writable)
+{
+    return SQLiteBlob(m_sqlite, table, column, rowid, writable);
+}
+
+void SQLiteDB::set_statement_cache(size_t capacity)
+{
+    if (m_statement_cache)
+    {
+        std::lock_guard<std::mutex> locker(m_statement_cache->mutex);
+        m_statement_cache->capacity = capacity;
+        shrink_statement_cache(*m_statement_cache, capacity);
+    }
+}
+
+void SQLiteDB::get_statement_cache_stats(SQLiteCacheStats & stats) const
+{
+    memset(&stats, 0, sizeof(stats));
+    if (m_statement_cache)
+    {
+        std::lock_guard<std::mutex> locker(m_statement_cache->mutex);
+        stats.hits = m_statement_cache->hits;
+        stats.misses = m_statement_cache->misses;
+        stats.evictions = m_statement_cache->evictions;
+        stats.size = m_statement_cache->list.size();
+        stats.capacity = m_statement_cache->capacity;
+        stats.borrowed = m_statement_cache->borrowed;
+    }
+}
+
+void SQLiteDB::clear_statement_cache()
+{
+    if (m_statement_cache)
+    {
+        std::lock_guard<std::mutex> locker(m_statement_cache->mutex);
+        while (!m_statement_cache->list.empty())
+        {
+            sqlite3_finalize(m_statement_cache->list.back().second);
+            m_statement_cache->list.pop_back();
+        }
+        m_statement_cache->map.clear();
+    }
+}
+
+bool SQLiteDB::register_function(const std::string & name, int arg_count, const SQLiteScalarFunction & function, bool deterministic)
+{
+    if (nullptr == m_sqlite || name.empty() || !function)
+    {
+        return false;
+    }
+
+    // sqlite owns the copy from here on, it calls the destroy callback on failure as well
+    SQLiteScalarFunction * scalar = new SQLiteScalarFunction(function);
+    const int flags = SQLITE_UTF8 | (deterministic ? SQLITE_DETERMINISTIC : 0);
+    int result = sqlite3_create_function_v2(m_sqlite, name.c_str(), arg_count, flags, scalar, &SQLiteDB::function_scalar, nullptr, nullptr, &SQLiteDB::function_destroy_scalar);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite db (%s) register function (%s) failure, error (%d: %s)", m_path.c_str(), name.c_str(), result, sqlite3_errmsg(m_sqlite));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteDB::register_aggregate(const std::string & name, int arg_count, const SQLiteAggregateFactory & factory, bool deterministic)
+{
+    if (nullptr == m_sqlite || name.empty() || !factory)
+    {
+        return false;
+    }
+
+    SQLiteAggregateFactory * aggregate = new SQLiteAggregateFactory(factory);
+    const int flags = SQLITE_UTF8 | (deterministic ? SQLITE_DETERMINISTIC : 0);
+    int result = sqlite3_create_function_v2(m_sqlite, name.c_str(), arg_count, flags, aggregate, nullptr, &SQLiteDB::function_step, &SQLiteDB::function_final, &SQLiteDB::function_destroy_aggregate);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite db (%s) register aggregate (%s) failure, error (%d: %s)", m_path.c_str(), name.c_str(), result, sqlite3_errmsg(m_sqlite));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteDB::register_window(const std::string & name, int arg_count, const SQLiteAggregateFactory & factory, bool deterministic)
+{
+    if (nullptr == m_sqlite || name.empty() || !factory)
+    {
+        return false;
+    }
+
+#if SQLITE_VERSION_NUMBER >= 3025000
+    SQLiteAggregateFactory * aggregate = new SQLiteAggregateFactory(factory);
+    const int flags = SQLITE_UTF8 | (deterministic ? SQLITE_DETERMINISTIC : 0);
+    int result = sqlite3_create_window_function(m_sqlite, name.c_str(), arg_count, flags, aggregate, &SQLiteDB::function_step, &SQLiteDB::function_final, &SQLiteDB::function_value, &SQLiteDB::function_inverse, &SQLiteDB::function_destroy_aggregate);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite db (%s) register window (%s) failure, error (%d: %s)", m_path.c_str(), name.c_str(), result, sqlite3_errmsg(m_sqlite));
+        return false;
+    }
+
+    return true;
+#else
+    PARAMS_IGN(arg_count, deterministic);
+    RUN_LOG_ERR("sqlite db (%s) register window (%s) failure while sqlite (%s) has no window functions", m_path.c_str(), name.c_str(), SQLITE_VERSION);
+    return false;
+#endif // SQLITE_VERSION_NUMBER >= 3025000
+}
+
+bool SQLiteDB::unregister_function(const std::string & name, int arg_count)
+{
+    if (nullptr == m_sqlite || name.empty())
+    {
+        return false;
+    }
+
+    int result = sqlite3_create_function_v2(m_sqlite, name.c_str(), arg_count, SQLITE_UTF8, nullptr, nullptr, nullptr, nullptr, nullptr);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite db (%s) unregister function (%s) failure, error (%d: %s)", m_path.c_str(), name.c_str(), result, sqlite3_errmsg(m_sqlite));
+        return false;
+    }
+
+    return true;
+}
+
+void SQLiteDB::function_scalar(sqlite3_context * context, int count, sqlite3_value ** values)
+{
+    SQLiteScalarFunction * function = reinterpret_cast<SQLiteScalarFunction *>(sqlite3_user_data(context));
+    const SQLiteFunctionArgs args(count, values);
+    SQLiteFunctionResult result(context);
+    (*function)(args, result);
+}
+
+void SQLiteDB::function_step(sqlite3_context * context, int count, sqlite3_value ** values)
+{
+    SQLiteAggregate ** aggregate = reinterpret_cast<SQLiteAggregate **>(sqlite3_aggregate_context(context, sizeof(SQLiteAggregate *)));
+    if (nullptr == aggregate)
+    {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+
+    // the aggregate context is zeroed on the first call of each group
+    if (nullptr == *aggregate)
+    {
+        SQLiteAggregateFactory * factory = reinterpret_cast<SQLiteAggregateFactory *>(sqlite3_user_data(context));
+        *aggregate = (*factory)();
+        if (nullptr == *aggregate)
+        {
+            sqlite3_result_error(context, "aggregate factory returns null", -1);
+            return;
+        }
+    }
+
+    (*aggregate)->step(SQLiteFunctionArgs(count, values));
+}
+
+void SQLiteDB::function_inverse(sqlite3_context * context, int count, sqlite3_value ** values)
+{
+    SQLiteAggregate ** aggregate = reinterpret_cast<SQLiteAggregate **>(sqlite3_aggregate_context(context, 0));
+    if (nullptr != aggregate && nullptr != *aggregate)
+    {
+        (*aggregate)->inverse(SQLiteFunctionArgs(count, values));
+    }
+}
+
+void SQLiteDB::function_value(sqlite3_context * context)
+{
+    SQLiteAggregate ** aggregate = reinterpret_cast<SQLiteAggregate **>(sqlite3_aggregate_context(context, 0));
+    if (nullptr == aggregate || nullptr == *aggregate)
+    {
+        std::unique_ptr<SQLiteAggregate> empty((*reinterpret_cast<SQLiteAggregateFactory *>(sqlite3_user_data(context)))());
+        SQLiteFunctionResult result(context);
+        if (empty)
+        {
+            empty->value(result);
+        }
+        else
+        {
+            result.set_null();
+        }
+        return;
+    }
+
+    SQLiteFunctionResult result(context);
+    (*aggregate)->value(result);
+}
+
+void SQLiteDB::function_final(sqlite3_context * context)
+{
+    function_value(context);
+
+    SQLiteAggregate ** aggregate = reinterpret_cast<SQLiteAggregate **>(sqlite3_aggregate_context(context, 0));
+    if (nullptr != aggregate)
+    {
+        delete *aggregate;
+        *aggregate = nullptr;
+    }
+}
+
+void SQLiteDB::function_destroy_scalar(void * function)
+{
+    delete reinterpret_cast<SQLiteScalarFunction *>(function);
+}
+
+void SQLiteDB::function_destroy_aggregate(void * factory)
+{
+    delete reinterpret_cast<SQLiteAggregateFactory *>(factory);
+}
+
+bool SQLiteDB::register_kv_table(const std::string & table, SQLiteKVStore & store)
+{
+    if (nullptr == m_sqlite || table.empty())
+    {
+        return false;
+    }
+
+    if (!unregister_kv_table(table))
+    {
+        return false;
+    }
+
+    // one module is created per connection, sqlite before 3.25 rejects creating a module name twice
+    if (!m_kv_module)
+    {
+        int result = sqlite3_create_module_v2(m_sqlite, s_kv_module_name, &s_kv_module, &m_kv_stores, nullptr);
+        if (SQLITE_OK != result)
+        {
+            RUN_LOG_ERR("sqlite db (%s) register kv table (%s) failure while create module failed, error (%d: %s)", m_path.c_str(), table.c_str(), result, sqlite3_errmsg(m_sqlite));
+            return false;
+        }
+        m_kv_module = true;
+    }
+
+    // the table lives in the temp schema so the database file never refers to it
+    m_kv_stores[kv_store_key(table)] = &store;
+    if (!execute("CREATE VIRTUAL TABLE temp." + sqlite_quote(table) + " USING " + s_kv_module_name + ";"))
+    {
+        RUN_LOG_ERR("sqlite db (%s) register kv table (%s) failure while create table failed", m_path.c_str(), table.c_str());
+        m_kv_stores.erase(kv_store_key(table));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteDB::unregister_kv_table(const std::string & table)
+{
+    if (nullptr == m_sqlite || table.empty())
+    {
+        return false;
+    }
+
+    if (!execute("DROP TABLE IF EXISTS temp." + sqlite_quote(table) + ";"))
+    {
+        return false;
+    }
+
+    m_kv_stores.erase(kv_store_key(table));
+
+    return true;
+}
+
+bool SQLiteDB::set_profile(bool enable)
+{
+    if (nullptr == m_sqlite)
+    {
+        return false;
+    }
+
+    if (!set_trace(enable, !m_change_subscribers.empty()))
+    {
+        RUN_LOG_ERR("sqlite db (%s) set profile (%s) failure", m_path.c_str(), enable ? "on" : "off");
+        return false;
+    }
+
+    m_profiling = enable;
+
+    return true;
+}
+
+bool SQLiteDB::set_trace(bool profile, bool changes)
+{
+    // profiling and change notifications share the one trace callback of the connection
+    const unsigned int mask = (profile || changes ? SQLITE_TRACE_PROFILE : 0) | (changes ? SQLITE_TRACE_STMT : 0);
+    int result = 0 != mask
+        ? sqlite3_trace_v2(m_sqlite, mask, &SQLiteDB::trace_callback, this)
+        : sqlite3_trace_v2(m_sqlite, 0, nullptr, nullptr);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite db (%s) set trace failure, error (%d: %s)", m_path.c_str(), result, sqlite3_errstr(result));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteDB::is_profiling() const
+{
+    return m_profiling;
+}
+
+void SQLiteDB::get_profile(std::vector<SQLiteProfileEntry> & entries, size_t top_n) const
+{
+    entries.clear();
+    entries.reserve(m_profile.size());
+    for (profile_map_t::const_iterator iter = m_profile.begin(); m_profile.end() != iter; ++iter)
+    {
+        entries.push_back(iter->second);
+    }
+
+    const size_t count = std::min(top_n, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end(), [](const SQLiteProfileEntry & lhs, const SQLiteProfileEntry & rhs) {
+        return lhs.total_ns > rhs.total_ns;
+    });
+    entries.resize(count);
+}
+
+void SQLiteDB::clear_profile()
+{
+    m_profile.clear();
+}
+
+int SQLiteDB::trace_callback(unsigned int type, void * context, void * statement, void * detail)
+{
+    if (nullptr == context || nullptr == statement)
+    {
+        return 0;
+    }
+
+    SQLiteDB * db = reinterpret_cast<SQLiteDB *>(context);
+    if (SQLITE_TRACE_STMT == type)
+    {
+        db->change_statement(statement, reinterpret_cast<const char *>(detail));
+        return 0;
+    }
+
+    if (db->m_profiling)
+    {
+        profile_callback(type, context, statement, detail);
+    }
+
+    if (SQLITE_TRACE_PROFILE == type && !db->m_change_marks.empty())
+    {
+        db->change_finished(statement);
+    }
+
+    // a statement that finished back in autocommit mode has committed, a COMMIT that failed with BUSY keeps its transaction
+    if (SQLITE_TRACE_PROFILE == type && !db->m_committed_changes.empty() && 0 != sqlite3_get_autocommit(db->m_sqlite))
+    {
+        db->deliver_changes();
+    }
+
+    return 0;
+}
+
+int SQLiteDB::profile_callback(unsigned int type, void * context, void * statement, void * elapsed)
+{
+    if (SQLITE_TRACE_PROFILE != type || nullptr == context || nullptr == statement || nullptr == elapsed)
+    {
+        return 0;
+    }
+
+    SQLiteDB * db = reinterpret_cast<SQLiteDB *>(context);
+    sqlite3_stmt * stmt = reinterpret_cast<sqlite3_stmt *>(statement);
+    const uint64_t elapsed_ns = static_cast<uint64_t>(*reinterpret_cast<sqlite3_int64 *>(elapsed));
+
+    const char * sql = sqlite3_sql(stmt);
+    if (nullptr == sql)
+    {
+        return 0;
+    }
+
+    profile_map_t::iterator iter = db->m_profile.find(sql);
+    if (db->m_profile.end() == iter)
+    {
+        SQLiteProfileEntry entry;
+        entry.sql = sql;
+        entry.calls = 0;
+        entry.total_ns = 0;
+        entry.max_ns = 0;
+        std::fill(entry.histogram, entry.histogram + SQLiteProfileEntry::histogram_size, 0);
+        entry.fullscan_steps = 0;
+        entry.sorts = 0;
+        entry.autoindexes = 0;
+        entry.vm_steps = 0;
+        iter = db->m_profile.insert(std::make_pair(entry.sql, entry)).first;
+    }
+
+    SQLiteProfileEntry & entry = iter->second;
+    entry.calls += 1;
+    entry.total_ns += elapsed_ns;
+    entry.max_ns = std::max(entry.max_ns, elapsed_ns);
+
+    size_t bucket = 0;
+    for (uint64_t elapsed_us = elapsed_ns / 1000; 0 != elapsed_us && bucket + 1 < SQLiteProfileEntry::histogram_size; elapsed_us >>= 1)
+    {
+        ++bucket;
+    }
+    entry.histogram[bucket] += 1;
+
+    // the counters are reset on read, so each run adds only its own work
+    entry.fullscan_steps += static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1));
+    entry.sorts += static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1));
+    entry.autoindexes += static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1));
+    entry.vm_steps += static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1));
+
+    return 0;
+}
+
+uint32_t SQLiteDB::subscribe_changes(const SQLiteChangeListener & listener, const std::string & table)
+{
+    if (nullptr == m_sqlite || !listener)
+    {
+        return 0;
+    }
+
+    if (m_change_subscribers.empty() && !set_change_hooks(true))
+    {
+        return 0;
+    }
+
+    change_subscriber_t subscriber;
+    subscriber.id = (0 == ++m_change_sequence ? ++m_change_sequence : m_change_sequence);
+    subscriber.table = table;
+    subscriber.listener = listener;
+    m_change_subscribers.push_back(subscriber);
+
+    return subscriber.id;
+}
+
+bool SQLiteDB::unsubscribe_changes(uint32_t subscription)
+{
+    for (change_subscriber_list_t::iterator iter = m_change_subscribers.begin(); m_change_subscribers.end() != iter; ++iter)
+    {
+        if (subscription != iter->id || !iter->listener)
+        {
+            continue;
+        }
+
+        // a listener may unsubscribe while the changes are delivered, the entry is erased after the delivery
+        if (m_change_delivering)
+        {
+            iter->listener = nullptr;
+            return true;
+        }
+
+        m_change_subscribers.erase(iter);
+        if (m_change_subscribers.empty())
+        {
+            set_change_hooks(false);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool SQLiteDB::set_change_hooks(bool enable)
+{
+    if (nullptr == m_sqlite)
+    {
+        return false;
+    }
+
+    void * context = enable ? this : nullptr;
+    sqlite3_update_hook(m_sqlite, enable ? &SQLiteDB::change_update_hook : nullptr, context);
+    sqlite3_commit_hook(m_sqlite, enable ? &SQLiteDB::change_commit_hook : nullptr, context);
+    sqlite3_rollback_hook(m_sqlite, enable ? &SQLiteDB::change_rollback_hook : nullptr, context);
+    m_changes.clear();
+    m_change_savepoints.clear();
+    m_change_marks.clear();
+    m_change_finished = change_mark_t();
+    m_committed_changes.clear();
+
+    return set_trace(m_profiling, enable);
+}
+
+void SQLiteDB::change_update_hook(void * context, int op, const char * database, const char * table, long long rowid)
+{
+    if (nullptr == context || nullptr == table)
+    {
+        return;
+    }
+
+    // not called for WITHOUT ROWID tables or a DELETE without WHERE that truncates the table
+    SQLiteDB * db = reinterpret_cast<SQLiteDB *>(context);
+    for (change_subscriber_list_t::const_iterator iter = db->m_change_subscribers.begin(); db->m_change_subscribers.end() != iter; ++iter)
+    {
+        if (iter->listener && (iter->table.empty() || iter->table == table))
+        {
+            SQLiteChange change;
+            change.op = (SQLITE_INSERT == op ? SQLiteChangeOp::insert : (SQLITE_DELETE == op ? SQLiteChangeOp::remove : SQLiteChangeOp::update));
+            change.table = table;
+            change.rowid = static_cast<int64_t>(rowid);
+            db->m_changes.push_back(change);
+            break;
+        }
+    }
+}
+
+int SQLiteDB::change_commit_hook(void * context)
+{
+    if (nullptr == context)
+    {
+        return 0;
+    }
+
+    // the changes are delivered once the commit has succeeded, not from inside it
+    SQLiteDB * db = reinterpret_cast<SQLiteDB *>(context);
+    if (db->m_committed_changes.empty())
+    {
+        db->m_committed_changes.swap(db->m_changes);
+    }
+    else
+    {
+        db->m_committed_changes.insert(db->m_committed_changes.end(), db->m_changes.begin(), db->m_changes.end());
+        db->m_changes.clear();
+    }
+    db->m_change_savepoints.clear();
+    db->m_change_marks.clear();
+    db->m_change_finished = change_mark_t();
+
+    return 0;
+}
+
+void SQLiteDB::deliver_changes()
+{
+    std::vector<SQLiteChange> changes;
+    changes.swap(m_committed_changes);
+
+    m_change_delivering = true;
+    std::vector<SQLiteChange> table_changes;
+    for (change_subscriber_list_t::iterator iter = m_change_subscribers.begin(); m_change_subscribers.end() != iter; ++iter)
+    {
+        if (!iter->listener)
+        {
+            continue;
+        }
+
+        if (iter->table.empty())
+        {
+            iter->listener(changes);
+            continue;
+        }
+
+        table_changes.clear();
+        for (std::vector<SQLiteChange>::const_iterator change = changes.begin(); changes.end() != change; ++change)
+        {
+            if (iter->table == change->table)
+            {
+                table_changes.push_back(*change);
+            }
+        }
+        if (!table_changes.empty())
+        {
+            iter->listener(table_changes);
+        }
+    }
+    m_change_delivering = false;
+
+    // hooks are left installed even if no subscriber remains, they must not be changed inside the statement
+    for (change_subscriber_list_t::iterator iter = m_change_subscribers.begin(); m_change_subscribers.end() != iter; )
+    {
+        if (iter->listener)
+        {
+            ++iter;
+        }
+        else
+        {
+            iter = m_change_subscribers.erase(iter);
+        }
+    }
+
+    // reuse the buffer for the next transaction
+    if (m_committed_changes.empty())
+    {
+        changes.clear();
+        m_committed_changes.swap(changes);
+    }
+}
+
+void SQLiteDB::change_rollback_hook(void * context)
+{
+    if (nullptr != context)
+    {
+        SQLiteDB * db = reinterpret_cast<SQLiteDB *>(context);
+        db->m_changes.clear();
+        db->m_change_savepoints.clear();
+        db->m_change_marks.clear();
+        db->m_change_finished = change_mark_t();
+        db->m_committed_changes.clear();
+    }
+}
+
+void SQLiteDB::change_statement(void * statement, const char * sql)
+{
+    // trigger programs are traced as "-- " comments of the statement that fires them
+    if (nullptr != sql && '-' == sql[0] && '-' == sql[1])
+    {
+        return;
+    }
+
+    for (change_mark_list_t::iterator iter = m_change_marks.begin(); m_change_marks.end() != iter; ++iter)
+    {
+        if (statement == iter->statement)
+        {
+            iter->begin = m_changes.size();
+            return;
+        }
+    }
+
+    change_mark_t mark;
+    mark.statement = statement;
+    mark.begin = m_changes.size();
+    mark.end = mark.begin;
+    m_change_marks.push_back(mark);
+}
+
+void SQLiteDB::change_finished(void * statement)
+{
+    for (change_mark_list_t::iterator iter = m_change_marks.begin(); m_change_marks.end() != iter; ++iter)
+    {
+        if (statement == iter->statement)
+        {
+            m_change_finished = *iter;
+            m_change_finished.end = m_changes.size();
+            m_change_marks.erase(iter);
+            return;
+        }
+    }
+}
+
+void SQLiteDB::discard_changes(sqlite3_stmt * statement)
+{
+    // an aborted statement undoes its rows without the rollback hook, an OR FAIL conflict keeps the rows it counted
+    sqlite3_mutex_enter(sqlite3_db_mutex(m_sqlite));
+    if (nullptr != statement && statement == m_change_finished.statement && m_change_finished.end == m_changes.size() && 0 == sqlite3_changes(m_sqlite))
+    {
+        m_changes.resize(std::min(m_changes.size(), m_change_finished.begin));
+    }
+    m_change_finished = change_mark_t();
+    sqlite3_mutex_leave(sqlite3_db_mutex(m_sqlite));
+}
+
+void SQLiteDB::discard_statement_changes(const statement_cache_ptr_t & cache, sqlite3_stmt * statement)
+{
+    if (!cache)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> locker(cache->mutex);
+    if (nullptr != cache->db)
+    {
+        cache->db->discard_changes(statement);
+    }
+}
+
+sqlite3_stmt * SQLiteDB::acquire_statement(const statement_cache_ptr_t & cache, const std::string & sql, bool writer)
+{
+    if (!cache || sql.empty())
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> locker(cache->mutex);
+
+    if (nullptr == cache->sqlite)
+    {
+        return nullptr;
+    }
+
+    sqlite3_stmt * statement = nullptr;
+
+    statement_map_t::iterator iter = cache->map.find(sql);
+    if (cache->map.end() != iter)
+    {
+        statement = iter->second->second;
+        cache->list.erase(iter->second);
+        cache->map.erase(iter);
+        ++cache->hits;
+    }
+    else
+    {
+        int result = sqlite3_prepare_v2(cache->sqlite, sql.c_str(), static_cast<int>(sql.size()), &statement, nullptr);
+        if (SQLITE_OK != result)
+        {
+            RUN_LOG_ERR("sqlite %s (%s) create failure while prepare failed, error (%d: %s)", writer ? "writer" : "reader", sql.c_str(), result, sqlite3_errstr(result));
+            return nullptr;
+        }
+        ++cache->misses;
+    }
+
+    ++cache->borrowed;
+
+    return statement;
+}
+
+void SQLiteDB::release_statement(const statement_cache_ptr_t & cache, const std::string & sql, sqlite3_stmt * statement)
+{
+    if (!cache || nullptr == statement)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> locker(cache->mutex);
+
+    // the connection of a closed db lives on as a zombie until its last statement is finalized
+    if (nullptr == cache->sqlite)
+    {
+        sqlite3_finalize(statement);
+        return;
+    }
+
+    --cache->borrowed;
+
+    sqlite3_reset(statement);
+    sqlite3_clear_bindings(statement);
+
+    if (0 == cache->capacity || cache->map.end() != cache->map.find(sql))
+    {
+        sqlite3_finalize(statement);
+        return;
+    }
+
+    cache->list.emplace_front(sql, statement);
+    cache->map[sql] = cache->list.begin();
+
+    shrink_statement_cache(*cache, cache->capacity);
+}
+
+void SQLiteDB::shrink_statement_cache(statement_cache_t & cache, size_t capacity)
+{
+    while (cache.list.size() > capacity)
+    {
+        cache.map.erase(cache.list.back().first);
+        sqlite3_finalize(cache.list.back().second);
+        cache.list.pop_back();
+        ++cache.evictions;
+    }
+}
+
+SQLiteStatement::SQLiteStatement()
+    : m_sql()
+    , m_cache()
+    , m_sqlite(nullptr)
+    , m_writer(false)
+    , m_statement(nullptr)
+    , m_set_index(0)
+    , m_get_index(0)
+    , m_parameter_count(0)
+    , m_row_parameter_count(0)
+    , m_column_count(0)
+    , m_done(false)
+    , m_parameters()
+{
+
+}
+
+SQLiteStatement::SQLiteStatement(sqlite3 * sqlite, const std::string & sql, bool writer)
+    : m_sql()
+    , m_cache()
+    , m_sqlite(nullptr)
+    , m_writer(false)
+    , m_statement(nullptr)
+    , m_set_index(0)
+    , m_get_index(0)
+    , m_parameter_count(0)
+    , m_row_parameter_count(0)
+    , m_column_count(0)
+    , m_done(false)
+    , m_parameters()
+{
+    if (nullptr != sqlite && !sql.empty())
+    {
+        sqlite3_stmt * statement = nullptr;
+        int result = sqlite3_prepare_v2(sqlite, sql.c_str(), static_cast<int>(sql.size()), &statement, nullptr);
+        if (SQLITE_OK == result)
+        {
+            m_sql = sql;
+            m_sqlite = sqlite;
+            m_writer = writer;
+            m_statement = statement;
+            m_parameter_count = sqlite3_bind_parameter_count(statement);
+            m_row_parameter_count = m_parameter_count;
+            m_column_count = sqlite3_column_count(statement);
+        }
+        else
+        {
+            RUN_LOG_ERR("sqlite %s (%s) create failure while prepare failed, error (%d: %s)", writer ? "writer" : "reader", sql.c_str(), result, sqlite3_errstr(result));
+        }
+    }
+}
+
+SQLiteStatement::SQLiteStatement(SQLiteDB * db, const std::string & sql, bool writer)
+    : m_sql()
+    , m_cache()
+    , m_sqlite(nullptr)
+    , m_writer(false)
+    , m_statement(nullptr)
+    , m_set_index(0)
+    , m_get_index(0)
+    , m_parameter_count(0)
+    , m_row_parameter_count(0)
+    , m_column_count(0)
+    , m_done(false)
+    , m_parameters()
+{
+    if (nullptr != db)
+    {
+        open(db->m_statement_cache, sql, writer);
+    }
+}
+
+SQLiteStatement::SQLiteStatement(SQLiteStatement && other)
+    : m_sql()
+    , m_cache()
+    , m_sqlite(nullptr)
+    , m_writer(false)
+    , m_statement(nullptr)
+    , m_set_index(0)
+    , m_get_index(0)
+    , m_parameter_count(0)
+    , m_row_parameter_count(0)
+    , m_column_count(0)
+    , m_done(false)
+    , m_parameters()
+{
+    std::swap(m_sql, other.m_sql);
+    std::swap(m_cache, other.m_cache);
+    std::swap(m_sqlite, other.m_sqlite);
+    std::swap(m_writer, other.m_writer);
+    std::swap(m_statement, other.m_statement);
+    std::swap(m_set_index, other.m_set_index);
+    std::swap(m_get_index, other.m_get_index);
+    std::swap(m_parameter_count, other.m_parameter_count);
+    std::swap(m_row_parameter_count, other.m_row_parameter_count);
+    std::swap(m_column_count, other.m_column_count);
+    std::swap(m_done, other.m_done);
+    std::swap(m_parameters, other.m_parameters);
+}
+
+SQLiteStatement & SQLiteStatement::operator = (SQLiteStatement && other)
+{
+    if (&other != this)
+    {
+        clear();
+        std::swap(m_sql, other.m_sql);
+        std::swap(m_cache, other.m_cache);
+        std::swap(m_sqlite, other.m_sqlite);
+        std::swap(m_writer, other.m_writer);
+        std::swap(m_statement, other.m_statement);
+        std::swap(m_set_index, other.m_set_index);
+        std::swap(m_get_index, other.m_get_index);
+        std::swap(m_parameter_count, other.m_parameter_count);
+        std::swap(m_row_parameter_count, other.m_row_parameter_count);
+        std::swap(m_column_count, other.m_column_count);
+        std::swap(m_done, other.m_done);
+        std::swap(m_parameters, other.m_parameters);
+    }
+    return *this;
+}
+
+SQLiteStatement::~SQLiteStatement()
+{
+    clear();
+}
+
+bool SQLiteStatement::good() const
+{
+    return nullptr != m_statement;
+}
+
+void SQLiteStatement::clear()
+{
+    if (nullptr != m_statement)
+    {
+        if (m_cache)
+        {
+            SQLiteDB::release_statement(m_cache, m_sql, m_statement);
+        }
+        else
+        {
+            int result = sqlite3_finalize(m_statement);
+            if (SQLITE_OK != result)
+            {
+                RUN_LOG_ERR("sqlite %s (%s) clear failure while finalize failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+            }
+        }
+        m_sql.clear();
+        m_cache.reset();
+        m_sqlite = nullptr;
+        m_writer = false;
+        m_statement = nullptr;
+        m_set_index = 0;
+        m_get_index = 0;
+        m_parameter_count = 0;
+        m_row_parameter_count = 0;
+        m_column_count = 0;
+        m_done = false;
+        m_parameters.clear();
+    }
+}
+
+bool SQLiteStatement::reset()
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    m_set_index = 0;
+    m_done = false;
+
+    int result = sqlite3_reset(m_statement);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite %s (%s) reset failure while reset failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteStatement::set(int index, int value)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    int result = sqlite3_bind_int(m_statement, index + 1, value);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite %s (%s) set failure while bind failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteStatement::set(int index, int64_t value)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    int result = sqlite3_bind_int64(m_statement, index + 1, value);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite %s (%s) set failure while bind failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteStatement::set(int index, double value)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    int result = sqlite3_bind_double(m_statement, index + 1, value);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite %s (%s) set failure while bind failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteStatement::set(int index, const char * data, size_t size, bool blob, bool copy)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    if (nullptr == data)
+    {
+        data = "";
+        size = 0;
+    }
+
+    int result = blob
+        ? sqlite3_bind_blob(m_statement, index + 1, data, static_cast<int>(size), copy ? SQLITE_TRANSIENT : SQLITE_STATIC)
+        : sqlite3_bind_text(m_statement, index + 1, data, static_cast<int>(size), copy ? SQLITE_TRANSIENT : SQLITE_STATIC);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite %s (%s) set failure while bind failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteStatement::set_zeroblob(int index, size_t size)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    int result = sqlite3_bind_zeroblob(m_statement, index + 1, static_cast<int>(size));
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite %s (%s) set failure while bind failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteStatement::set_null(int index)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    int result = sqlite3_bind_null(m_statement, index + 1);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite %s (%s) set failure while bind failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteStatement::set(bool value)
+{
+    return set(m_set_index++, static_cast<int>(value));
+}
+
+bool SQLiteStatement::set(int8_t value)
+{
+    return set(m_set_index++, static_cast<int>(value));
+}
+
+bool SQLiteStatement::set(uint8_t value)
+{
+    return set(m_set_index++, static_cast<int>(value));
+}
+
+bool SQLiteStatement::set(int16_t value)
+{
+    return set(m_set_index++, static_cast<int>(value));
+}
+
+bool SQLiteStatement::set(uint16_t value)
+{
+    return set(m_set_index++, static_cast<int>(value));
+}
+
+bool SQLiteStatement::set(int32_t value)
+{
+    return set(m_set_index++, static_cast<int>(value));
+}
+
+bool SQLiteStatement::set(uint32_t value)
+{
+    return set(m_set_index++, static_cast<int>(value));
+}
+
+bool SQLiteStatement::set(int64_t value)
+{
+    return set(m_set_index++, value);
+}
+
+bool SQLiteStatement::set(uint64_t value)
+{
+    return set(m_set_index++, static_cast<int64_t>(value));
+}
+
+bool SQLiteStatement::set(float value)
+{
+    return set(m_set_index++, static_cast<double>(value));
+}
+
+bool SQLiteStatement::set(double value)
+{
+    return set(m_set_index++, value);
+}
+
+bool SQLiteStatement::set(const char * value, bool copy)
+{
+    return set(m_set_index++, value, nullptr != value ? strlen(value) : 0, false, copy);
+}
+
+bool SQLiteStatement::set(const std::string & value, bool copy)
+{
+    return set(m_set_index++, value.data(), value.size(), false, copy);
+}
+
+bool SQLiteStatement::set(const SQLiteView & value, bool copy)
+{
+    return set(m_set_index++, value.data, value.size, false, copy);
+}
+
+bool SQLiteStatement::set_blob(const void * data, size_t size, bool copy)
+{
+    return set(m_set_index++, reinterpret_cast<const char *>(data), size, true, copy);
+}
+
+bool SQLiteStatement::set_blob(const std::string & value, bool copy)
+{
+    return set(m_set_index++, value.data(), value.size(), true, copy);
+}
+
+bool SQLiteStatement::set_zeroblob(size_t size)
+{
+    return set_zeroblob(m_set_index++, size);
+}
+
+bool SQLiteStatement::set_null()
+{
+    return set_null(m_set_index++);
+}
+
+int SQLiteStatement::parameter(const std::string & name)
+{
+    if (nullptr == m_statement)
+    {
+        return -1;
+    }
+
+    parameter_map_t::const_iterator iter = m_parameters.find(name);
+    if (m_parameters.end() != iter)
+    {
+        return iter->second;
+    }
+
+    int index = sqlite3_bind_parameter_index(m_statement, name.c_str()) - 1;
+    if (index < 0)
+    {
+        RUN_LOG_ERR("sqlite %s (%s) parameter failure while name (%s) is not found", m_writer ? "writer" : "reader", m_sql.c_str(), name.c_str());
+    }
+    m_parameters[name] = index;
+
+    return index;
+}
+
+bool SQLiteStatement::seek(int index)
+{
+    if (nullptr == m_statement || index < 0 || index >= sqlite3_bind_parameter_count(m_statement))
+    {
+        return false;
+    }
+
+    m_set_index = index;
+
+    return true;
+}
+
+bool SQLiteStatement::seek(const std::string & name)
+{
+    return seek(parameter(name));
+}
+
+bool SQLiteStatement::open(const SQLiteDB::statement_cache_ptr_t & cache, const std::string & sql, bool writer)
+{
+    sqlite3_stmt * statement = SQLiteDB::acquire_statement(cache, sql, writer);
+    if (nullptr == statement)
+    {
+        return false;
+    }
+
+    m_sql = sql;
+    m_cache = cache;
+    m_sqlite = sqlite3_db_handle(statement);
+    m_writer = writer;
+    m_statement = statement;
+    m_parameter_count = sqlite3_bind_parameter_count(statement);
+    m_row_parameter_count = m_parameter_count;
+    m_column_count = sqlite3_column_count(statement);
+
+    return true;
+}
+
+void SQLiteStatement::discard_changes()
+{
+    SQLiteDB::discard_statement_changes(m_cache, m_statement);
+}
+
+bool SQLiteStatement::check_parameters(int start, int count) const
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    if (count != m_row_parameter_count || (0 != count && 0 != start % count) || start + count > m_parameter_count)
+    {
+        RUN_LOG_ERR("sqlite %s (%s) bind row failure while bind (%d) parameters at (%d) of (%d) parameters in rows of (%d)", m_writer ? "writer" : "reader", m_sql.c_str(), count, start, m_parameter_count, m_row_parameter_count);
+        return false;
+    }
+
+    return true;
+}
+
+bool SQLiteStatement::bind(int index, bool value)
+{
+    return set(index, static_cast<int>(value));
+}
+
+bool SQLiteStatement::bind(int index, int8_t value)
+{
+    return set(index, static_cast<int>(value));
+}
+
+bool SQLiteStatement::bind(int index, uint8_t value)
+{
+    return set(index, static_cast<int>(value));
+}
+
+bool SQLiteStatement::bind(int index, int16_t value)
+{
+    return set(index, static_cast<int>(value));
+}
+
+bool SQLiteStatement::bind(int index, uint16_t value)
+{
+    return set(index, static_cast<int>(value));
+}
+
+bool SQLiteStatement::bind(int index, int32_t value)
+{
+    return set(index, static_cast<int>(value));
+}
+
+bool SQLiteStatement::bind(int index, uint32_t value)
+{
+    return set(index, static_cast<int>(value));
+}
+
+bool SQLiteStatement::bind(int index, int64_t value)
+{
+    return set(index, value);
+}
+
+bool SQLiteStatement::bind(int index, uint64_t value)
+{
+    return set(index, static_cast<int64_t>(value));
+}
+
+bool SQLiteStatement::bind(int index, float value)
+{
+    return set(index, static_cast<double>(value));
+}
+
+bool SQLiteStatement::bind(int index, double value)
+{
+    return set(index, value);
+}
+
+bool SQLiteStatement::bind(int index, const char * value)
+{
+    return set(index, value, nullptr != value ? strlen(value) : 0, false, true);
+}
+
+bool SQLiteStatement::bind(int index, const std::string & value)
+{
+    return set(index, value.data(), value.size(), false, true);
+}
+
+bool SQLiteStatement::bind(int index, const SQLiteView & value)
+{
+    return set(index, value.data, value.size, false, true);
+}
+
+SQLiteReader::SQLiteReader()
+    : SQLiteStatement()
+{
+
+}
+
+SQLiteReader::SQLiteReader(sqlite3 * sqlite, const std::string & sql)
+    : SQLiteStatement(sqlite, sql, false)
+{
+
+}
+
+SQLiteReader::SQLiteReader(SQLiteDB * db, const std::string & sql)
+    : SQLiteStatement(db, sql, false)
+{
+
+}
+
+bool SQLiteReader::read()
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    m_get_index = 0;
+
+    int result = sqlite3_step(m_statement);
+    if (SQLITE_ROW != result && SQLITE_DONE != result)
+    {
+        discard_changes();
+        RUN_LOG_ERR("sqlite reader (%s) read failure while step failed, error (%d: %s, %d: %s)", m_sql.c_str(), result, sqlite3_errstr(result), sqlite3_errcode(m_sqlite), sqlite3_errmsg(m_sqlite));
+    }
+
+    return SQLITE_ROW == result;
+}
+
+bool SQLiteReader::get(int index, int & value)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    if (index >= sqlite3_column_count(m_statement))
+    {
+        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
+        return false;
+    }
+
+    value = sqlite3_column_int(m_statement, index);
+
+    return true;
+}
+
+bool SQLiteReader::get(int index, int64_t & value)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    if (index >= sqlite3_column_count(m_statement))
+    {
+        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
+        return false;
+    }
+
+    value = sqlite3_column_int64(m_statement, index);
+
+    return true;
+}
+
+bool SQLiteReader::get(int index, double & value)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    if (index >= sqlite3_column_count(m_statement))
+    {
+        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
+        return false;
+    }
+
+    value = sqlite3_column_double(m_statement, index);
+
+    return true;
+}
+
+bool SQLiteReader::get(int index, std::string & value)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    if (index >= sqlite3_column_count(m_statement))
+    {
+        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
+        return false;
+    }
+
+    const char * column_text = reinterpret_cast<const char *>(sqlite3_column_text(m_statement, index));
+    int column_size = sqlite3_column_bytes(m_statement, index);
+    value.assign(column_text, column_size);
+
+    return true;
+}
+
+bool SQLiteReader::get(int index, SQLiteView & value, bool blob)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    if (index >= sqlite3_column_count(m_statement))
+    {
+        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
+        return false;
+    }
+
+    value.data = blob ? reinterpret_cast<const char *>(sqlite3_column_blob(m_statement, index)) : reinterpret_cast<const char *>(sqlite3_column_text(m_statement, index));
+    value.size = static_cast<size_t>(sqlite3_column_bytes(m_statement, index));
+
+    return true;
+}
+
+bool SQLiteReader::get(void * ignore)
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    int index = m_get_index++;
+    if (index >= sqlite3_column_count(m_statement))
+    {
+        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
+        return false;
+    }
+
+    PARAMS_IGN(ignore);
+
+    return true;
+}
+
+bool SQLiteReader::get(bool & value)
+{
+    int dummy = 0;
+    bool result = get(m_get_index++, dummy);
+    value = static_cast<bool>(dummy);
+    return result;
+}
+
+bool SQLiteReader::get(int8_t & value)
+{
+    int dummy = 0;
+    bool result = get(m_get_index++, dummy);
+    value = static_cast<int8_t>(dummy);
+    return result;
+}
+
+bool SQLiteReader::get(uint8_t & value)
+{
+    int dummy = 0;
+    bool result = get(m_get_index++, dummy);
+    value = static_cast<uint8_t>(dummy);
+    return result;
+}
+
+bool SQLiteReader::get(int16_t & value)
+{
+    int dummy = 0;
+    bool result = get(m_get_index++, dummy);
+    value = static_cast<int16_t>(dummy);
+    return result;
+}
+
+bool SQLiteReader::get(uint16_t & value)
+{
+    int dummy = 0;
+    bool result = get(m_get_index++, dummy);
+    value = static_cast<uint16_t>(dummy);
+    return result;
+}
+
+bool SQLiteReader::get(int32_t & value)
+{
+    int dummy = 0;
+    bool result = get(m_get_index++, dummy);
+    value = static_cast<int32_t>(dummy);
+    return result;
+}
+
+bool SQLiteReader::get(uint32_t & value)
+{
+    int dummy = 0;
+    bool result = get(m_get_index++, dummy);
+    value = static_cast<uint32_t>(dummy);
+    return result;
+}
+
+bool SQLiteReader::get(int64_t & value)
+{
+    return get(m_get_index++, value);
+}
+
+bool SQLiteReader::get(uint64_t & value)
+{
+    int64_t dummy = 0;
+    bool result = get(m_get_index++, dummy);
+    value = static_cast<uint64_t>(dummy);
+    return result;
+}
+
+bool SQLiteReader::get(float & value)
+{
+    double dummy = 0;
+    bool result = get(m_get_index++, dummy);
+    value = static_cast<float>(dummy);
+    return result;
+}
+
+bool SQLiteReader::get(double & value)
+{
+    return get(m_get_index++, value);
+}
+
+bool SQLiteReader::get(std::string & value)
+{
+    return get(m_get_index++, value);
+}
+
+bool SQLiteReader::get(SQLiteView & value)
+{
+    return get(m_get_index++, value, false);
+}
+
+bool SQLiteReader::get_blob(std::string & value)
+{
+    SQLiteView view = { nullptr, 0 };
+    if (!get(m_get_index++, view, true))
+    {
+        return false;
+    }
+    value.assign(nullptr != view.data ? view.data : "", view.size);
+    return true;
+}
+
+bool SQLiteReader::get_blob(SQLiteView & value)
+{
+    return get(m_get_index++, value, true);
+}
+
+bool SQLiteReader::for_each_row(const SQLiteRowVisitor & visitor, uint64_t * rows)
+{
+    if (nullptr == m_statement || !visitor)
+    {
+        return false;
+    }
+
+    const SQLiteRow row(m_statement, sqlite3_column_count(m_statement));
+    uint64_t count = 0;
+    bool ret = true;
+
+    while (true)
+    {
+        int result = sqlite3_step(m_statement);
+        if (SQLITE_ROW == result)
+        {
+            ++count;
+            if (!visitor(row))
+            {
+                break;
+            }
+        }
+        else
+        {
+            if (SQLITE_DONE != result)
+            {
+                discard_changes();
+                RUN_LOG_ERR("sqlite reader (%s) for each row failure while step failed, error (%d: %s, %d: %s)", m_sql.c_str(), result, sqlite3_errstr(result), sqlite3_errcode(m_sqlite), sqlite3_errmsg(m_sqlite));
+                ret = false;
+            }
+            break;
+        }
+    }
+
+    m_get_index = 0;
+
+    if (nullptr != rows)
+    {
+        *rows = count;
+    }
+
+    return ret;
+}
+
+bool SQLiteReader::read_batch(size_t max_rows, SQLiteColumnBatch & batch)
+{
+    batch.clear();
+
+    if (nullptr == m_statement || 0 == max_rows || m_done)
+    {
+        return false;
+    }
+
+    m_get_index = 0;
+
+    while (batch.m_rows < max_rows)
+    {
+        int result = sqlite3_step(m_statement);
+        if (SQLITE_ROW != result)
+        {
+            m_done = true;
+            if (SQLITE_DONE != result)
+            {
+                discard_changes();
+                RUN_LOG_ERR("sqlite reader (%s) read batch failure while step failed, error (%d: %s, %d: %s)", m_sql.c_str(), result, sqlite3_errstr(result), sqlite3_errcode(m_sqlite), sqlite3_errmsg(m_sqlite));
+            }
+            break;
+        }
+
+        if (batch.m_columns.size() != static_cast<size_t>(m_column_count))
+        {
+            batch.m_columns.resize(static_cast<size_t>(m_column_count));
+            for (int index = 0; index < m_column_count; ++index)
+            {
+                SQLiteColumnBatch::column_t & column = batch.m_columns[index];
+                const char * declare_type = sqlite3_column_decltype(m_statement, index);
+                if (nullptr != declare_type)
+                {
+                    std::string affinity(declare_type);
+                    for (std::string::iterator iter = affinity.begin(); affinity.end() != iter; ++iter)
+                    {
+                        *iter = static_cast<char>(toupper(static_cast<unsigned char>(*iter)));
+                    }
+                    if (std::string::npos != affinity.find("INT"))
+                    {
+                        column.type = SQLITE_INTEGER;
+                    }
+                    else if (std::string::npos != affinity.find("CHAR") || std::string::npos != affinity.find("CLOB") || std::string::npos != affinity.find("TEXT") || std::string::npos != affinity.find("BLOB") || affinity.empty())
+                    {
+                        column.type = SQLITE_TEXT;
+                    }
+                    else
+                    {
+                        column.type = SQLITE_FLOAT;
+                    }
+                }
+                else
+                {
+                    const int value_type = sqlite3_column_type(m_statement, index);
+                    column.type = (SQLITE_INTEGER == value_type || SQLITE_FLOAT == value_type) ? value_type : SQLITE_TEXT;
+                }
+                column.offsets.assign(1, 0);
+            }
+        }
+
+        for (int index = 0; index < m_column_count; ++index)
+        {
+            SQLiteColumnBatch::column_t & column = batch.m_columns[index];
+            column.nulls.push_back(SQLITE_NULL == sqlite3_column_type(m_statement, index) ? 1 : 0);
+            if (SQLITE_INTEGER == column.type)
+            {
+                column.integers.push_back(sqlite3_column_int64(m_statement, index));
+            }
+            else if (SQLITE_FLOAT == column.type)
+            {
+                column.doubles.push_back(sqlite3_column_double(m_statement, index));
+            }
+            else
+            {
+                const char * data = reinterpret_cast<const char *>(sqlite3_column_blob(m_statement, index));
+                const size_t size = static_cast<size_t>(sqlite3_column_bytes(m_statement, index));
+                column.bytes.insert(column.bytes.end(), data, data + size);
+                column.offsets.push_back(column.bytes.size());
+            }
+        }
+
+        ++batch.m_rows;
+    }
+
+    return 0 != batch.m_rows;
+}
+
+bool SQLiteReader::check_columns(int count) const
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    if (count > m_column_count)
+    {
+        RUN_LOG_ERR("sqlite reader (%s) read row failure while read (%d) of (%d) columns", m_sql.c_str(), count, m_column_count);
+        return false;
+    }
+
+    return true;
+}
+
+void SQLiteReader::fetch(int index, bool & value)
+{
+    value = 0 != sqlite3_column_int(m_statement, index);
+}
+
+void SQLiteReader::fetch(int index, int8_t & value)
+{
+    value = static_cast<int8_t>(sqlite3_column_int(m_statement, index));
+}
+
+void SQLiteReader::fetch(int index, uint8_t & value)
+{
+    value = static_cast<uint8_t>(sqlite3_column_int(m_statement, index));
+}
+
+void SQLiteReader::fetch(int index, int16_t & value)
+{
+    value = static_cast<int16_t>(sqlite3_column_int(m_statement, index));
+}
+
+void SQLiteReader::fetch(int index, uint16_t & value)
+{
+    value = static_cast<uint16_t>(sqlite3_column_int(m_statement, index));
+}
+
+void SQLiteReader::fetch(int index, int32_t & value)
+{
+    value = static_cast<int32_t>(sqlite3_column_int(m_statement, index));
+}
+
+void SQLiteReader::fetch(int index, uint32_t & value)
+{
+    value = static_cast<uint32_t>(sqlite3_column_int64(m_statement, index));
+}
+
+void SQLiteReader::fetch(int index, int64_t & value)
+{
+    value = sqlite3_column_int64(m_statement, index);
+}
+
+void SQLiteReader::fetch(int index, uint64_t & value)
+{
+    value = static_cast<uint64_t>(sqlite3_column_int64(m_statement, index));
+}
+
+void SQLiteReader::fetch(int index, float & value)
+{
+    value = static_cast<float>(sqlite3_column_double(m_statement, index));
+}
+
+void SQLiteReader::fetch(int index, double & value)
+{
+    value = sqlite3_column_double(m_statement, index);
+}
+
+void SQLiteReader::fetch(int index, std::string & value)
+{
+    const char * column_text = reinterpret_cast<const char *>(sqlite3_column_text(m_statement, index));
+    int column_size = sqlite3_column_bytes(m_statement, index);
+    value.assign(nullptr != column_text ? column_text : "", column_size);
+}
+
+void SQLiteReader::fetch(int index, SQLiteView & value)
+{
+    value.data = reinterpret_cast<const char *>(sqlite3_column_text(m_statement, index));
+    value.size = static_cast<size_t>(sqlite3_column_bytes(m_statement, index));
+}
+
+SQLiteColumnBatch::SQLiteColumnBatch()
+    : m_columns()
+    , m_rows(0)
+{
+
+}
+
+void SQLiteColumnBatch::clear()
+{
+    for (std::vector<column_t>::iterator iter = m_columns.begin(); m_columns.end() != iter; ++iter)
+    {
+        iter->nulls.clear();
+        iter->integers.clear();
+        iter->doubles.clear();
+        iter->offsets.resize(1);
+        iter->bytes.clear();
+    }
+    m_rows = 0;
+}
+
+size_t SQLiteColumnBatch::rows() const
+{
+    return m_rows;
+}
+
+size_t SQLiteColumnBatch::columns() const
+{
+    return m_columns.size();
+}
+
+int SQLiteColumnBatch::type(size_t column) const
+{
+    return column < m_columns.size() ? m_columns[column].type : SQLITE_NULL;
+}
+
+const uint8_t * SQLiteColumnBatch::nulls(size_t column) const
+{
+    return column < m_columns.size() ? m_columns[column].nulls.data() : nullptr;
+}
+
+const int64_t * SQLiteColumnBatch::integers(size_t column) const
+{
+    return column < m_columns.size() && SQLITE_INTEGER == m_columns[column].type ? m_columns[column].integers.data() : nullptr;
+}
+
+const double * SQLiteColumnBatch::doubles(size_t column) const
+{
+    return column < m_columns.size() && SQLITE_FLOAT == m_columns[column].type ? m_columns[column].doubles.data() : nullptr;
+}
+
+const size_t * SQLiteColumnBatch::offsets(size_t column) const
+{
+    return column < m_columns.size() && SQLITE_TEXT == m_columns[column].type ? m_columns[column].offsets.data() : nullptr;
+}
+
+const char * SQLiteColumnBatch::bytes(size_t column) const
+{
+    return column < m_columns.size() && SQLITE_TEXT == m_columns[column].type ? m_columns[column].bytes.data() : nullptr;
+}
+
+SQLiteView SQLiteColumnBatch::text(size_t column, size_t row) const
+{
+    SQLiteView view = { nullptr, 0 };
+    if (column < m_columns.size() && row < m_rows && SQLITE_TEXT == m_columns[column].type)
+    {
+        const column_t & data = m_columns[column];
+        view.data = data.bytes.data() + data.offsets[row];
+        view.size = data.offsets[row + 1] - data.offsets[row];
+    }
+    return view;
+}
+
+SQLiteRow::SQLiteRow(sqlite3_stmt * statement, int columns)
+    : m_statement(statement)
+    , m_columns(columns)
+{
+
+}
+
+int SQLiteRow::columns() const
+{
+    return m_columns;
+}
+
+int SQLiteRow::type(int index) const
+{
+    return index < m_columns ? sqlite3_column_type(m_statement, index) : SQLITE_NULL;
+}
+
+bool SQLiteRow::is_null(int index) const
+{
+    return SQLITE_NULL == type(index);
+}
+
+int64_t SQLiteRow::get_int64(int index) const
+{
+    return index < m_columns ? sqlite3_column_int64(m_statement, index) : 0;
+}
+
+double SQLiteRow::get_double(int index) const
+{
+    return index < m_columns ? sqlite3_column_double(m_statement, index) : 0.0;
+}
+
+SQLiteView SQLiteRow::get_text(int index) const
+{
+    SQLiteView view = { nullptr, 0 };
+    if (index < m_columns)
+    {
+        view.data = reinterpret_cast<const char *>(sqlite3_column_text(m_statement, index));
+        view.size = static_cast<size_t>(sqlite3_column_bytes(m_statement, index));
+    }
+    return view;
+}
+
+SQLiteView SQLiteRow::get_blob(int index) const
+{
+    SQLiteView view = { nullptr, 0 };
+    if (index < m_columns)
+    {
+        view.data = reinterpret_cast<const char *>(sqlite3_column_blob(m_statement, index));
+        view.size = static_cast<size_t>(sqlite3_column_bytes(m_statement, index));
+    }
+    return view;
+}
+
+SQLiteFunctionArgs::SQLiteFunctionArgs(int count, sqlite3_value ** values)
+    : m_count(count)
+    , m_values(values)
+{
+
+}
+
+int SQLiteFunctionArgs::count() const
+{
+    return m_count;
+}
+
+int SQLiteFunctionArgs::type(int index) const
+{
+    return check_index(index) ? sqlite3_value_type(m_values[index]) : SQLITE_NULL;
+}
+
+bool SQLiteFunctionArgs::is_null(int index) const
+{
+    return SQLITE_NULL == type(index);
+}
+
+bool SQLiteFunctionArgs::check_index(int index) const
+{
+    return index >= 0 && index < m_count && nullptr != m_values;
+}
+
+bool SQLiteFunctionArgs::get(int index, bool & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = 0 != sqlite3_value_int(m_values[index]);
+    return true;
+}
+
+bool SQLiteFunctionArgs::get(int index, int8_t & value) const
 {
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = static_cast<int8_t>(sqlite3_value_int(m_values[index]));
+    return true;
+}
 
+bool SQLiteFunctionArgs::get(int index, uint8_t & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = static_cast<uint8_t>(sqlite3_value_int(m_values[index]));
+    return true;
 }
 
-SQLiteDB::~SQLiteDB()
+bool SQLiteFunctionArgs::get(int index, int16_t & value) const
 {
-    exit();
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = static_cast<int16_t>(sqlite3_value_int(m_values[index]));
+    return true;
+}
+
+bool SQLiteFunctionArgs::get(int index, uint16_t & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = static_cast<uint16_t>(sqlite3_value_int(m_values[index]));
+    return true;
+}
+
+bool SQLiteFunctionArgs::get(int index, int32_t & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = static_cast<int32_t>(sqlite3_value_int(m_values[index]));
+    return true;
+}
+
+bool SQLiteFunctionArgs::get(int index, uint32_t & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = static_cast<uint32_t>(sqlite3_value_int64(m_values[index]));
+    return true;
+}
+
+bool SQLiteFunctionArgs::get(int index, int64_t & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = static_cast<int64_t>(sqlite3_value_int64(m_values[index]));
+    return true;
+}
+
+bool SQLiteFunctionArgs::get(int index, uint64_t & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = static_cast<uint64_t>(sqlite3_value_int64(m_values[index]));
+    return true;
+}
+
+bool SQLiteFunctionArgs::get(int index, float & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = static_cast<float>(sqlite3_value_double(m_values[index]));
+    return true;
+}
+
+bool SQLiteFunctionArgs::get(int index, double & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    value = sqlite3_value_double(m_values[index]);
+    return true;
+}
+
+bool SQLiteFunctionArgs::get(int index, std::string & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    const char * text = reinterpret_cast<const char *>(sqlite3_value_text(m_values[index]));
+    value.assign(nullptr != text ? text : "", static_cast<size_t>(sqlite3_value_bytes(m_values[index])));
+    return true;
+}
+
+bool SQLiteFunctionArgs::get(int index, SQLiteView & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    const char * text = reinterpret_cast<const char *>(sqlite3_value_text(m_values[index]));
+    value.data = (nullptr != text ? text : "");
+    value.size = static_cast<size_t>(sqlite3_value_bytes(m_values[index]));
+    return true;
+}
+
+bool SQLiteFunctionArgs::get_blob(int index, std::string & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    const char * data = reinterpret_cast<const char *>(sqlite3_value_blob(m_values[index]));
+    value.assign(nullptr != data ? data : "", static_cast<size_t>(sqlite3_value_bytes(m_values[index])));
+    return true;
+}
+
+bool SQLiteFunctionArgs::get_blob(int index, SQLiteView & value) const
+{
+    if (!check_index(index))
+    {
+        return false;
+    }
+    const char * data = reinterpret_cast<const char *>(sqlite3_value_blob(m_values[index]));
+    value.data = (nullptr != data ? data : "");
+    value.size = static_cast<size_t>(sqlite3_value_bytes(m_values[index]));
+    return true;
+}
+
+SQLiteFunctionResult::SQLiteFunctionResult(sqlite3_context * context)
+    : m_context(context)
+{
+
+}
+
+void SQLiteFunctionResult::set(bool value)
+{
+    sqlite3_result_int(m_context, value ? 1 : 0);
+}
+
+void SQLiteFunctionResult::set(int8_t value)
+{
+    sqlite3_result_int(m_context, static_cast<int>(value));
+}
+
+void SQLiteFunctionResult::set(uint8_t value)
+{
+    sqlite3_result_int(m_context, static_cast<int>(value));
+}
+
+void SQLiteFunctionResult::set(int16_t value)
+{
+    sqlite3_result_int(m_context, static_cast<int>(value));
+}
+
+void SQLiteFunctionResult::set(uint16_t value)
+{
+    sqlite3_result_int(m_context, static_cast<int>(value));
+}
+
+void SQLiteFunctionResult::set(int32_t value)
+{
+    sqlite3_result_int(m_context, static_cast<int>(value));
+}
+
+void SQLiteFunctionResult::set(uint32_t value)
+{
+    sqlite3_result_int64(m_context, static_cast<sqlite3_int64>(value));
+}
+
+void SQLiteFunctionResult::set(int64_t value)
+{
+    sqlite3_result_int64(m_context, static_cast<sqlite3_int64>(value));
+}
+
+void SQLiteFunctionResult::set(uint64_t value)
+{
+    sqlite3_result_int64(m_context, static_cast<sqlite3_int64>(value));
+}
+
+void SQLiteFunctionResult::set(float value)
+{
+    sqlite3_result_double(m_context, static_cast<double>(value));
+}
+
+void SQLiteFunctionResult::set(double value)
+{
+    sqlite3_result_double(m_context, value);
+}
+
+void SQLiteFunctionResult::set(const char * value, bool copy)
+{
+    sqlite3_result_text(m_context, nullptr != value ? value : "", -1, copy ? SQLITE_TRANSIENT : SQLITE_STATIC);
+}
+
+void SQLiteFunctionResult::set(const std::string & value, bool copy)
+{
+    sqlite3_result_text(m_context, value.data(), static_cast<int>(value.size()), copy ? SQLITE_TRANSIENT : SQLITE_STATIC);
+}
+
+void SQLiteFunctionResult::set(const SQLiteView & value, bool copy)
+{
+    sqlite3_result_text(m_context, nullptr != value.data ? value.data : "", static_cast<int>(value.size), copy ? SQLITE_TRANSIENT : SQLITE_STATIC);
+}
+
+void SQLiteFunctionResult::set_blob(const void * data, size_t size, bool copy)
+{
+    sqlite3_result_blob(m_context, nullptr != data ? data : "", static_cast<int>(size), copy ? SQLITE_TRANSIENT : SQLITE_STATIC);
+}
+
+void SQLiteFunctionResult::set_blob(const std::string & value, bool copy)
+{
+    set_blob(value.data(), value.size(), copy);
+}
+
+void SQLiteFunctionResult::set_null()
+{
+    sqlite3_result_null(m_context);
+}
+
+void SQLiteFunctionResult::set_error(const std::string & message)
+{
+    sqlite3_result_error(m_context, message.c_str(), static_cast<int>(message.size()));
+}
+
+SQLiteAggregate::~SQLiteAggregate()
+{
+
+}
+
+void SQLiteAggregate::inverse(const SQLiteFunctionArgs &)
+{
+
+}
+
+SQLiteWriter::SQLiteWriter()
+    : SQLiteStatement()
+{
+
+}
+
+SQLiteWriter::SQLiteWriter(sqlite3 * sqlite, const std::string & sql)
+    : SQLiteStatement(sqlite, sql, true)
+{
+
+}
+
+SQLiteWriter::SQLiteWriter(SQLiteDB * db, const std::string & sql)
+    : SQLiteStatement(db, sql, true)
+{
+
+}
+
+bool SQLiteWriter::write()
+{
+    if (nullptr == m_statement)
+    {
+        return false;
+    }
+
+    int result = sqlite3_step(m_statement);
+    if (SQLITE_ROW != result && SQLITE_DONE != result)
+    {
+        discard_changes();
+    }
+    if (SQLITE_ERROR == result || SQLITE_MISUSE == result)
+    {
+        RUN_LOG_ERR("sqlite writer (%s) write failure while step failed, error (%d: %s, %d: %s)", m_sql.c_str(), result, sqlite3_errstr(result), sqlite3_errcode(m_sqlite), sqlite3_errmsg(m_sqlite));
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t SQLiteWriter::changes() const
+{
+    return nullptr != m_sqlite ? static_cast<uint64_t>(sqlite3_changes(m_sqlite)) : 0;
+}
+
+bool SQLiteWriter::write_batch(size_t row_count, const SQLiteRowBinder & binder, size_t transaction_rows, SQLiteBatchStats * stats)
+{
+    if (nullptr == m_statement || !binder)
+    {
+        return false;
+    }
+
+    if (0 == transaction_rows)
+    {
+        transaction_rows = std::max<size_t>(row_count, 1);
+    }
+
+    const uint64_t start_time = get_ns_time();
+    const int parameters = sqlite3_bind_parameter_count(m_statement);
+
+    SQLiteWriter multi_writer;
+    size_t multi_rows = 0;
+    std::string prefix;
+    std::string group;
+    std::string suffix;
+    if (parameters > 0 && multi_row_shape(prefix, group, suffix))
+    {
+        const int variable_limit = sqlite3_limit(m_sqlite, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+        multi_rows = std::min(std::min(static_cast<size_t>(variable_limit / parameters), s_multi_row_max), std::min(transaction_rows, row_count));
+        if (multi_rows > 1)
+        {
+            std::string multi_sql(prefix);
+            multi_sql.reserve(prefix.size() + (group.size() + 2) * multi_rows + suffix.size() + 2);
+            for (size_t index = 0; index < multi_rows; ++index)
+            {
+                multi_sql += (0 == index ? "" : ", ");
+                multi_sql += group;
+            }
+            multi_sql += suffix;
+            multi_sql += ";";
+            if (m_cache)
+            {
+                multi_writer.open(m_cache, multi_sql, true);
+            }
+            else
+            {
+                multi_writer = SQLiteWriter(m_sqlite, multi_sql);
+            }
+            multi_writer.m_row_parameter_count = parameters;
+        }
+        if (!multi_writer.good())
+        {
+            multi_rows = 0;
+        }
+    }
+
+    const bool own_transaction = 0 != sqlite3_get_autocommit(m_sqlite);
+    bool in_transaction = false;
+    bool ret = true;
+    uint64_t statements = 0;
+    uint64_t transactions = 0;
+    uint64_t changes = 0;
+    size_t row = 0;
+
+    while (ret && row < row_count)
+    {
+        if (own_transaction)
+        {
+            if (!sqlite_execute(m_sqlite, "BEGIN TRANSACTION;"))
+            {
+                ret = false;
+                break;
+            }
+            in_transaction = true;
+        }
+
+        const size_t chunk_end = std::min(row_count, row + transaction_rows);
+        while (row < chunk_end)
+        {
+            const bool multiple = multi_rows > 1 && chunk_end - row >= multi_rows;
+            SQLiteWriter & writer = multiple ? multi_writer : *this;
+            const size_t rows = multiple ? multi_rows : 1;
+
+            writer.reset();
+            for (size_t index = 0; index < rows; ++index)
+            {
+                if (!binder(writer, row + index))
+                {
+                    RUN_LOG_ERR("sqlite writer (%s) write batch failure while bind row (%u) failed", m_sql.c_str(), static_cast<uint32_t>(row + index));
+                    ret = false;
+                    break;
+                }
+            }
+            if (!ret)
+            {
+                break;
+            }
+
+            if (writer.m_set_index != static_cast<int>(rows) * parameters)
+            {
+                RUN_LOG_ERR("sqlite writer (%s) write batch failure while row (%u) binds (%d) of (%d) parameters", m_sql.c_str(), static_cast<uint32_t>(row), writer.m_set_index, static_cast<int>(rows) * parameters);
+                ret = false;
+                break;
+            }
+
+            int result = sqlite3_step(writer.m_statement);
+            if (SQLITE_DONE != result && SQLITE_ROW != result)
+            {
+                writer.discard_changes();
+                RUN_LOG_ERR("sqlite writer (%s) write batch failure while step failed, error (%d: %s, %d: %s)", writer.m_sql.c_str(), result, sqlite3_errstr(result), sqlite3_errcode(m_sqlite), sqlite3_errmsg(m_sqlite));
+                ret = false;
+                break;
+            }
+
+            row += rows;
+            ++statements;
+            changes += static_cast<uint64_t>(sqlite3_changes(m_sqlite));
+        }
+
+        if (ret && in_transaction)
+        {
+            if (!sqlite_execute(m_sqlite, "COMMIT TRANSACTION;"))
+            {
+                ret = false;
+            }
+            else
+            {
+                in_transaction = false;
+                ++transactions;
+            }
+        }
+    }
+
+    if (in_transaction)
+    {
+        sqlite_execute(m_sqlite, "ROLLBACK TRANSACTION;");
+    }
+
+    reset();
+
+    if (nullptr != stats)
+    {
+        stats->rows = row;
+        stats->statements = statements;
+        stats->transactions = transactions;
+        stats->changes = changes;
+        stats->elapsed_ns = get_ns_time() - start_time;
+        stats->rows_per_second = (0 != stats->elapsed_ns ? static_cast<double>(row) * 1000000000.0 / static_cast<double>(stats->elapsed_ns) : 0.0);
+    }
+
+    return ret;
 }
 
-bool SQLiteDB::init(const std::string & path)
-{
-    exit();
+bool SQLiteWriter::multi_row_shape(std::string & prefix, std::string & group, std::string & suffix) const
+{
+    std::string sql(m_sql);
+    for (std::string::iterator iter = sql.begin(); sql.end() != iter; ++iter)
+    {
+        *iter = static_cast<char>(toupper(static_cast<unsigned char>(*iter)));
+    }
+
+    const size_t head = sql.find_first_not_of(" \t\r\n");
+    if (std::string::npos == head || (0 != sql.compare(head, 6, "INSERT") && 0 != sql.compare(head, 7, "REPLACE")))
+    {
+        return false;
+    }
+
+    const size_t values = sql.rfind("VALUES");
+    if (std::string::npos == values)
+    {
+        return false;
+    }
+
+    const size_t group_begin = sql.find_first_not_of(" \t\r\n", values + 6);
+    if (std::string::npos == group_begin || '(' != sql[group_begin])
+    {
+        return false;
+    }
+
+    const size_t group_end = sql.find(')', group_begin);
+    if (std::string::npos == group_end)
+    {
+        return false;
+    }
 
-    if (path.empty())
+    int placeholders = 0;
+    for (size_t index = group_begin + 1; index < group_end; ++index)
+    {
+        const char c = sql[index];
+        if ('?' == c)
+        {
+            ++placeholders;
+        }
+        else if (',' != c && ' ' != c && '\t' != c && '\r' != c && '\n' != c)
+        {
+            return false;
+        }
+    }
+
+    if (0 == placeholders || placeholders != sqlite3_bind_parameter_count(m_statement))
     {
-        RUN_LOG_ERR("sqlite db init failure while path is invalid");
         return false;
     }
 
-    int result = sqlite3_open(path.c_str(), &m_sqlite);
-    if (SQLITE_OK != result)
+    // an upsert clause may follow the values, it applies to every row of a multi-row insert
+    const size_t tail = sql.find_first_not_of(" \t\r\n;", group_end + 1);
+    if (std::string::npos != tail && 0 != sql.compare(tail, 11, "ON CONFLICT"))
     {
-        RUN_LOG_ERR("sqlite db init failure while open (%s) failed, error (%d: %s)", path.c_str(), result, sqlite3_errstr(result));
         return false;
     }
 
-    m_path = path;
+    prefix = m_sql.substr(0, group_begin);
+    group = m_sql.substr(group_begin, group_end + 1 - group_begin);
+    suffix = (std::string::npos != tail ? " " + m_sql.substr(tail, sql.find_last_not_of(" \t\r\n;") + 1 - tail) : std::string());
 
     return true;
 }
 
-void SQLiteDB::exit()
+SQLiteUpsert::SQLiteUpsert()
+    : m_insert()
+    , m_update()
+    , m_changes(0)
 {
-    if (nullptr != m_sqlite)
+
+}
+
+SQLiteUpsert::SQLiteUpsert(SQLiteDB * db, const std::string & insert_sql, const std::string & update_sql)
+    : m_insert(db, insert_sql)
+    , m_update()
+    , m_changes(0)
+{
+    if (!update_sql.empty())
     {
-        int result = sqlite3_close(m_sqlite);
-        if (SQLITE_OK != result)
+        m_update = SQLiteWriter(db, update_sql);
+        if (!m_update.good())
         {
-            RUN_LOG_ERR("sqlite db exit failure while close (%s) failed, error (%d: %s)", m_path.c_str(), result, sqlite3_errstr(result));
+            m_insert.clear();
         }
-        m_sqlite = nullptr;
-        m_path.clear();
     }
 }
 
-bool SQLiteDB::is_open() const
+SQLiteUpsert::SQLiteUpsert(SQLiteUpsert && other)
+    : m_insert(std::move(other.m_insert))
+    , m_update(std::move(other.m_update))
+    , m_changes(other.m_changes)
 {
-    return nullptr != m_sqlite;
+    other.m_changes = 0;
 }
 
-int SQLiteDB::error() const
+SQLiteUpsert & SQLiteUpsert::operator = (SQLiteUpsert && other)
 {
-    return nullptr != m_sqlite ? sqlite3_errcode(m_sqlite) : 999;
+    if (&other != this)
+    {
+        m_insert = std::move(other.m_insert);
+        m_update = std::move(other.m_update);
+        m_changes = other.m_changes;
+        other.m_changes = 0;
+    }
+    return *this;
 }
 
-const char * SQLiteDB::what() const
+SQLiteUpsert::~SQLiteUpsert()
 {
-    return nullptr != m_sqlite ? sqlite3_errmsg(m_sqlite) : "sqlite db is not open";
+    clear();
 }
 
-bool SQLiteDB::execute(const std::string & sql)
+bool SQLiteUpsert::good() const
 {
-    if (!is_open() || sql.empty())
+    return m_insert.good();
+}
+
+bool SQLiteUpsert::is_native() const
+{
+    return m_insert.good() && !m_update.good();
+}
+
+void SQLiteUpsert::clear()
+{
+    m_update.clear();
+    m_insert.clear();
+    m_changes = 0;
+}
+
+uint64_t SQLiteUpsert::changes() const
+{
+    return m_changes;
+}
+
+bool SQLiteUpsert::upsert_batch(size_t row_count, const SQLiteRowBinder & binder, size_t transaction_rows, SQLiteBatchStats * stats)
+{
+    m_changes = 0;
+
+    if (!m_insert.good() || !binder)
     {
         return false;
     }
 
-    char * error_message = nullptr;
-    int result = sqlite3_exec(m_sqlite, sql.c_str(), nullptr, nullptr, &error_message);
-    if (SQLITE_OK != result)
+    if (!m_update.good())
     {
-        RUN_LOG_ERR("sqlite db execute failure while exec (%s) failed, error (%d: %s) message (%s)", sql.c_str(), result, sqlite3_errstr(result), nullptr != error_message ? error_message : "unknown");
+        SQLiteBatchStats batch_stats;
+        const bool ret = m_insert.write_batch(row_count, binder, transaction_rows, &batch_stats);
+        m_changes = batch_stats.changes;
+        if (nullptr != stats)
+        {
+            *stats = batch_stats;
+        }
+        return ret;
     }
 
-    if (nullptr != error_message)
+    if (0 == transaction_rows)
     {
-        sqlite3_free(error_message);
-        error_message = nullptr;
+        transaction_rows = std::max<size_t>(row_count, 1);
     }
 
-    return SQLITE_OK == result;
-}
+    const uint64_t start_time = get_ns_time();
+    sqlite3 * sqlite = m_insert.m_sqlite;
+    const bool own_transaction = 0 != sqlite3_get_autocommit(sqlite);
+    bool in_transaction = false;
+    bool ret = true;
+    uint64_t statements = 0;
+    uint64_t transactions = 0;
+    uint64_t changes = 0;
+    size_t row = 0;
 
-bool SQLiteDB::transaction_begin()
-{
-    return execute("BEGIN TRANSACTION;");
-}
+    while (ret && row < row_count)
+    {
+        if (own_transaction)
+        {
+            if (!sqlite_execute(sqlite, "BEGIN TRANSACTION;"))
+            {
+                ret = false;
+                break;
+            }
+            in_transaction = true;
+        }
 
-bool SQLiteDB::transaction_end()
-{
-    return execute("END TRANSACTION;");
-}
+        const size_t chunk_end = std::min(row_count, row + transaction_rows);
+        for (; ret && row < chunk_end; ++row)
+        {
+            SQLiteWriter * writer = &m_update;
+            uint64_t row_changes = 0;
+            while (nullptr != writer)
+            {
+                writer->reset();
+                if (!binder(*writer, row))
+                {
+                    RUN_LOG_ERR("sqlite upsert (%s) batch failure while bind row (%u) failed", writer->m_sql.c_str(), static_cast<uint32_t>(row));
+                    ret = false;
+                    break;
+                }
 
-SQLiteReader SQLiteDB::create_reader(const std::string & sql)
-{
-    return SQLiteReader(m_sqlite, sql);
-}
+                int result = sqlite3_step(writer->m_statement);
+                if (SQLITE_DONE != result && SQLITE_ROW != result)
+                {
+                    writer->discard_changes();
+                    RUN_LOG_ERR("sqlite upsert (%s) batch failure while step failed, error (%d: %s, %d: %s)", writer->m_sql.c_str(), result, sqlite3_errstr(result), sqlite3_errcode(sqlite), sqlite3_errmsg(sqlite));
+                    ret = false;
+                    break;
+                }
+                ++statements;
 
-SQLiteWriter SQLiteDB::create_writer(const std::string & sql)
-{
-    return SQLiteWriter(m_sqlite, sql);
+                row_changes = static_cast<uint64_t>(sqlite3_changes(sqlite));
+                writer = (&m_update == writer && 0 == row_changes ? &m_insert : nullptr);
+            }
+            if (!ret)
+            {
+                break;
+            }
+            changes += row_changes;
+        }
+
+        if (ret && in_transaction)
+        {
+            if (!sqlite_execute(sqlite, "COMMIT TRANSACTION;"))
+            {
+                ret = false;
+            }
+            else
+            {
+                in_transaction = false;
+                ++transactions;
+            }
+        }
+    }
+
+    if (in_transaction)
+    {
+        sqlite_execute(sqlite, "ROLLBACK TRANSACTION;");
+    }
+
+    m_update.reset();
+    m_insert.reset();
+    m_changes = changes;
+
+    if (nullptr != stats)
+    {
+        stats->rows = row;
+        stats->statements = statements;
+        stats->transactions = transactions;
+        stats->changes = changes;
+        stats->elapsed_ns = get_ns_time() - start_time;
+        stats->rows_per_second = (0 != stats->elapsed_ns ? static_cast<double>(row) * 1000000000.0 / static_cast<double>(stats->elapsed_ns) : 0.0);
+    }
+
+    return ret;
 }
 
-SQLiteStatement::SQLiteStatement()
-    : m_sql()
+SQLiteBlob::SQLiteBlob()
+    : m_name()
     , m_sqlite(nullptr)
-    , m_writer(false)
-    , m_statement(nullptr)
-    , m_set_index(0)
-    , m_get_index(0)
+    , m_blob(nullptr)
+    , m_writable(false)
+    , m_rowid(0)
+    , m_size(0)
 {
 
 }
 
-SQLiteStatement::SQLiteStatement(sqlite3 * sqlite, const std::string & sql, bool writer)
-    : m_sql()
-    , m_sqlite(nullptr)
-    , m_writer(false)
-    , m_statement(nullptr)
-    , m_set_index(0)
-    , m_get_index(0)
+SQLiteBlob::SQLiteBlob(sqlite3 * sqlite, const std::string & table, const std::string & column, int64_t rowid, bool writable)
+    : m_name(table + "." + column)
+    , m_sqlite(sqlite)
+    , m_blob(nullptr)
+    , m_writable(writable)
+    , m_rowid(rowid)
+    , m_size(0)
 {
-    if (nullptr != sqlite && !sql.empty())
+    if (nullptr == m_sqlite)
     {
-        sqlite3_stmt * statement = nullptr;
-        int result = sqlite3_prepare_v2(sqlite, sql.c_str(), static_cast<int>(sql.size()), &statement, nullptr);
-        if (SQLITE_OK == result)
-        {
-            m_sql = sql;
-            m_sqlite = sqlite;
-            m_writer = writer;
-            m_statement = statement;
-        }
-        else
-        {
-            RUN_LOG_ERR("sqlite %s (%s) create failure while prepare failed, error (%d: %s)", writer ? "writer" : "reader", sql.c_str(), result, sqlite3_errstr(result));
-        }
+        RUN_LOG_ERR("sqlite blob (%s) open failure while sqlite is not open", m_name.c_str());
+        return;
+    }
+
+    int result = sqlite3_blob_open(m_sqlite, "main", table.c_str(), column.c_str(), rowid, writable ? 1 : 0, &m_blob);
+    if (SQLITE_OK != result)
+    {
+        RUN_LOG_ERR("sqlite blob (%s) open failure while open row (%lld) failed, error (%d: %s)", m_name.c_str(), static_cast<long long>(rowid), result, sqlite3_errmsg(m_sqlite));
+        sqlite3_blob_close(m_blob);
+        m_blob = nullptr;
+        return;
     }
+
+    m_size = static_cast<size_t>(sqlite3_blob_bytes(m_blob));
 }
 
-SQLiteStatement::SQLiteStatement(SQLiteStatement && other)
-    : m_sql()
+SQLiteBlob::SQLiteBlob(SQLiteBlob && other)
+    : m_name()
     , m_sqlite(nullptr)
-    , m_writer(false)
-    , m_statement(nullptr)
-    , m_set_index(0)
-    , m_get_index(0)
+    , m_blob(nullptr)
+    , m_writable(false)
+    , m_rowid(0)
+    , m_size(0)
 {
-    std::swap(m_sql, other.m_sql);
+    std::swap(m_name, other.m_name);
     std::swap(m_sqlite, other.m_sqlite);
-    std::swap(m_writer, other.m_writer);
-    std::swap(m_statement, other.m_statement);
-    std::swap(m_set_index, other.m_set_index);
-    std::swap(m_get_index, other.m_get_index);
+    std::swap(m_blob, other.m_blob);
+    std::swap(m_writable, other.m_writable);
+    std::swap(m_rowid, other.m_rowid);
+    std::swap(m_size, other.m_size);
 }
 
-SQLiteStatement & SQLiteStatement::operator = (SQLiteStatement && other)
+SQLiteBlob & SQLiteBlob::operator = (SQLiteBlob && other)
 {
     if (&other != this)
     {
-        clear();
-        std::swap(m_sql, other.m_sql);
+        close();
+        std::swap(m_name, other.m_name);
         std::swap(m_sqlite, other.m_sqlite);
-        std::swap(m_writer, other.m_writer);
-        std::swap(m_statement, other.m_statement);
-        std::swap(m_set_index, other.m_set_index);
-        std::swap(m_get_index, other.m_get_index);
+        std::swap(m_blob, other.m_blob);
+        std::swap(m_writable, other.m_writable);
+        std::swap(m_rowid, other.m_rowid);
+        std::swap(m_size, other.m_size);
     }
     return *this;
 }
 
-SQLiteStatement::~SQLiteStatement()
+SQLiteBlob::~SQLiteBlob()
 {
-    clear();
+    close();
 }
 
-bool SQLiteStatement::good() const
+bool SQLiteBlob::good() const
 {
-    return nullptr != m_statement;
+    return nullptr != m_blob;
 }
 
-void SQLiteStatement::clear()
+void SQLiteBlob::close()
 {
-    if (nullptr != m_statement)
+    if (nullptr != m_blob)
     {
-        int result = sqlite3_finalize(m_statement);
+        int result = sqlite3_blob_close(m_blob);
         if (SQLITE_OK != result)
         {
-            RUN_LOG_ERR("sqlite %s (%s) clear failure while finalize failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+            RUN_LOG_ERR("sqlite blob (%s) close failure, error (%d: %s)", m_name.c_str(), result, sqlite3_errstr(result));
         }
-        m_sql.clear();
-        m_sqlite = nullptr;
-        m_writer = false;
-        m_statement = nullptr;
-        m_set_index = 0;
-        m_get_index = 0;
+        m_blob = nullptr;
     }
+    m_name.clear();
+    m_sqlite = nullptr;
+    m_writable = false;
+    m_rowid = 0;
+    m_size = 0;
 }
 
-bool SQLiteStatement::reset()
+int64_t SQLiteBlob::rowid() const
 {
-    if (nullptr == m_statement)
+    return m_rowid;
+}
+
+size_t SQLiteBlob::size() const
+{
+    return m_size;
+}
+
+bool SQLiteBlob::read(size_t offset, void * data, size_t size)
+{
+    if (nullptr == m_blob)
     {
         return false;
     }
 
-    m_set_index = 0;
+    if (offset > m_size || size > m_size - offset || (nullptr == data && 0 != size))
+    {
+        RUN_LOG_ERR("sqlite blob (%s) read failure while range (%u, %u) is invalid, blob size (%u)", m_name.c_str(), static_cast<uint32_t>(offset), static_cast<uint32_t>(size), static_cast<uint32_t>(m_size));
+        return false;
+    }
 
-    int result = sqlite3_reset(m_statement);
+    if (0 == size)
+    {
+        return true;
+    }
+
+    int result = sqlite3_blob_read(m_blob, data, static_cast<int>(size), static_cast<int>(offset));
     if (SQLITE_OK != result)
     {
-        RUN_LOG_ERR("sqlite %s (%s) reset failure while reset failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        RUN_LOG_ERR("sqlite blob (%s) read failure, error (%d: %s)", m_name.c_str(), result, sqlite3_errstr(result));
         return false;
     }
 
     return true;
 }
 
-bool SQLiteStatement::set(int index, int value)
+bool SQLiteBlob::write(size_t offset, const void * data, size_t size)
 {
-    if (nullptr == m_statement)
+    if (nullptr == m_blob)
     {
         return false;
     }
 
-    int result = sqlite3_bind_int(m_statement, index + 1, value);
+    if (!m_writable)
+    {
+        RUN_LOG_ERR("sqlite blob (%s) write failure while blob is read only", m_name.c_str());
+        return false;
+    }
+
+    if (offset > m_size || size > m_size - offset || (nullptr == data && 0 != size))
+    {
+        RUN_LOG_ERR("sqlite blob (%s) write failure while range (%u, %u) is invalid, blob size (%u)", m_name.c_str(), static_cast<uint32_t>(offset), static_cast<uint32_t>(size), static_cast<uint32_t>(m_size));
+        return false;
+    }
+
+    if (0 == size)
+    {
+        return true;
+    }
+
+    int result = sqlite3_blob_write(m_blob, data, static_cast<int>(size), static_cast<int>(offset));
     if (SQLITE_OK != result)
     {
-        RUN_LOG_ERR("sqlite %s (%s) set failure while bind failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        RUN_LOG_ERR("sqlite blob (%s) write failure, error (%d: %s)", m_name.c_str(), result, sqlite3_errstr(result));
         return false;
     }
 
     return true;
 }
 
-bool SQLiteStatement::set(int index, int64_t value)
+bool SQLiteBlob::reopen(int64_t rowid)
 {
-    if (nullptr == m_statement)
+    if (nullptr == m_blob)
     {
         return false;
     }
 
-    int result = sqlite3_bind_int64(m_statement, index + 1, value);
+    int result = sqlite3_blob_reopen(m_blob, rowid);
     if (SQLITE_OK != result)
     {
-        RUN_LOG_ERR("sqlite %s (%s) set failure while bind failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        // the handle is aborted after a failed reopen, any further read or write fails until the next good reopen
+        RUN_LOG_ERR("sqlite blob (%s) reopen failure while move to row (%lld) failed, error (%d: %s)", m_name.c_str(), static_cast<long long>(rowid), result, sqlite3_errstr(result));
+        m_size = 0;
         return false;
     }
 
+    m_rowid = rowid;
+    m_size = static_cast<size_t>(sqlite3_blob_bytes(m_blob));
+
     return true;
 }
 
-bool SQLiteStatement::set(int index, double value)
+SQLiteCheckpointConfig::SQLiteCheckpointConfig()
+    : poll_ms(100)
+    , interval_ms(1000)
+    , wal_size_trigger(4 * 1024 * 1024)
+    , truncate_size(64 * 1024 * 1024)
 {
-    if (nullptr == m_statement)
+
+}
+
+SQLiteCheckpointer::SQLiteCheckpointer()
+    : m_mutex()
+    , m_condition()
+    , m_running(false)
+    , m_requested(false)
+    , m_db()
+    , m_wal_path()
+    , m_config()
+    , m_thread()
+    , m_stats()
+    , m_total_duration_ns(0)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+SQLiteCheckpointer::~SQLiteCheckpointer()
+{
+    exit();
+}
+
+bool SQLiteCheckpointer::init(const std::string & path, const SQLiteCheckpointConfig & config)
+{
+    exit();
+
+    // busy checkpoints give up at once and retry on the next poll instead of stalling readers and writers
+    SQLiteOptions options;
+    options.busy_timeout = 0;
+    options.wal_autocheckpoint = 0;
+    options.statement_cache = 0;
+    options.no_mutex = true;
+    if (!m_db.init(path, options))
     {
+        RUN_LOG_ERR("sqlite checkpointer init failure while db (%s) init failed", path.c_str());
         return false;
     }
 
-    int result = sqlite3_bind_double(m_statement, index + 1, value);
-    if (SQLITE_OK != result)
+    if (!m_db.get_options(options) || "WAL" != options.journal_mode)
     {
-        RUN_LOG_ERR("sqlite %s (%s) set failure while bind failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
+        RUN_LOG_ERR("sqlite checkpointer init failure while db (%s) is not in wal mode", path.c_str());
+        m_db.exit();
         return false;
     }
 
+    // sqlite resolves the main file, so a "file:" URI name still finds the wal beside it
+    const char * filename = sqlite3_db_filename(m_db.m_sqlite, "main");
+    m_wal_path = (nullptr != filename && '\0' != filename[0] ? std::string(filename) : path) + "-wal";
+    m_config = config;
+    m_config.poll_ms = std::max<uint32_t>(m_config.poll_ms, 1);
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_total_duration_ns = 0;
+    m_requested = false;
+    m_running = true;
+
+    m_thread = std::thread(&SQLiteCheckpointer::run, this);
+
     return true;
 }
 
-bool SQLiteStatement::set(int index, const std::string & value)
+void SQLiteCheckpointer::exit()
 {
-    if (nullptr == m_statement)
     {
-        return false;
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_running = false;
+        m_condition.notify_all();
     }
 
-    int result = sqlite3_bind_text(m_statement, index + 1, value.c_str(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
-    if (SQLITE_OK != result)
+    if (m_thread.joinable())
     {
-        RUN_LOG_ERR("sqlite %s (%s) set failure while bind failed, error (%d: %s)", m_writer ? "writer" : "reader", m_sql.c_str(), result, sqlite3_errstr(result));
-        return false;
+        m_thread.join();
+    }
+
+    m_db.exit();
+}
+
+bool SQLiteCheckpointer::is_running() const
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_running;
+}
+
+void SQLiteCheckpointer::checkpoint_now()
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_requested = true;
+    m_condition.notify_all();
+}
+
+void SQLiteCheckpointer::get_stats(SQLiteCheckpointStats & stats)
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    stats = m_stats;
+    stats.average_duration_ns = (0 != m_stats.checkpoints ? m_total_duration_ns / m_stats.checkpoints : 0);
+}
+
+void SQLiteCheckpointer::run()
+{
+    uint64_t last_time = get_ns_time();
+
+    std::unique_lock<std::mutex> locker(m_mutex);
+    while (m_running)
+    {
+        m_condition.wait_for(locker, std::chrono::milliseconds(m_config.poll_ms), [this]() { return !m_running || m_requested; });
+        const bool requested = m_requested;
+        m_requested = false;
+        if (!m_running)
+        {
+            break;
+        }
+        locker.unlock();
+
+        struct stat wal_stat;
+        const uint64_t wal_bytes = (0 == stat(m_wal_path.c_str(), &wal_stat) ? static_cast<uint64_t>(wal_stat.st_size) : 0);
+        const uint64_t now_time = get_ns_time();
+        if (requested || wal_bytes >= m_config.wal_size_trigger || (wal_bytes > 0 && now_time - last_time >= static_cast<uint64_t>(m_config.interval_ms) * 1000000))
+        {
+            checkpoint(wal_bytes);
+            last_time = get_ns_time();
+        }
+
+        locker.lock();
+    }
+    locker.unlock();
+
+    // leave as little wal as possible behind for the next open
+    checkpoint(0);
+}
+
+void SQLiteCheckpointer::checkpoint(uint64_t wal_bytes)
+{
+    const uint64_t start_time = get_ns_time();
+
+    int log_frames = 0;
+    int checkpointed_frames = 0;
+    bool busy = false;
+    bool failed = false;
+    bool restarted = false;
+    bool truncated = false;
+
+    if (m_db.wal_checkpoint(SQLITE_CHECKPOINT_PASSIVE, &log_frames, &checkpointed_frames))
+    {
+        // every frame reached the database, so no reader needs the wal and it can start over from the beginning
+        if (log_frames > 0 && log_frames == checkpointed_frames)
+        {
+            const bool truncate = wal_bytes >= m_config.truncate_size;
+            if (m_db.wal_checkpoint(truncate ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_RESTART, &log_frames, &checkpointed_frames))
+            {
+                restarted = !truncate;
+                truncated = truncate;
+            }
+            else if (SQLITE_BUSY == m_db.error())
+            {
+                busy = true;
+            }
+            else
+            {
+                failed = true;
+            }
+        }
+        else if (log_frames > checkpointed_frames)
+        {
+            busy = true;
+        }
+    }
+    else if (SQLITE_BUSY == m_db.error())
+    {
+        busy = true;
+    }
+    else
+    {
+        failed = true;
     }
 
-    return true;
-}
+    const uint64_t duration_ns = get_ns_time() - start_time;
 
-bool SQLiteStatement::set(bool value)
-{
-    return set(m_set_index++, static_cast<int>(value));
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_stats.checkpoints += 1;
+    m_stats.restarts += (restarted ? 1 : 0);
+    m_stats.truncates += (truncated ? 1 : 0);
+    m_stats.busy += (busy ? 1 : 0);
+    m_stats.failures += (failed ? 1 : 0);
+    m_stats.wal_bytes = wal_bytes;
+    m_stats.max_wal_bytes = std::max(m_stats.max_wal_bytes, wal_bytes);
+    m_stats.last_duration_ns = duration_ns;
+    m_stats.max_duration_ns = std::max(m_stats.max_duration_ns, duration_ns);
+    m_stats.log_frames = log_frames;
+    m_stats.checkpointed_frames = checkpointed_frames;
+    m_total_duration_ns += duration_ns;
 }
 
-bool SQLiteStatement::set(int8_t value)
+SQLiteLease::SQLiteLease()
+    : m_pool(nullptr)
+    , m_db(nullptr)
+    , m_writer(false)
 {
-    return set(m_set_index++, static_cast<int>(value));
-}
 
-bool SQLiteStatement::set(uint8_t value)
-{
-    return set(m_set_index++, static_cast<int>(value));
 }
 
-bool SQLiteStatement::set(int16_t value)
+SQLiteLease::SQLiteLease(SQLitePool * pool, SQLiteDB * db, bool writer)
+    : m_pool(pool)
+    , m_db(db)
+    , m_writer(writer)
 {
-    return set(m_set_index++, static_cast<int>(value));
+
 }
 
-bool SQLiteStatement::set(uint16_t value)
+SQLiteLease::SQLiteLease(SQLiteLease && other)
+    : m_pool(nullptr)
+    , m_db(nullptr)
+    , m_writer(false)
 {
-    return set(m_set_index++, static_cast<int>(value));
+    std::swap(m_pool, other.m_pool);
+    std::swap(m_db, other.m_db);
+    std::swap(m_writer, other.m_writer);
 }
 
-bool SQLiteStatement::set(int32_t value)
+SQLiteLease & SQLiteLease::operator = (SQLiteLease && other)
 {
-    return set(m_set_index++, static_cast<int>(value));
+    if (&other != this)
+    {
+        release();
+        std::swap(m_pool, other.m_pool);
+        std::swap(m_db, other.m_db);
+        std::swap(m_writer, other.m_writer);
+    }
+    return *this;
 }
 
-bool SQLiteStatement::set(uint32_t value)
+SQLiteLease::~SQLiteLease()
 {
-    return set(m_set_index++, static_cast<int>(value));
+    release();
 }
 
-bool SQLiteStatement::set(int64_t value)
+bool SQLiteLease::good() const
 {
-    return set(m_set_index++, value);
+    return nullptr != m_db;
 }
 
-bool SQLiteStatement::set(uint64_t value)
+bool SQLiteLease::is_writer() const
 {
-    return set(m_set_index++, static_cast<int64_t>(value));
+    return m_writer;
 }
 
-bool SQLiteStatement::set(float value)
+void SQLiteLease::release()
 {
-    return set(m_set_index++, static_cast<double>(value));
+    if (nullptr != m_pool && nullptr != m_db)
+    {
+        m_pool->release(m_db, m_writer);
+    }
+    m_pool = nullptr;
+    m_db = nullptr;
+    m_writer = false;
 }
 
-bool SQLiteStatement::set(double value)
+SQLiteDB * SQLiteLease::operator -> () const
 {
-    return set(m_set_index++, value);
+    return m_db;
 }
 
-bool SQLiteStatement::set(const std::string & value)
+SQLiteDB & SQLiteLease::operator * () const
 {
-    return set(m_set_index++, value);
+    return *m_db;
 }
 
-SQLiteReader::SQLiteReader()
-    : SQLiteStatement()
+SQLitePool::SQLitePool()
+    : m_mutex()
+    , m_writer_condition()
+    , m_reader_condition()
+    , m_running(false)
+    , m_writer()
+    , m_writer_busy(false)
+    , m_readers()
+    , m_idle_readers()
+    , m_leases(0)
+    , m_path()
+    , m_checkpointer()
 {
 
 }
 
-SQLiteReader::SQLiteReader(sqlite3 * sqlite, const std::string & sql)
-    : SQLiteStatement(sqlite, sql, false)
+SQLitePool::~SQLitePool()
 {
-
+    exit();
 }
 
-bool SQLiteReader::read()
+bool SQLitePool::init(const std::string & path, size_t reader_count, const SQLiteOptions & options)
 {
-    if (nullptr == m_statement)
+    exit();
+
+    if (path.empty() || ":memory:" == path)
     {
+        RUN_LOG_ERR("sqlite pool init failure while path (%s) is invalid", path.c_str());
         return false;
     }
 
-    m_get_index = 0;
-
-    int result = sqlite3_step(m_statement);
-    if (SQLITE_ROW != result && SQLITE_DONE != result)
+    // a lease hands each connection to one thread at a time, so the pool skips the per connection mutex
+    SQLiteOptions writer_options(options);
+    writer_options.read_only = false;
+    writer_options.no_mutex = true;
+    if (writer_options.journal_mode.empty())
     {
-        RUN_LOG_ERR("sqlite reader (%s) read failure while step failed, error (%d: %s, %d: %s)", m_sql.c_str(), result, sqlite3_errstr(result), sqlite3_errcode(m_sqlite), sqlite3_errmsg(m_sqlite));
+        writer_options.journal_mode = "WAL";
     }
 
-    return SQLITE_ROW == result;
-}
-
-bool SQLiteReader::get(int index, int & value)
-{
-    if (nullptr == m_statement)
+    if (!m_writer.init(path, writer_options))
     {
+        RUN_LOG_ERR("sqlite pool init failure while writer (%s) init failed", path.c_str());
         return false;
     }
 
-    if (index >= sqlite3_column_count(m_statement))
+    SQLiteOptions reader_options(writer_options);
+    reader_options.read_only = true;
+    reader_options.journal_mode.clear();
+    reader_options.page_size = 0;
+
+    for (size_t index = 0; index < reader_count; ++index)
     {
-        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
-        return false;
+        SQLiteDB * reader = new SQLiteDB;
+        if (!reader->init(path, reader_options))
+        {
+            RUN_LOG_ERR("sqlite pool init failure while reader (%s) init failed", path.c_str());
+            delete reader;
+            exit();
+            return false;
+        }
+        m_readers.push_back(reader);
     }
 
-    value = sqlite3_column_int(m_statement, index);
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_idle_readers = m_readers;
+    m_writer_busy = false;
+    m_running = true;
+    m_path = path;
 
     return true;
 }
 
-bool SQLiteReader::get(int index, int64_t & value)
+void SQLitePool::exit()
 {
-    if (nullptr == m_statement)
+    m_checkpointer.exit();
+
     {
-        return false;
+        std::unique_lock<std::mutex> locker(m_mutex);
+        m_running = false;
+        m_writer_condition.notify_all();
+        m_reader_condition.notify_all();
+        if (0 != m_leases)
+        {
+            RUN_LOG_WAR("sqlite pool exit wait for (%u) leases", static_cast<uint32_t>(m_leases));
+            m_writer_condition.wait(locker, [this]() { return 0 == m_leases; });
+        }
+        m_idle_readers.clear();
     }
 
-    if (index >= sqlite3_column_count(m_statement))
+    for (std::vector<SQLiteDB *>::iterator iter = m_readers.begin(); m_readers.end() != iter; ++iter)
     {
-        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
-        return false;
+        delete *iter;
     }
+    m_readers.clear();
 
-    value = sqlite3_column_int64(m_statement, index);
-
-    return true;
+    m_writer.exit();
+    m_path.clear();
 }
 
-bool SQLiteReader::get(int index, double & value)
+bool SQLitePool::start_checkpointer(const SQLiteCheckpointConfig & config)
 {
-    if (nullptr == m_statement)
+    SQLiteLease writer(acquire_writer());
+    if (!writer.good())
     {
+        RUN_LOG_ERR("sqlite pool start checkpointer failure while pool is not open");
         return false;
     }
 
-    if (index >= sqlite3_column_count(m_statement))
+    if (!writer->execute("PRAGMA wal_autocheckpoint = 0;"))
     {
-        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
+        RUN_LOG_ERR("sqlite pool start checkpointer failure while disable auto checkpoint failed");
         return false;
     }
 
-    value = sqlite3_column_double(m_statement, index);
-
-    return true;
+    return m_checkpointer.init(m_path, config);
 }
 
-bool SQLiteReader::get(int index, std::string & value)
+bool SQLitePool::get_checkpoint_stats(SQLiteCheckpointStats & stats)
 {
-    if (nullptr == m_statement)
+    if (!m_checkpointer.is_running())
     {
         return false;
     }
+    m_checkpointer.get_stats(stats);
+    return true;
+}
 
-    if (index >= sqlite3_column_count(m_statement))
-    {
-        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
-        return false;
-    }
+bool SQLitePool::is_open() const
+{
+    return m_running;
+}
 
-    const char * column_text = reinterpret_cast<const char *>(sqlite3_column_text(m_statement, index));
-    int column_size = sqlite3_column_bytes(m_statement, index);
-    value.assign(column_text, column_size);
+size_t SQLitePool::reader_count() const
+{
+    return m_readers.size();
+}
 
-    return true;
+SQLiteLease SQLitePool::acquire_reader(uint32_t timeout_ms)
+{
+    return acquire(m_readers.empty(), timeout_ms);
 }
 
-bool SQLiteReader::get(void * ignore)
+SQLiteLease SQLitePool::acquire_writer(uint32_t timeout_ms)
 {
-    if (nullptr == m_statement)
+    return acquire(true, timeout_ms);
+}
+
+SQLiteLease SQLitePool::acquire(bool writer, uint32_t timeout_ms)
+{
+    std::unique_lock<std::mutex> locker(m_mutex);
+
+    std::condition_variable & condition = writer ? m_writer_condition : m_reader_condition;
+    auto available = [this, writer]() { return !m_running || (writer ? !m_writer_busy : !m_idle_readers.empty()); };
+
+    if (0 == timeout_ms)
     {
-        return false;
+        condition.wait(locker, available);
+    }
+    else if (!condition.wait_for(locker, std::chrono::milliseconds(timeout_ms), available))
+    {
+        RUN_LOG_WAR("sqlite pool acquire %s failure while wait timeout (%u ms)", writer ? "writer" : "reader", timeout_ms);
+        return SQLiteLease();
     }
 
-    int index = m_get_index++;
-    if (index >= sqlite3_column_count(m_statement))
+    if (!m_running)
     {
-        RUN_LOG_ERR("sqlite reader (%s) get failure while get index is overflow (%d >= %d)", m_sql.c_str(), index, sqlite3_column_count(m_statement));
-        return false;
+        return SQLiteLease();
     }
 
-    PARAMS_IGN(ignore);
+    SQLiteDB * db = nullptr;
+    if (writer)
+    {
+        m_writer_busy = true;
+        db = &m_writer;
+    }
+    else
+    {
+        db = m_idle_readers.back();
+        m_idle_readers.pop_back();
+    }
+    ++m_leases;
 
-    return true;
+    return SQLiteLease(this, db, writer);
 }
 
-bool SQLiteReader::get(bool & value)
+void SQLitePool::release(SQLiteDB * db, bool writer)
 {
-    int dummy = 0;
-    bool result = get(m_get_index++, dummy);
-    value = static_cast<bool>(dummy);
-    return result;
-}
+    std::lock_guard<std::mutex> locker(m_mutex);
 
-bool SQLiteReader::get(int8_t & value)
-{
-    int dummy = 0;
-    bool result = get(m_get_index++, dummy);
-    value = static_cast<int8_t>(dummy);
-    return result;
-}
+    if (writer)
+    {
+        m_writer_busy = false;
+    }
+    else
+    {
+        m_idle_readers.push_back(db);
+    }
+    --m_leases;
 
-bool SQLiteReader::get(uint8_t & value)
-{
-    int dummy = 0;
-    bool result = get(m_get_index++, dummy);
-    value = static_cast<uint8_t>(dummy);
-    return result;
+    if (writer || 0 == m_leases)
+    {
+        m_writer_condition.notify_all();
+    }
+    if (!writer)
+    {
+        m_reader_condition.notify_one();
+    }
 }
 
-bool SQLiteReader::get(int16_t & value)
+SQLiteWriteQueue::SQLiteWriteQueue()
+    : m_mutex()
+    , m_producer_condition()
+    , m_consumer_condition()
+    , m_running(false)
+    , m_db(nullptr)
+    , m_capacity(0)
+    , m_max_batch(0)
+    , m_window_ms(0)
+    , m_requests()
+    , m_thread()
+    , m_submitted(0)
+    , m_succeeded(0)
+    , m_failed(0)
+    , m_transactions(0)
+    , m_max_batch_size(0)
+    , m_total_latency_ns(0)
+    , m_max_latency_ns(0)
 {
-    int dummy = 0;
-    bool result = get(m_get_index++, dummy);
-    value = static_cast<int16_t>(dummy);
-    return result;
-}
 
-bool SQLiteReader::get(uint16_t & value)
-{
-    int dummy = 0;
-    bool result = get(m_get_index++, dummy);
-    value = static_cast<uint16_t>(dummy);
-    return result;
 }
 
-bool SQLiteReader::get(int32_t & value)
+SQLiteWriteQueue::~SQLiteWriteQueue()
 {
-    int dummy = 0;
-    bool result = get(m_get_index++, dummy);
-    value = static_cast<int32_t>(dummy);
-    return result;
+    exit();
 }
 
-bool SQLiteReader::get(uint32_t & value)
+bool SQLiteWriteQueue::init(SQLiteDB & db, size_t capacity, size_t max_batch, uint32_t window_ms)
 {
-    int dummy = 0;
-    bool result = get(m_get_index++, dummy);
-    value = static_cast<uint32_t>(dummy);
-    return result;
-}
+    exit();
 
-bool SQLiteReader::get(int64_t & value)
-{
-    return get(m_get_index++, value);
-}
+    if (!db.is_open() || 0 == capacity || 0 == max_batch)
+    {
+        RUN_LOG_ERR("sqlite write queue init failure while db is not open or arguments are invalid");
+        return false;
+    }
 
-bool SQLiteReader::get(uint64_t & value)
-{
-    int64_t dummy = 0;
-    bool result = get(m_get_index++, dummy);
-    value = static_cast<uint64_t>(dummy);
-    return result;
+    m_db = &db;
+    m_capacity = capacity;
+    m_max_batch = max_batch;
+    m_window_ms = window_ms;
+    m_submitted = 0;
+    m_succeeded = 0;
+    m_failed = 0;
+    m_transactions = 0;
+    m_max_batch_size = 0;
+    m_total_latency_ns = 0;
+    m_max_latency_ns = 0;
+    m_running = true;
+
+    m_thread = std::thread(&SQLiteWriteQueue::run, this);
+
+    return true;
 }
 
-bool SQLiteReader::get(float & value)
+void SQLiteWriteQueue::exit()
 {
-    double dummy = 0;
-    bool result = get(m_get_index++, dummy);
-    value = static_cast<float>(dummy);
-    return result;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_running = false;
+        m_producer_condition.notify_all();
+        m_consumer_condition.notify_all();
+    }
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    m_db = nullptr;
 }
 
-bool SQLiteReader::get(double & value)
+bool SQLiteWriteQueue::submit(const SQLiteWriteTask & task, const SQLiteWriteCallback & callback, uint32_t timeout_ms)
 {
-    return get(m_get_index++, value);
+    if (!task)
+    {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> locker(m_mutex);
+
+    auto available = [this]() { return !m_running || m_requests.size() < m_capacity; };
+    if (0 == timeout_ms)
+    {
+        m_producer_condition.wait(locker, available);
+    }
+    else if (!m_producer_condition.wait_for(locker, std::chrono::milliseconds(timeout_ms), available))
+    {
+        RUN_LOG_WAR("sqlite write queue submit failure while wait timeout (%u ms)", timeout_ms);
+        return false;
+    }
+
+    if (!m_running)
+    {
+        return false;
+    }
+
+    request_t request = { task, callback, get_ns_time() };
+    m_requests.push_back(std::move(request));
+    ++m_submitted;
+
+    if (1 == m_requests.size() || m_requests.size() >= m_max_batch)
+    {
+        m_consumer_condition.notify_one();
+    }
+
+    return true;
 }
 
-bool SQLiteReader::get(std::string & value)
+std::future<bool> SQLiteWriteQueue::submit(const SQLiteWriteTask & task, uint32_t timeout_ms)
 {
-    return get(m_get_index++, value);
+    std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> future = promise->get_future();
+    if (!submit(task, [promise](bool success) { promise->set_value(success); }, timeout_ms))
+    {
+        promise->set_value(false);
+    }
+    return future;
 }
 
-SQLiteWriter::SQLiteWriter()
-    : SQLiteStatement()
+void SQLiteWriteQueue::get_stats(SQLiteWriteQueueStats & stats)
 {
-
+    std::lock_guard<std::mutex> locker(m_mutex);
+    const uint64_t completed = m_succeeded + m_failed;
+    stats.submitted = m_submitted;
+    stats.succeeded = m_succeeded;
+    stats.failed = m_failed;
+    stats.transactions = m_transactions;
+    stats.max_batch = m_max_batch_size;
+    stats.average_batch = (0 != m_transactions ? static_cast<double>(completed) / static_cast<double>(m_transactions) : 0.0);
+    stats.average_latency_ns = (0 != completed ? m_total_latency_ns / completed : 0);
+    stats.max_latency_ns = m_max_latency_ns;
+    stats.pending = m_requests.size();
 }
 
-SQLiteWriter::SQLiteWriter(sqlite3 * sqlite, const std::string & sql)
-    : SQLiteStatement(sqlite, sql, true)
+void SQLiteWriteQueue::run()
 {
+    std::vector<request_t> requests;
+    requests.reserve(m_max_batch);
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> locker(m_mutex);
+            m_consumer_condition.wait(locker, [this]() { return !m_running || !m_requests.empty(); });
+            if (m_requests.empty())
+            {
+                break;
+            }
+            if (m_running && m_requests.size() < m_max_batch && 0 != m_window_ms)
+            {
+                m_consumer_condition.wait_for(locker, std::chrono::milliseconds(m_window_ms), [this]() { return !m_running || m_requests.size() >= m_max_batch; });
+            }
+            while (!m_requests.empty() && requests.size() < m_max_batch)
+            {
+                requests.push_back(std::move(m_requests.front()));
+                m_requests.pop_front();
+            }
+            m_producer_condition.notify_all();
+        }
 
+        commit(requests);
+        requests.clear();
+    }
 }
 
-bool SQLiteWriter::write()
+void SQLiteWriteQueue::commit(std::vector<request_t> & requests)
 {
-    if (nullptr == m_statement)
+    std::vector<bool> results(requests.size(), false);
+
+    bool committed = m_db->execute("BEGIN TRANSACTION;");
+    if (committed)
     {
-        return false;
+        for (size_t index = 0; index < requests.size(); ++index)
+        {
+            if (!m_db->savepoint_begin("write_queue_task"))
+            {
+                continue;
+            }
+            results[index] = requests[index].task(*m_db);
+            if (!results[index])
+            {
+                m_db->savepoint_rollback("write_queue_task");
+            }
+            m_db->savepoint_release("write_queue_task");
+        }
+        committed = m_db->execute("COMMIT TRANSACTION;");
+        if (!committed)
+        {
+            RUN_LOG_ERR("sqlite write queue commit failure, (%u) requests failed", static_cast<uint32_t>(requests.size()));
+            m_db->execute("ROLLBACK TRANSACTION;");
+        }
     }
 
-    int result = sqlite3_step(m_statement);
-    if (SQLITE_ERROR == result || SQLITE_MISUSE == result)
+    const uint64_t finish_time = get_ns_time();
+    uint64_t succeeded = 0;
+    uint64_t total_latency = 0;
+    uint64_t max_latency = 0;
+    for (size_t index = 0; index < requests.size(); ++index)
     {
-        RUN_LOG_ERR("sqlite writer (%s) write failure while step failed, error (%d: %s, %d: %s)", m_sql.c_str(), result, sqlite3_errstr(result), sqlite3_errcode(m_sqlite), sqlite3_errmsg(m_sqlite));
-        return false;
+        const bool success = committed && results[index];
+        const uint64_t latency = finish_time - requests[index].submit_time;
+        succeeded += success ? 1 : 0;
+        total_latency += latency;
+        max_latency = std::max(max_latency, latency);
+        if (requests[index].callback)
+        {
+            requests[index].callback(success);
+        }
     }
 
-    return true;
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_succeeded += succeeded;
+    m_failed += requests.size() - succeeded;
+    m_transactions += 1;
+    m_max_batch_size = std::max<uint64_t>(m_max_batch_size, requests.size());
+    m_total_latency_ns += total_latency;
+    m_max_latency_ns = std::max(m_max_latency_ns, max_latency);
 }
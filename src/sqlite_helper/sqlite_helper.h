@@ -12,13 +12,335 @@
 
 #include <cstdint>
 #include <string>
+#include <list>
+#include <deque>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <condition_variable>
 #include "macros.h"
+#include "sqlite_kv_store.h"
 
 struct sqlite3;
 struct sqlite3_stmt;
+struct sqlite3_blob;
+struct sqlite3_value;
+struct sqlite3_context;
 
+// declares the ordered field list of a row struct for SQLiteStatement::bind_fields() and SQLiteReader::read_fields()
+#define SQLITE_ROW_FIELDS(...)                                                                                  \
+    auto sqlite_fields() -> decltype(std::tie(__VA_ARGS__)) { return std::tie(__VA_ARGS__); }                   \
+    auto sqlite_fields() const -> decltype(std::tie(__VA_ARGS__)) { return std::tie(__VA_ARGS__); }
+
+class SQLiteStatement;
 class SQLiteReader;
 class SQLiteWriter;
+class SQLiteBlob;
+class SQLiteUpsert;
+class SQLitePool;
+
+struct GOOFER_API SQLiteOptions
+{
+    SQLiteOptions();
+
+    static SQLiteOptions durable();
+    static SQLiteOptions fast_wal();
+    static SQLiteOptions read_mostly();
+    static SQLiteOptions profile(const std::string & name); // "durable", "fast-wal", "read-mostly"
+
+    std::string                             journal_mode;   // DELETE, TRUNCATE, PERSIST, MEMORY, WAL, OFF; empty to keep default
+    int                                     synchronous;    // 0: OFF, 1: NORMAL, 2: FULL, 3: EXTRA; -1 to keep default
+    int64_t                                 mmap_size;      // bytes; -1 to keep default
+    int64_t                                 cache_size;     // pages if positive, KiB if negative; 0 to keep default
+    int                                     page_size;      // bytes; 0 to keep default
+    int                                     temp_store;     // 0: DEFAULT, 1: FILE, 2: MEMORY; -1 to keep default
+    int                                     busy_timeout;   // milliseconds; -1 to keep default
+    int                                     wal_autocheckpoint; // wal pages that trigger an inline checkpoint on commit; 0 to disable; -1 to keep default
+    size_t                                  statement_cache;// prepared statements kept by SQLiteDB; 0 to disable
+    bool                                    read_only;      // open with SQLITE_OPEN_READONLY
+    bool                                    no_mutex;       // open with SQLITE_OPEN_NOMUTEX, the connection must then be used by one thread at a time
+};
+
+struct GOOFER_API SQLiteMemoryConfig // process wide, applied before any database is opened
+{
+    SQLiteMemoryConfig();
+
+    int                                     page_cache_page_size;   // SQLITE_CONFIG_PAGECACHE page size in bytes; 0 to keep default
+    int                                     page_cache_pages;       // pages in the static page cache
+    int                                     lookaside_slot_size;    // SQLITE_CONFIG_LOOKASIDE slot size in bytes; 0 to keep default
+    int                                     lookaside_slots;        // lookaside slots per connection
+    bool                                    memory_status;          // SQLITE_CONFIG_MEMSTATUS, false saves a global mutex per allocation
+    size_t                                  heap_size;              // SQLITE_CONFIG_HEAP arena bytes, needs SQLITE_ENABLE_MEMSYS5; 0 to use malloc
+    int                                     heap_min_alloc;         // smallest arena allocation, a power of two
+};
+
+struct GOOFER_API SQLiteMemoryStats
+{
+    int64_t                                 memory_used;            // all of the counters except the lookaside ones read 0 while memory_status is off
+    int64_t                                 memory_highwater;
+    int64_t                                 malloc_count;
+    int64_t                                 malloc_size_highwater;
+    int64_t                                 page_cache_used;
+    int64_t                                 page_cache_overflow;
+    int64_t                                 page_cache_size_highwater;
+    int64_t                                 lookaside_used;         // connection counters, 0 for the process wide stats
+    int64_t                                 lookaside_hits;
+    int64_t                                 lookaside_misses;
+    int64_t                                 cache_used;
+};
+
+struct GOOFER_API SQLiteCheckpointConfig
+{
+    SQLiteCheckpointConfig();
+
+    uint32_t                                poll_ms;            // how often the wal size is checked
+    uint32_t                                interval_ms;        // a non-empty wal is checkpointed at least this often
+    uint64_t                                wal_size_trigger;   // bytes of wal that trigger a checkpoint before the interval
+    uint64_t                                truncate_size;      // bytes of wal above which a complete checkpoint escalates to TRUNCATE instead of RESTART
+};
+
+struct GOOFER_API SQLiteCheckpointStats
+{
+    uint64_t                                checkpoints;
+    uint64_t                                restarts;
+    uint64_t                                truncates;
+    uint64_t                                busy;               // checkpoints that could not finish or escalate because of readers or writers
+    uint64_t                                failures;
+    uint64_t                                wal_bytes;          // wal file size before the last checkpoint
+    uint64_t                                max_wal_bytes;
+    uint64_t                                last_duration_ns;
+    uint64_t                                max_duration_ns;
+    uint64_t                                average_duration_ns;
+    int                                     log_frames;         // frames in the wal after the last checkpoint
+    int                                     checkpointed_frames;
+};
+
+struct GOOFER_API SQLiteCacheStats
+{
+    uint64_t                                hits;
+    uint64_t                                misses;
+    uint64_t                                evictions;
+    size_t                                  size;
+    size_t                                  capacity;
+    size_t                                  borrowed;
+};
+
+struct GOOFER_API SQLiteBatchStats
+{
+    uint64_t                                rows;
+    uint64_t                                statements;
+    uint64_t                                transactions;
+    uint64_t                                changes;        // rows inserted, updated or deleted, sqlite3_changes() summed over the statements
+    uint64_t                                elapsed_ns;
+    double                                  rows_per_second;
+};
+
+struct GOOFER_API SQLiteProfileEntry
+{
+    enum { histogram_size = 20 };                           // bucket 0: < 1us, bucket i: [2^(i-1)us, 2^i us), last bucket: the rest
+
+    std::string                             sql;
+    uint64_t                                calls;
+    uint64_t                                total_ns;
+    uint64_t                                max_ns;
+    uint64_t                                histogram[histogram_size];
+    uint64_t                                fullscan_steps; // SQLITE_STMTSTATUS_FULLSCAN_STEP
+    uint64_t                                sorts;          // SQLITE_STMTSTATUS_SORT
+    uint64_t                                autoindexes;    // SQLITE_STMTSTATUS_AUTOINDEX
+    uint64_t                                vm_steps;       // SQLITE_STMTSTATUS_VM_STEP
+};
+
+enum class SQLiteChangeOp
+{
+    insert,
+    update,
+    remove
+};
+
+struct GOOFER_API SQLiteChange
+{
+    SQLiteChangeOp                          op;
+    std::string                             table;
+    int64_t                                 rowid;
+};
+
+class GOOFER_API SQLiteRow
+{
+public:
+    int columns() const;
+    int type(int index) const; // SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB, SQLITE_NULL
+    bool is_null(int index) const;
+    int64_t get_int64(int index) const;
+    double get_double(int index) const;
+    SQLiteView get_text(int index) const;
+    SQLiteView get_blob(int index) const;
+
+private:
+    friend class SQLiteReader;
+
+private:
+    SQLiteRow(sqlite3_stmt * statement, int columns);
+
+private:
+    sqlite3_stmt                          * m_statement;
+    int                                     m_columns;
+};
+
+class GOOFER_API SQLiteColumnBatch // column types are fixed by the first batch, buffers are reused across batches
+{
+public:
+    SQLiteColumnBatch();
+
+public:
+    void clear();
+    size_t rows() const;
+    size_t columns() const;
+    int type(size_t column) const; // SQLITE_INTEGER, SQLITE_FLOAT or SQLITE_TEXT (text and blob bytes)
+    const uint8_t * nulls(size_t column) const;
+    const int64_t * integers(size_t column) const;
+    const double * doubles(size_t column) const;
+    const size_t * offsets(size_t column) const; // rows() + 1 offsets into bytes()
+    const char * bytes(size_t column) const;
+    SQLiteView text(size_t column, size_t row) const;
+
+private:
+    friend class SQLiteReader;
+
+private:
+    struct column_t
+    {
+        int                                 type;
+        std::vector<uint8_t>                nulls;
+        std::vector<int64_t>                integers;
+        std::vector<double>                 doubles;
+        std::vector<size_t>                 offsets;
+        std::vector<char>                   bytes;
+    };
+
+private:
+    std::vector<column_t>                   m_columns;
+    size_t                                  m_rows;
+};
+
+class GOOFER_API SQLiteFunctionArgs // valid only inside the function callback, NULL reads as 0 or empty
+{
+public:
+    int count() const;
+    int type(int index) const; // SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB, SQLITE_NULL
+    bool is_null(int index) const;
+
+public:
+    bool get(int index, bool & value) const;
+    bool get(int index, int8_t & value) const;
+    bool get(int index, uint8_t & value) const;
+    bool get(int index, int16_t & value) const;
+    bool get(int index, uint16_t & value) const;
+    bool get(int index, int32_t & value) const;
+    bool get(int index, uint32_t & value) const;
+    bool get(int index, int64_t & value) const;
+    bool get(int index, uint64_t & value) const;
+    bool get(int index, float & value) const;
+    bool get(int index, double & value) const;
+    bool get(int index, std::string & value) const;
+    bool get(int index, SQLiteView & value) const;
+
+public:
+    bool get_blob(int index, std::string & value) const;
+    bool get_blob(int index, SQLiteView & value) const;
+
+private:
+    friend class SQLiteDB;
+
+private:
+    SQLiteFunctionArgs(int count, sqlite3_value ** values);
+    bool check_index(int index) const;
+
+private:
+    int                                     m_count;
+    sqlite3_value                        ** m_values;
+};
+
+class GOOFER_API SQLiteFunctionResult // valid only inside the function callback
+{
+public:
+    void set(bool value);
+    void set(int8_t value);
+    void set(uint8_t value);
+    void set(int16_t value);
+    void set(uint16_t value);
+    void set(int32_t value);
+    void set(uint32_t value);
+    void set(int64_t value);
+    void set(uint64_t value);
+    void set(float value);
+    void set(double value);
+    void set(const char * value, bool copy = true);
+    void set(const std::string & value, bool copy = true);
+    void set(const SQLiteView & value, bool copy = true);
+
+public:
+    void set_blob(const void * data, size_t size, bool copy = true);
+    void set_blob(const std::string & value, bool copy = true);
+    void set_null();
+    void set_error(const std::string & message); // fails the statement with this message
+
+private:
+    friend class SQLiteDB;
+
+private:
+    explicit SQLiteFunctionResult(sqlite3_context * context);
+
+private:
+    sqlite3_context                       * m_context;
+};
+
+class GOOFER_API SQLiteAggregate // one object per group, created by the factory and deleted after the final value
+{
+public:
+    virtual ~SQLiteAggregate();
+
+public:
+    virtual void step(const SQLiteFunctionArgs & args) = 0;
+    virtual void inverse(const SQLiteFunctionArgs & args); // window functions only, removes the oldest row of the frame
+    virtual void value(SQLiteFunctionResult & result) = 0; // current value of the group, also the final value
+};
+
+typedef std::function<void (const SQLiteFunctionArgs & args, SQLiteFunctionResult & result)> SQLiteScalarFunction;
+typedef std::function<SQLiteAggregate * ()> SQLiteAggregateFactory;
+enum class SQLiteConflict
+{
+    update,                                 // INSERT ... ON CONFLICT (keys) DO UPDATE, UPDATE then INSERT before sqlite 3.24.0
+    replace,                                // INSERT OR REPLACE, deletes the old row
+    ignore                                  // INSERT OR IGNORE, keeps the old row
+};
+
+typedef std::function<bool (SQLiteStatement & statement, size_t row)> SQLiteRowBinder;
+typedef std::function<bool (const SQLiteRow & row)> SQLiteRowVisitor;
+typedef std::function<bool (int remaining_pages, int total_pages)> SQLiteBackupProgress; // return false to abort
+typedef std::function<void (const std::vector<SQLiteChange> & changes)> SQLiteChangeListener; // changes of one committed transaction
+
+class GOOFER_API SQLiteMemoryInit // a static instance configures sqlite memory before main() opens any database
+{
+public:
+    explicit SQLiteMemoryInit(const SQLiteMemoryConfig & config);
+    SQLiteMemoryInit(const SQLiteMemoryInit & other) = delete;
+    SQLiteMemoryInit(SQLiteMemoryInit && other) = delete;
+    SQLiteMemoryInit & operator = (const SQLiteMemoryInit & other) = delete;
+    SQLiteMemoryInit & operator = (SQLiteMemoryInit && other) = delete;
+
+public:
+    bool good() const;
+
+private:
+    bool                                    m_good;
+};
 
 class GOOFER_API SQLiteDB
 {
@@ -32,10 +354,20 @@ public:
 
 public:
     bool init(const std::string & path);
+    bool init(const std::string & path, const SQLiteOptions & options);
     void exit();
 
+public: // opens a private in-memory database and copies the whole file into it in one step
+    bool load(const std::string & path, const SQLiteOptions & options = SQLiteOptions());
+
+public: // configure_memory() fails once the first database of the process is opened
+    static bool configure_memory(const SQLiteMemoryConfig & config);
+    static void get_process_memory_stats(SQLiteMemoryStats & stats, bool reset_highwater = false);
+    bool get_memory_stats(SQLiteMemoryStats & stats, bool reset_highwater = false) const;
+
 public:
     bool is_open() const;
+    bool get_options(SQLiteOptions & options) const;
     int error() const;
     const char * what() const;
 
@@ -44,13 +376,163 @@ public:
     bool transaction_begin();
     bool transaction_end();
 
+public: // savepoints opened here are known to change notifications, ROLLBACK TO one opened by execute() is not
+    bool savepoint_begin(const std::string & name);
+    bool savepoint_release(const std::string & name);
+    bool savepoint_rollback(const std::string & name); // undoes the changes since savepoint_begin() and keeps the savepoint open
+
+public: // mode: 0: PASSIVE, 1: FULL, 2: RESTART, 3: TRUNCATE; on false error() tells SQLITE_BUSY from real failures
+    bool wal_checkpoint(int mode, int * log_frames = nullptr, int * checkpointed_frames = nullptr);
+
 public:
     SQLiteReader create_reader(const std::string & sql);
     SQLiteWriter create_writer(const std::string & sql);
+    SQLiteUpsert create_upsert(const std::string & table, const std::vector<std::string> & columns, const std::vector<std::string> & keys, SQLiteConflict conflict = SQLiteConflict::update);
+
+public: // online backup, pages_per_step < 0 copies everything in one step, the source stays writable between steps
+    bool backup_to(const std::string & path, int pages_per_step = 256, uint32_t sleep_ms = 0, const SQLiteBackupProgress & progress = SQLiteBackupProgress());
+    bool backup_to(SQLiteDB & target, int pages_per_step = 256, uint32_t sleep_ms = 0, const SQLiteBackupProgress & progress = SQLiteBackupProgress());
+    bool restore_from(const std::string & path, int pages_per_step = 256, uint32_t sleep_ms = 0, const SQLiteBackupProgress & progress = SQLiteBackupProgress());
+    bool restore_from(SQLiteDB & source, int pages_per_step = 256, uint32_t sleep_ms = 0, const SQLiteBackupProgress & progress = SQLiteBackupProgress());
+
+public: // the blob keeps its size, allocate it first with SQLiteStatement::set_zeroblob()
+    SQLiteBlob open_blob(const std::string & table, const std::string & column, int64_t rowid, bool writable = false);
+
+public:
+    void set_statement_cache(size_t capacity);
+    void get_statement_cache_stats(SQLiteCacheStats & stats) const;
+    void clear_statement_cache();
+
+public: // arg_count -1 accepts any number of arguments, registering the same name and arg_count again replaces the function
+    bool register_function(const std::string & name, int arg_count, const SQLiteScalarFunction & function, bool deterministic = true);
+    bool register_aggregate(const std::string & name, int arg_count, const SQLiteAggregateFactory & factory, bool deterministic = true);
+    bool register_window(const std::string & name, int arg_count, const SQLiteAggregateFactory & factory, bool deterministic = true); // needs sqlite 3.25.0
+    bool unregister_function(const std::string & name, int arg_count);
+
+    template <typename Result, typename ... Args>
+    bool register_function(const std::string & name, const std::function<Result (Args ...)> & function, bool deterministic = true)
+    {
+        return register_function(name, static_cast<int>(sizeof ... (Args)), [function](const SQLiteFunctionArgs & args, SQLiteFunctionResult & result) {
+            call_function(function, args, result, std::index_sequence_for<Args ...>());
+        }, deterministic);
+    }
+
+public: // exposes the store as the read only table temp.<table> (key TEXT, value BLOB), key equality and ranges seek the cursor
+       // the store must stay alive until unregister_kv_table() or exit()
+    bool register_kv_table(const std::string & table, SQLiteKVStore & store);
+    bool unregister_kv_table(const std::string & table);
+
+public: // profiling is off by default, no trace callback is installed until it is enabled
+    bool set_profile(bool enable);
+    bool is_profiling() const;
+    void get_profile(std::vector<SQLiteProfileEntry> & entries, size_t top_n = 10) const; // ordered by total time
+    void clear_profile();
+
+public: // listeners run on the committing thread once its COMMIT succeeded, still inside that statement, and must not use this connection
+       // an empty table matches every table, changes undone by savepoint_rollback() or by a statement that failed are dropped
+    uint32_t subscribe_changes(const SQLiteChangeListener & listener, const std::string & table = std::string()); // 0 on failure
+    bool unsubscribe_changes(uint32_t subscription);
+
+private:
+    friend class SQLiteStatement;
+    friend class SQLiteCheckpointer;
+
+private: // statements share the cache with their db, a statement that outlives exit() or the db is finalized on release
+    struct statement_cache_t;
+    typedef std::shared_ptr<statement_cache_t> statement_cache_ptr_t;
+
+    static sqlite3_stmt * acquire_statement(const statement_cache_ptr_t & cache, const std::string & sql, bool writer);
+    static void release_statement(const statement_cache_ptr_t & cache, const std::string & sql, sqlite3_stmt * statement);
+    static void shrink_statement_cache(statement_cache_t & cache, size_t capacity);
+
+private:
+    bool apply_options(const SQLiteOptions & options);
+    bool pragma_set(const std::string & name, const std::string & value);
+    bool pragma_get(const std::string & name, int64_t & value) const;
+    bool pragma_get(const std::string & name, std::string & value) const;
+
+private:
+    template <typename Result, typename ... Args, size_t ... Index>
+    static void call_function(const std::function<Result (Args ...)> & function, const SQLiteFunctionArgs & args, SQLiteFunctionResult & result, std::index_sequence<Index ...>)
+    {
+        std::tuple<typename std::decay<Args>::type ...> values;
+        const bool results[] = { true, args.get(static_cast<int>(Index), std::get<Index>(values)) ... };
+        for (size_t index = 0; index < sizeof(results) / sizeof(results[0]); ++index)
+        {
+            if (!results[index])
+            {
+                result.set_error("invalid function arguments");
+                return;
+            }
+        }
+        result.set(function(std::get<Index>(values) ...));
+    }
+
+private:
+    static void function_scalar(sqlite3_context * context, int count, sqlite3_value ** values);
+    static void function_step(sqlite3_context * context, int count, sqlite3_value ** values);
+    static void function_inverse(sqlite3_context * context, int count, sqlite3_value ** values);
+    static void function_value(sqlite3_context * context);
+    static void function_final(sqlite3_context * context);
+    static void function_destroy_scalar(void * function);
+    static void function_destroy_aggregate(void * factory);
+
+private:
+    bool set_trace(bool profile, bool changes);
+    static int trace_callback(unsigned int type, void * context, void * statement, void * detail);
+    static int profile_callback(unsigned int type, void * context, void * statement, void * elapsed);
+
+private:
+    bool set_change_hooks(bool enable);
+    static void change_update_hook(void * context, int op, const char * database, const char * table, long long rowid);
+    static int change_commit_hook(void * context);
+    static void change_rollback_hook(void * context);
+    void change_statement(void * statement, const char * sql);
+    void change_finished(void * statement);
+    void deliver_changes();
+    void discard_changes(sqlite3_stmt * statement);
+    static void discard_statement_changes(const statement_cache_ptr_t & cache, sqlite3_stmt * statement);
+
+private:
+    struct change_subscriber_t
+    {
+        uint32_t                            id;
+        std::string                         table;
+        SQLiteChangeListener                listener;
+    };
+
+    struct change_mark_t
+    {
+        void                              * statement;
+        size_t                              begin;  // changes recorded before the statement started
+        size_t                              end;    // changes recorded when it finished
+    };
+
+private:
+    typedef std::list<std::pair<std::string, sqlite3_stmt *>> statement_list_t;
+    typedef std::unordered_map<std::string, statement_list_t::iterator> statement_map_t;
+    typedef std::unordered_map<std::string, SQLiteProfileEntry> profile_map_t;
+    typedef std::list<change_subscriber_t> change_subscriber_list_t;
+    typedef std::vector<std::pair<std::string, size_t>> change_savepoint_list_t;
+    typedef std::vector<change_mark_t> change_mark_list_t;
+    typedef std::unordered_map<std::string, SQLiteKVStore *> kv_store_map_t;
 
 private:
     std::string                             m_path;
     sqlite3                               * m_sqlite;
+    statement_cache_ptr_t                   m_statement_cache;
+    bool                                    m_profiling;
+    profile_map_t                           m_profile;
+    change_subscriber_list_t                m_change_subscribers;
+    uint32_t                                m_change_sequence;
+    bool                                    m_change_delivering;
+    std::vector<SQLiteChange>               m_changes;
+    change_savepoint_list_t                 m_change_savepoints;
+    change_mark_list_t                      m_change_marks;
+    change_mark_t                           m_change_finished;
+    std::vector<SQLiteChange>               m_committed_changes;
+    bool                                    m_kv_module;
+    kv_store_map_t                          m_kv_stores;
 };
 
 class GOOFER_API SQLiteStatement
@@ -58,6 +540,7 @@ class GOOFER_API SQLiteStatement
 public:
     SQLiteStatement();
     SQLiteStatement(sqlite3 * sqlite, const std::string & sql, bool writer);
+    SQLiteStatement(SQLiteDB * db, const std::string & sql, bool writer);
     SQLiteStatement(const SQLiteStatement & other) = delete;
     SQLiteStatement(SQLiteStatement && other);
     SQLiteStatement & operator = (const SQLiteStatement & other) = delete;
@@ -81,21 +564,100 @@ public:
     bool set(uint64_t value);
     bool set(float value);
     bool set(double value);
-    bool set(const std::string & value);
+
+public: // copy = false binds with SQLITE_STATIC, the buffer must stay unchanged until reset() or the statement is released
+    bool set(const char * value, bool copy = true);
+    bool set(const std::string & value, bool copy = true);
+    bool set(const SQLiteView & value, bool copy = true);
+    bool set_blob(const void * data, size_t size, bool copy = true);
+    bool set_blob(const std::string & value, bool copy = true);
+    bool set_zeroblob(size_t size);
+    bool set_null();
+
+public: // named parameters (":name", "@name", "$name") are resolved once per statement, seek() moves the next set() there
+    int parameter(const std::string & name);
+    bool seek(int index);
+    bool seek(const std::string & name);
+
+public:
+    template <typename ... Types>
+    bool bind_row(const Types & ... values)
+    {
+        return bind_tuple(std::forward_as_tuple(values ...), std::index_sequence_for<Types ...>());
+    }
+
+    template <typename Row>
+    bool bind_fields(const Row & row)
+    {
+        const auto fields = row.sqlite_fields();
+        return bind_tuple(fields, std::make_index_sequence<std::tuple_size<decltype(fields)>::value>());
+    }
+
+protected:
+    template <typename Tuple, size_t ... Index>
+    bool bind_tuple(const Tuple & row, std::index_sequence<Index ...>)
+    {
+        // a row binds the next row group of a multi-row statement, a fully bound statement starts over
+        const int start = (m_set_index < m_parameter_count ? m_set_index : 0);
+        if (!check_parameters(start, static_cast<int>(sizeof ... (Index))))
+        {
+            return false;
+        }
+        const bool results[] = { true, bind(start + static_cast<int>(Index), std::get<Index>(row)) ... };
+        m_set_index = start + static_cast<int>(sizeof ... (Index));
+        for (size_t index = 0; index < sizeof(results) / sizeof(results[0]); ++index)
+        {
+            if (!results[index])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    bool open(const SQLiteDB::statement_cache_ptr_t & cache, const std::string & sql, bool writer);
+    bool check_parameters(int start, int count) const;
+    void discard_changes();
+    bool bind(int index, bool value);
+    bool bind(int index, int8_t value);
+    bool bind(int index, uint8_t value);
+    bool bind(int index, int16_t value);
+    bool bind(int index, uint16_t value);
+    bool bind(int index, int32_t value);
+    bool bind(int index, uint32_t value);
+    bool bind(int index, int64_t value);
+    bool bind(int index, uint64_t value);
+    bool bind(int index, float value);
+    bool bind(int index, double value);
+    bool bind(int index, const char * value);
+    bool bind(int index, const std::string & value);
+    bool bind(int index, const SQLiteView & value);
 
 protected:
     bool set(int index, int value);
     bool set(int index, int64_t value);
     bool set(int index, double value);
-    bool set(int index, const std::string & value);
+    bool set(int index, const char * data, size_t size, bool blob, bool copy);
+    bool set_zeroblob(int index, size_t size);
+    bool set_null(int index);
+
+protected:
+    typedef std::unordered_map<std::string, int> parameter_map_t;
 
 protected:
     std::string                             m_sql;
+    SQLiteDB::statement_cache_ptr_t         m_cache;
     sqlite3                               * m_sqlite;
     bool                                    m_writer;
     sqlite3_stmt                          * m_statement;
     int                                     m_set_index;
     int                                     m_get_index;
+    int                                     m_parameter_count;
+    int                                     m_row_parameter_count;
+    int                                     m_column_count;
+    bool                                    m_done;
+    parameter_map_t                         m_parameters;
 };
 
 class GOOFER_API SQLiteReader : public SQLiteStatement
@@ -103,9 +665,27 @@ class GOOFER_API SQLiteReader : public SQLiteStatement
 public:
     SQLiteReader();
     SQLiteReader(sqlite3 * sqlite, const std::string & sql);
+    SQLiteReader(SQLiteDB * db, const std::string & sql);
 
 public:
     bool read();
+    bool for_each_row(const SQLiteRowVisitor & visitor, uint64_t * rows = nullptr);
+
+public:
+    template <typename ... Types>
+    bool read_row(std::tuple<Types ...> & row)
+    {
+        return read_tuple(row, std::index_sequence_for<Types ...>());
+    }
+
+    bool read_batch(size_t max_rows, SQLiteColumnBatch & batch);
+
+    template <typename Row>
+    bool read_fields(Row & row)
+    {
+        auto fields = row.sqlite_fields();
+        return read_tuple(fields, std::make_index_sequence<std::tuple_size<decltype(fields)>::value>());
+    }
 
 public:
     bool get(bool & value);
@@ -120,13 +700,48 @@ public:
     bool get(float & value);
     bool get(double & value);
     bool get(std::string & value);
+    bool get(SQLiteView & value);
     bool get(void * ignore);
 
+public:
+    bool get_blob(std::string & value);
+    bool get_blob(SQLiteView & value);
+
 protected:
     bool get(int index, int & value);
     bool get(int index, int64_t & value);
     bool get(int index, double & value);
     bool get(int index, std::string & value);
+    bool get(int index, SQLiteView & value, bool blob);
+
+protected:
+    template <typename Tuple, size_t ... Index>
+    bool read_tuple(Tuple & row, std::index_sequence<Index ...>)
+    {
+        if (!check_columns(static_cast<int>(sizeof ... (Index))) || !read())
+        {
+            return false;
+        }
+        const int fetched[] = { 0, (fetch(static_cast<int>(Index), std::get<Index>(row)), 0) ... };
+        PARAMS_IGN(fetched);
+        return true;
+    }
+
+protected:
+    bool check_columns(int count) const;
+    void fetch(int index, bool & value);
+    void fetch(int index, int8_t & value);
+    void fetch(int index, uint8_t & value);
+    void fetch(int index, int16_t & value);
+    void fetch(int index, uint16_t & value);
+    void fetch(int index, int32_t & value);
+    void fetch(int index, uint32_t & value);
+    void fetch(int index, int64_t & value);
+    void fetch(int index, uint64_t & value);
+    void fetch(int index, float & value);
+    void fetch(int index, double & value);
+    void fetch(int index, std::string & value);
+    void fetch(int index, SQLiteView & value);
 };
 
 class GOOFER_API SQLiteWriter : public SQLiteStatement
@@ -134,9 +749,329 @@ class GOOFER_API SQLiteWriter : public SQLiteStatement
 public:
     SQLiteWriter();
     SQLiteWriter(sqlite3 * sqlite, const std::string & sql);
+    SQLiteWriter(SQLiteDB * db, const std::string & sql);
 
 public:
     bool write();
+    uint64_t changes() const; // rows changed by the last write()
+
+public:
+    bool write_batch(size_t row_count, const SQLiteRowBinder & binder, size_t transaction_rows = 10000, SQLiteBatchStats * stats = nullptr);
+
+    template <typename Iterator>
+    bool write_batch(Iterator begin, Iterator end, size_t transaction_rows = 10000, SQLiteBatchStats * stats = nullptr)
+    {
+        const size_t row_count = static_cast<size_t>(std::distance(begin, end));
+        return write_batch(row_count, [&begin](SQLiteStatement & statement, size_t row) -> bool {
+            PARAMS_IGN(row);
+            return set_tuple(statement, *begin++);
+        }, transaction_rows, stats);
+    }
+
+private:
+    friend class SQLiteUpsert;
+
+private:
+    template <typename Tuple>
+    static bool set_tuple(SQLiteStatement & statement, const Tuple & row)
+    {
+        return set_tuple(statement, row, std::make_index_sequence<std::tuple_size<Tuple>::value>());
+    }
+
+    template <typename Tuple, size_t ... Index>
+    static bool set_tuple(SQLiteStatement & statement, const Tuple & row, std::index_sequence<Index ...>)
+    {
+        const bool results[] = { true, statement.set(std::get<Index>(row)) ... };
+        for (size_t index = 0; index < sizeof(results) / sizeof(results[0]); ++index)
+        {
+            if (!results[index])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    bool multi_row_shape(std::string & prefix, std::string & group, std::string & suffix) const;
+};
+
+class GOOFER_API SQLiteUpsert // rows bind the columns in the order given to SQLiteDB::create_upsert()
+{
+public:
+    SQLiteUpsert();
+    SQLiteUpsert(const SQLiteUpsert & other) = delete;
+    SQLiteUpsert(SQLiteUpsert && other);
+    SQLiteUpsert & operator = (const SQLiteUpsert & other) = delete;
+    SQLiteUpsert & operator = (SQLiteUpsert && other);
+    ~SQLiteUpsert();
+
+public:
+    bool good() const;
+    bool is_native() const; // false when the update falls back to UPDATE then INSERT
+    void clear();
+    uint64_t changes() const; // rows inserted or updated by the last upsert
+
+public:
+    template <typename ... Types>
+    bool upsert_row(const Types & ... values)
+    {
+        return upsert_batch(1, [&values ...](SQLiteStatement & statement, size_t row) -> bool {
+            PARAMS_IGN(row);
+            return statement.bind_row(values ...);
+        }, 0, nullptr);
+    }
+
+    // the fallback binds a row a second time when the update finds no row to change
+    bool upsert_batch(size_t row_count, const SQLiteRowBinder & binder, size_t transaction_rows = 10000, SQLiteBatchStats * stats = nullptr);
+
+    template <typename Iterator>
+    bool upsert_batch(Iterator begin, Iterator end, size_t transaction_rows = 10000, SQLiteBatchStats * stats = nullptr)
+    {
+        const size_t row_count = static_cast<size_t>(std::distance(begin, end));
+        size_t current = 0;
+        return upsert_batch(row_count, [&begin, &current](SQLiteStatement & statement, size_t row) -> bool {
+            for (; current < row; ++current)
+            {
+                ++begin;
+            }
+            return SQLiteWriter::set_tuple(statement, *begin);
+        }, transaction_rows, stats);
+    }
+
+private:
+    friend class SQLiteDB;
+
+private:
+    SQLiteUpsert(SQLiteDB * db, const std::string & insert_sql, const std::string & update_sql);
+
+private:
+    SQLiteWriter                            m_insert;
+    SQLiteWriter                            m_update;
+    uint64_t                                m_changes;
+};
+
+class GOOFER_API SQLiteBlob
+{
+public:
+    SQLiteBlob();
+    SQLiteBlob(const SQLiteBlob & other) = delete;
+    SQLiteBlob(SQLiteBlob && other);
+    SQLiteBlob & operator = (const SQLiteBlob & other) = delete;
+    SQLiteBlob & operator = (SQLiteBlob && other);
+    ~SQLiteBlob();
+
+public:
+    bool good() const;
+    void close();
+
+public:
+    int64_t rowid() const;
+    size_t size() const;
+
+public: // the range [offset, offset + size) must lie inside the blob
+    bool read(size_t offset, void * data, size_t size);
+    bool write(size_t offset, const void * data, size_t size);
+
+public: // moves to the same column of another row without reopening the table
+    bool reopen(int64_t rowid);
+
+private:
+    friend class SQLiteDB;
+
+private:
+    SQLiteBlob(sqlite3 * sqlite, const std::string & table, const std::string & column, int64_t rowid, bool writable);
+
+private:
+    std::string                             m_name;
+    sqlite3                               * m_sqlite;
+    sqlite3_blob                          * m_blob;
+    bool                                    m_writable;
+    int64_t                                 m_rowid;
+    size_t                                  m_size;
+};
+
+class GOOFER_API SQLiteCheckpointer // checkpoints a wal database from its own connection and thread
+{
+public:
+    SQLiteCheckpointer();
+    SQLiteCheckpointer(const SQLiteCheckpointer & other) = delete;
+    SQLiteCheckpointer(SQLiteCheckpointer && other) = delete;
+    SQLiteCheckpointer & operator = (const SQLiteCheckpointer & other) = delete;
+    SQLiteCheckpointer & operator = (SQLiteCheckpointer && other) = delete;
+    ~SQLiteCheckpointer();
+
+public: // writers should open with wal_autocheckpoint = 0 so that no commit checkpoints inline
+    bool init(const std::string & path, const SQLiteCheckpointConfig & config = SQLiteCheckpointConfig());
+    void exit();
+
+public:
+    bool is_running() const;
+    void checkpoint_now();
+    void get_stats(SQLiteCheckpointStats & stats);
+
+private:
+    void run();
+    void checkpoint(uint64_t wal_bytes);
+
+private:
+    mutable std::mutex                      m_mutex;
+    std::condition_variable                 m_condition;
+    bool                                    m_running;
+    bool                                    m_requested;
+    SQLiteDB                                m_db;
+    std::string                             m_wal_path;
+    SQLiteCheckpointConfig                  m_config;
+    std::thread                             m_thread;
+    SQLiteCheckpointStats                   m_stats;
+    uint64_t                                m_total_duration_ns;
+};
+
+class GOOFER_API SQLiteLease
+{
+public:
+    SQLiteLease();
+    SQLiteLease(const SQLiteLease & other) = delete;
+    SQLiteLease(SQLiteLease && other);
+    SQLiteLease & operator = (const SQLiteLease & other) = delete;
+    SQLiteLease & operator = (SQLiteLease && other);
+    ~SQLiteLease();
+
+public:
+    bool good() const;
+    bool is_writer() const;
+    void release();
+
+public:
+    SQLiteDB * operator -> () const;
+    SQLiteDB & operator * () const;
+
+private:
+    friend class SQLitePool;
+
+private:
+    SQLiteLease(SQLitePool * pool, SQLiteDB * db, bool writer);
+
+private:
+    SQLitePool                            * m_pool;
+    SQLiteDB                              * m_db;
+    bool                                    m_writer;
+};
+
+class GOOFER_API SQLitePool
+{
+public:
+    SQLitePool();
+    SQLitePool(const SQLitePool & other) = delete;
+    SQLitePool(SQLitePool && other) = delete;
+    SQLitePool & operator = (const SQLitePool & other) = delete;
+    SQLitePool & operator = (SQLitePool && other) = delete;
+    ~SQLitePool();
+
+public:
+    bool init(const std::string & path, size_t reader_count, const SQLiteOptions & options = SQLiteOptions::fast_wal());
+    void exit();
+
+public:
+    bool is_open() const;
+    size_t reader_count() const;
+
+public: // turns off inline auto-checkpoints of the writer and checkpoints from a background thread until exit()
+    bool start_checkpointer(const SQLiteCheckpointConfig & config = SQLiteCheckpointConfig());
+    bool get_checkpoint_stats(SQLiteCheckpointStats & stats);
+
+public: // timeout_ms = 0 waits forever, the lease is not good() on timeout
+    SQLiteLease acquire_reader(uint32_t timeout_ms = 0);
+    SQLiteLease acquire_writer(uint32_t timeout_ms = 0);
+
+private:
+    friend class SQLiteLease;
+
+private:
+    SQLiteLease acquire(bool writer, uint32_t timeout_ms);
+    void release(SQLiteDB * db, bool writer);
+
+private:
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_writer_condition;
+    std::condition_variable                 m_reader_condition;
+    bool                                    m_running;
+    SQLiteDB                                m_writer;
+    bool                                    m_writer_busy;
+    std::vector<SQLiteDB *>                 m_readers;
+    std::vector<SQLiteDB *>                 m_idle_readers;
+    size_t                                  m_leases;
+    std::string                             m_path;
+    SQLiteCheckpointer                      m_checkpointer;
+};
+
+struct GOOFER_API SQLiteWriteQueueStats
+{
+    uint64_t                                submitted;
+    uint64_t                                succeeded;
+    uint64_t                                failed;
+    uint64_t                                transactions;
+    uint64_t                                max_batch;
+    double                                  average_batch;
+    uint64_t                                average_latency_ns;
+    uint64_t                                max_latency_ns;
+    size_t                                  pending;
+};
+
+typedef std::function<bool (SQLiteDB & db)> SQLiteWriteTask;
+typedef std::function<void (bool success)> SQLiteWriteCallback;
+
+class GOOFER_API SQLiteWriteQueue
+{
+public:
+    SQLiteWriteQueue();
+    SQLiteWriteQueue(const SQLiteWriteQueue & other) = delete;
+    SQLiteWriteQueue(SQLiteWriteQueue && other) = delete;
+    SQLiteWriteQueue & operator = (const SQLiteWriteQueue & other) = delete;
+    SQLiteWriteQueue & operator = (SQLiteWriteQueue && other) = delete;
+    ~SQLiteWriteQueue();
+
+public: // db is used only by the queue thread until exit(), pending tasks are committed before exit() returns
+    bool init(SQLiteDB & db, size_t capacity = 4096, size_t max_batch = 256, uint32_t window_ms = 5);
+    void exit();
+
+public: // each task runs inside a savepoint of the group transaction, the callback fires after the commit
+    bool submit(const SQLiteWriteTask & task, const SQLiteWriteCallback & callback, uint32_t timeout_ms = 0);
+    std::future<bool> submit(const SQLiteWriteTask & task, uint32_t timeout_ms = 0);
+
+public:
+    void get_stats(SQLiteWriteQueueStats & stats);
+
+private:
+    struct request_t
+    {
+        SQLiteWriteTask                     task;
+        SQLiteWriteCallback                 callback;
+        uint64_t                            submit_time;
+    };
+
+private:
+    void run();
+    void commit(std::vector<request_t> & requests);
+
+private:
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_producer_condition;
+    std::condition_variable                 m_consumer_condition;
+    bool                                    m_running;
+    SQLiteDB                              * m_db;
+    size_t                                  m_capacity;
+    size_t                                  m_max_batch;
+    uint32_t                                m_window_ms;
+    std::deque<request_t>                   m_requests;
+    std::thread                             m_thread;
+    uint64_t                                m_submitted;
+    uint64_t                                m_succeeded;
+    uint64_t                                m_failed;
+    uint64_t                                m_transactions;
+    uint64_t                                m_max_batch_size;
+    uint64_t                                m_total_latency_ns;
+    uint64_t                                m_max_latency_ns;
 };
 
 
@@ -0,0 +1,46 @@
+/********************************************************
+ * Description : key value store interface of the sqlite helper kv tables
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Version     : 2.0
+ * Copyright(C): 2025
+ ********************************************************/
+
+#ifndef SQLITE_KV_STORE_H
+#define SQLITE_KV_STORE_H
+
+
+#include <cstddef>
+
+// header only, a store implementation does not link against the sqlite helper
+
+struct SQLiteView // valid until the next read() of the reader
+{
+    const char                            * data;
+    size_t                                  size;
+};
+
+class SQLiteKVCursor // walks the keys of a SQLiteKVStore in ascending bytewise order
+{
+public:
+    virtual ~SQLiteKVCursor() {}
+
+public:
+    virtual void seek(const SQLiteView & key) = 0; // moves to the first key >= key
+    virtual bool valid() const = 0;
+    virtual void next() = 0;
+    virtual SQLiteView key() const = 0;            // valid until the next seek() or next()
+    virtual SQLiteView value() const = 0;          // valid until the next seek() or next()
+};
+
+class SQLiteKVStore
+{
+public:
+    virtual ~SQLiteKVStore() {}
+
+public:
+    virtual SQLiteKVCursor * open_cursor() = 0;    // the cursor is deleted by the virtual table
+};
+
+
+#endif // SQLITE_KV_STORE_H
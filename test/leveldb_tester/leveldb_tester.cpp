@@ -8,6 +8,7 @@
 
 #include <cstring>
 #include "leveldb_helper.h"
+#include "sqlite_helper.h"
 
 struct user_storage_t
 {
@@ -229,6 +230,100 @@ static bool test_2()
     return true;
 }
 
+static bool test_3()
+{
+    const std::string path("./db3");
+
+    if (!LevelDB::destroy(path))
+    {
+        printf("level db destroy test failed\n");
+        return false;
+    }
+
+    LevelDB db;
+    if (!db.init(path))
+    {
+        printf("level db init test failed\n");
+        return false;
+    }
+
+    for (uint32_t user_id = 10000; user_id < 11000; ++user_id)
+    {
+        if (!db.set("user:" + std::to_string(user_id), "name" + std::to_string(user_id)))
+        {
+            printf("level db set test failed\n");
+            return false;
+        }
+    }
+
+    SQLiteDB sqlite;
+    if (!sqlite.init(":memory:"))
+    {
+        printf("sqlite db init test failed\n");
+        return false;
+    }
+
+    if (!sqlite.execute("CREATE TABLE SCORE (USER_ID INTEGER PRIMARY KEY, SCORE INTEGER);") || !sqlite.execute("INSERT INTO SCORE VALUES (10010, 90), (10020, 80), (10990, 70), (20000, 60);"))
+    {
+        printf("sqlite db insert test failed\n");
+        return false;
+    }
+
+    LevelKVStore store(db);
+    if (!sqlite.register_kv_table("USER", store))
+    {
+        printf("level db register kv table test failed\n");
+        return false;
+    }
+
+    // every score row seeks leveldb once by key
+    {
+        SQLiteReader reader(sqlite.create_reader("SELECT SCORE.USER_ID, CAST(USER.value AS TEXT), SCORE.SCORE FROM SCORE JOIN USER ON USER.key = 'user:' || SCORE.USER_ID ORDER BY SCORE.USER_ID;"));
+        uint32_t rows = 0;
+        while (reader.read())
+        {
+            int64_t user_id = 0;
+            std::string name;
+            int64_t score = 0;
+            if (!reader.get(user_id) || !reader.get(name) || !reader.get(score) || "name" + std::to_string(user_id) != name)
+            {
+                printf("level db join test failed\n");
+                return false;
+            }
+            printf("(%d) -> (%s, %d)\n", static_cast<int>(user_id), name.c_str(), static_cast<int>(score));
+            ++rows;
+        }
+        if (3 != rows)
+        {
+            printf("level db join test failed\n");
+            return false;
+        }
+        printf("\n");
+    }
+
+    // the range seeks to the lower bound and stops after the upper bound
+    {
+        SQLiteReader reader(sqlite.create_reader("SELECT COUNT(*) FROM USER WHERE key BETWEEN 'user:10100' AND 'user:10199';"));
+        uint32_t count = 0;
+        if (!reader.read() || !reader.get(count) || 100 != count)
+        {
+            printf("level db range test failed\n");
+            return false;
+        }
+    }
+
+    sqlite.exit();
+    db.exit();
+
+    if (!LevelDB::destroy(path))
+    {
+        printf("level db destroy test failed\n");
+        return false;
+    }
+
+    return true;
+}
+
 int main()
 {
     if (test_1())
@@ -249,6 +344,15 @@ int main()
         printf("level db test 2 failure\n");
     }
 
+    if (test_3())
+    {
+        printf("level db test 3 success\n");
+    }
+    else
+    {
+        printf("level db test 3 failure\n");
+    }
+
     return 0;
 }
 
@@ -26,8 +26,15 @@
 #include <cstring>
 #include <cstdlib>
 #include <cassert>
+#include <new>
 #include <list>
+#include <set>
 #include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <future>
 #include "redis_helper.h"
 
 #ifdef TEST_CLUSTER
@@ -286,6 +293,24 @@ bool Directory::sub_path_is_directory() const
     return m_current_sub_path_is_directory;
 }
 
+static std::atomic<uint64_t> s_allocations(0); // heap allocations through operator new, read by the command micro-benchmark
+
+void * operator new (size_t size)
+{
+    ++s_allocations;
+    void * memory = malloc(0 == size ? 1 : size);
+    if (nullptr == memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete (void * memory) noexcept
+{
+    free(memory);
+}
+
 static bool get_folder_files(const std::string & folder, std::list<std::string> & file_list)
 {
     std::list<std::string> dirname_list;
@@ -361,6 +386,42 @@ static bool set_file_to_redis(const std::list<std::string> & file_list, uint16_t
     return true;
 }
 
+static bool set_file_to_redis_by_pipeline(const std::list<std::string> & file_list, uint16_t table, int64_t expire_seconds)
+{
+    RedisClient redis_client;
+    if (!redis_client.init(SERVER, USERNAME, PASSWORD, table, 5000))
+    {
+        printf("redis client init failed\n");
+        return false;
+    }
+    RedisPipeline redis_pipeline(redis_client.create_pipeline());
+    for (std::list<std::string>::const_iterator iter = file_list.begin(); file_list.end() != iter; ++iter)
+    {
+        const std::string & filename = *iter;
+        const std::string key(get_file_key(filename));
+        redis_pipeline.set(key, get_file_value(filename));
+        if (0 != expire_seconds)
+        {
+            redis_pipeline.expire(key, expire_seconds);
+        }
+    }
+    std::vector<RedisResult> results;
+    if (!redis_pipeline.execute(results))
+    {
+        printf("redis pipeline execute failed\n");
+        return false;
+    }
+    for (std::vector<RedisResult>::const_iterator iter = results.begin(); results.end() != iter; ++iter)
+    {
+        if (RedisReplyType::error == iter->type)
+        {
+            printf("redis pipeline command failed (%s)\n", iter->str.c_str());
+        }
+    }
+    redis_client.exit();
+    return true;
+}
+
 static bool get_file_from_redis(const std::list<std::string> & file_list, uint16_t table, int64_t expire_seconds)
 {
     RedisClient redis_client;
@@ -392,6 +453,63 @@ static bool get_file_from_redis(const std::list<std::string> & file_list, uint16
     return true;
 }
 
+static bool get_file_from_redis_by_mget(const std::list<std::string> & file_list, uint16_t table)
+{
+    RedisClient redis_client;
+    if (!redis_client.init(SERVER, USERNAME, PASSWORD, table, 5000))
+    {
+        printf("redis client init failed\n");
+        return false;
+    }
+    std::list<std::string> keys;
+    for (std::list<std::string>::const_iterator iter = file_list.begin(); file_list.end() != iter; ++iter)
+    {
+        keys.push_back(get_file_key(*iter));
+    }
+    std::list<std::string> values;
+    if (!redis_client.mget(keys, values))
+    {
+        printf("redis client mget failed\n");
+        return false;
+    }
+    std::list<std::string>::const_iterator value = values.begin();
+    for (std::list<std::string>::const_iterator iter = file_list.begin(); file_list.end() != iter; ++iter, ++value)
+    {
+        if (get_file_value(*iter) != *value)
+        {
+            printf("redis client mget exception\n");
+        }
+    }
+    redis_client.exit();
+    return true;
+}
+
+static bool get_file_from_redis_by_async(const std::list<std::string> & file_list, uint16_t table)
+{
+    RedisAsyncClient redis_async_client;
+    if (!redis_async_client.init(SERVER, USERNAME, PASSWORD, table, 5000))
+    {
+        printf("redis async client init failed\n");
+        return false;
+    }
+    std::list<std::future<RedisResult>> futures;
+    for (std::list<std::string>::const_iterator iter = file_list.begin(); file_list.end() != iter; ++iter)
+    {
+        futures.push_back(redis_async_client.execute({ "GET", get_file_key(*iter) }));
+    }
+    std::list<std::future<RedisResult>>::iterator future = futures.begin();
+    for (std::list<std::string>::const_iterator iter = file_list.begin(); file_list.end() != iter; ++iter, ++future)
+    {
+        const RedisResult result = future->get();
+        if (RedisReplyType::string != result.type || get_file_value(*iter) != result.str)
+        {
+            printf("redis async client get exception\n");
+        }
+    }
+    redis_async_client.exit();
+    return true;
+}
+
 static bool find_file_from_redis(const std::list<std::string> & file_list, uint16_t table)
 {
     RedisClient redis_client;
@@ -698,6 +816,436 @@ static bool test_correctness()
     return true;
 }
 
+static bool test_pipeline()
+{
+    RedisClient redis_client;
+    if (!redis_client.init(SERVER, USERNAME, PASSWORD, 0, 5000))
+    {
+        printf("redis client init failed\n");
+        return false;
+    }
+
+    RedisPipeline redis_pipeline(redis_client.create_pipeline());
+    for (int index = 0; index < 100; ++index)
+    {
+        redis_pipeline.set("test-pipeline-" + std::to_string(index), "value " + std::to_string(index));
+    }
+    redis_pipeline.get("test-pipeline-7");
+    redis_pipeline.get("test-pipeline-not-exist");
+
+    std::list<std::string> command_line;
+    command_line.push_back("incr");
+    command_line.push_back("test-pipeline-7");
+    redis_pipeline.append(command_line);
+
+    std::vector<RedisResult> results;
+    if (!redis_pipeline.execute(results) || 103 != results.size() || 0 != redis_pipeline.size())
+    {
+        printf("redis pipeline execute failed\n");
+        return false;
+    }
+
+    if (RedisReplyType::status != results[0].type || RedisReplyType::string != results[100].type || "value 7" != results[100].str || RedisReplyType::nil != results[101].type || RedisReplyType::error != results[102].type)
+    {
+        printf("redis pipeline execute exception\n");
+        return false;
+    }
+
+    for (int index = 0; index < 100; ++index)
+    {
+        redis_pipeline.erase("test-pipeline-" + std::to_string(index));
+    }
+    if (!redis_pipeline.execute(results) || 100 != results.size())
+    {
+        printf("redis pipeline execute failed\n");
+        return false;
+    }
+    for (std::vector<RedisResult>::const_iterator iter = results.begin(); results.end() != iter; ++iter)
+    {
+        if (RedisReplyType::integer != iter->type || 1 != iter->integer)
+        {
+            printf("redis pipeline erase exception\n");
+            return false;
+        }
+    }
+
+    redis_client.exit();
+
+    return true;
+}
+
+static bool test_multi_key()
+{
+    RedisClient redis_client;
+    if (!redis_client.init(SERVER, USERNAME, PASSWORD, 0, 5000))
+    {
+        printf("redis client init failed\n");
+        return false;
+    }
+
+    std::list<std::string> keys;
+    std::list<std::pair<std::string, std::string>> pairs;
+    for (int index = 0; index < 1000; ++index)
+    {
+        keys.push_back("test-multi-key-" + std::to_string(index));
+        pairs.push_back(std::make_pair(keys.back(), "value " + std::to_string(index)));
+    }
+
+    if (!redis_client.mset(pairs))
+    {
+        printf("redis client mset failed\n");
+        return false;
+    }
+
+    if (!redis_client.expire(keys, 3600) || !redis_client.persist(keys))
+    {
+        printf("redis client expire or persist keys failed\n");
+        return false;
+    }
+
+    keys.push_back("test-multi-key-not-exist");
+    std::list<std::string> values;
+    std::list<bool> exists;
+    if (!redis_client.mget(keys, values, &exists) || keys.size() != values.size() || keys.size() != exists.size())
+    {
+        printf("redis client mget failed\n");
+        return false;
+    }
+
+    std::list<std::string>::const_iterator value = values.begin();
+    std::list<bool>::const_iterator exist = exists.begin();
+    for (std::list<std::pair<std::string, std::string>>::const_iterator iter = pairs.begin(); pairs.end() != iter; ++iter, ++value, ++exist)
+    {
+        if (iter->second != *value || !*exist)
+        {
+            printf("redis client mget exception\n");
+            return false;
+        }
+    }
+    if (!value->empty() || *exist)
+    {
+        printf("redis client mget exception\n");
+        return false;
+    }
+
+    size_t erased = 0;
+    if (!redis_client.mdel(keys, &erased) || pairs.size() != erased)
+    {
+        printf("redis client mdel failed\n");
+        return false;
+    }
+
+    if (redis_client.erase(keys))
+    {
+        printf("redis client erase exception\n");
+        return false;
+    }
+
+    redis_client.exit();
+
+    return true;
+}
+
+static bool test_scan()
+{
+    RedisClient redis_client;
+    if (!redis_client.init(SERVER, USERNAME, PASSWORD, 0, 5000))
+    {
+        printf("redis client init failed\n");
+        return false;
+    }
+
+    std::list<std::string> keys;
+    std::list<std::pair<std::string, std::string>> pairs;
+    for (int index = 0; index < 2500; ++index)
+    {
+        keys.push_back("test-scan-" + std::to_string(index));
+        pairs.push_back(std::make_pair(keys.back(), std::to_string(index)));
+    }
+    if (!redis_client.mset(pairs))
+    {
+        printf("redis client mset failed\n");
+        return false;
+    }
+
+    std::set<std::string> scanned;
+    size_t batches = 0;
+    if (!redis_client.scan("test-scan-*", [&scanned, &batches](const std::list<std::string> & batch) {
+        scanned.insert(batch.begin(), batch.end());
+        ++batches;
+        return true;
+    }, 500) || keys.size() != scanned.size())
+    {
+        printf("redis client scan failed\n");
+        return false;
+    }
+
+    // a cursor stops after one batch and resumes later
+    RedisScanCursor cursor;
+    std::list<std::string> batch;
+    size_t resumed = 0;
+    while (!cursor.done)
+    {
+        if (!redis_client.scan(cursor, batch, "test-scan-1*", 100))
+        {
+            printf("redis client scan cursor failed\n");
+            return false;
+        }
+        resumed += batch.size();
+    }
+
+    std::list<std::string> found;
+    if (!redis_client.find("test-scan-1*", found) || resumed < found.size() || 1111 != found.size())
+    {
+        printf("redis client find failed\n");
+        return false;
+    }
+    printf("scan %u keys in %u batches, %u keys match test-scan-1*\n", static_cast<uint32_t>(scanned.size()), static_cast<uint32_t>(batches), static_cast<uint32_t>(found.size()));
+
+    if (!redis_client.mdel(keys))
+    {
+        printf("redis client mdel failed\n");
+        return false;
+    }
+
+    redis_client.exit();
+
+    return true;
+}
+
+static bool test_pool()
+{
+    RedisPool redis_pool;
+    if (!redis_pool.init(SERVER, USERNAME, PASSWORD, 0, 5000, 4))
+    {
+        printf("redis pool init failed\n");
+        return false;
+    }
+
+    std::atomic<uint32_t> failures(0);
+    std::vector<std::thread> workers;
+    for (int worker = 0; worker < 8; ++worker)
+    {
+        workers.push_back(std::thread([&redis_pool, &failures, worker]() {
+            for (int index = 0; index < 200; ++index)
+            {
+                RedisLease redis_lease(redis_pool.acquire(5000));
+                const std::string key("test-pool-" + std::to_string(worker) + "-" + std::to_string(index));
+                std::string value;
+                if (!redis_lease.good() || !redis_lease->set(key, key) || !redis_lease->get(key, value) || key != value || !redis_lease->erase(key))
+                {
+                    ++failures;
+                }
+            }
+        }));
+    }
+    for (std::vector<std::thread>::iterator iter = workers.begin(); workers.end() != iter; ++iter)
+    {
+        iter->join();
+    }
+
+    RedisPoolStats stats;
+    redis_pool.get_stats(stats);
+    printf("pool %u connections, %u acquires, %u timeouts, average wait (%u) us, max wait (%u) us\n", static_cast<uint32_t>(redis_pool.connection_count()), static_cast<uint32_t>(stats.acquires), static_cast<uint32_t>(stats.timeouts), static_cast<uint32_t>(stats.average_wait_ns / 1000), static_cast<uint32_t>(stats.max_wait_ns / 1000));
+
+    if (0 != failures || 1600 != stats.acquires || 4 != stats.idle || 0 != stats.leased)
+    {
+        return false;
+    }
+
+    // connections idle longer than the health check interval are pinged before they are leased
+    if (!redis_pool.init(SERVER, USERNAME, PASSWORD, 0, 5000, 2, 10))
+    {
+        printf("redis pool init failed\n");
+        return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    {
+        RedisLease redis_lease(redis_pool.acquire());
+        if (!redis_lease.good() || !redis_lease->ping())
+        {
+            printf("redis pool lease failed\n");
+            return false;
+        }
+    }
+    redis_pool.get_stats(stats);
+    redis_pool.exit();
+
+    return 1 == stats.health_checks && 0 == stats.health_failures;
+}
+
+static bool test_async()
+{
+    RedisAsyncClient redis_async_client;
+    if (!redis_async_client.init(SERVER, USERNAME, PASSWORD, 0, 5000))
+    {
+        printf("redis async client init failed\n");
+        return false;
+    }
+
+    // commands of many threads share the one connection of the event loop
+    std::atomic<uint32_t> failures(0);
+    std::vector<std::thread> workers;
+    for (int worker = 0; worker < 8; ++worker)
+    {
+        workers.push_back(std::thread([&redis_async_client, &failures, worker]() {
+            for (int index = 0; index < 200; ++index)
+            {
+                const std::string key("test-async-" + std::to_string(worker) + "-" + std::to_string(index));
+                std::future<RedisResult> set_result = redis_async_client.execute({ "SET", key, key });
+                std::future<RedisResult> get_result = redis_async_client.execute({ "GET", key });
+                std::future<RedisResult> del_result = redis_async_client.execute({ "DEL", key });
+                if (RedisReplyType::status != set_result.get().type || key != get_result.get().str || 1 != del_result.get().integer)
+                {
+                    ++failures;
+                }
+            }
+        }));
+    }
+    for (std::vector<std::thread>::iterator iter = workers.begin(); workers.end() != iter; ++iter)
+    {
+        iter->join();
+    }
+
+    if (0 != failures)
+    {
+        printf("redis async client future failed (%u)\n", static_cast<uint32_t>(failures));
+        return false;
+    }
+
+    // replies arrive in order, so the final get sees every increment before it
+    std::atomic<uint32_t> replies(0);
+    redis_async_client.execute({ "DEL", "test-async-counter" }).get();
+    for (int index = 0; index < 1000; ++index)
+    {
+        if (!redis_async_client.execute({ "INCR", "test-async-counter" }, [&replies, &failures](bool success, const RedisResult & result) {
+            if (!success || RedisReplyType::integer != result.type)
+            {
+                ++failures;
+            }
+            ++replies;
+        }))
+        {
+            ++failures;
+        }
+    }
+    const RedisResult counter = redis_async_client.execute({ "GET", "test-async-counter" }).get();
+    redis_async_client.execute({ "DEL", "test-async-counter" }).get();
+    if (0 != failures || 1000 != replies || "1000" != counter.str)
+    {
+        printf("redis async client callback failed\n");
+        return false;
+    }
+
+    redis_async_client.exit();
+
+    if (RedisReplyType::error != redis_async_client.execute({ "PING" }).get().type)
+    {
+        printf("redis async client exit failed\n");
+        return false;
+    }
+
+    // exit() from a callback only stops the loop, its detached thread cleans up once the callback returns
+    if (!redis_async_client.init(SERVER, USERNAME, PASSWORD, 0, 5000))
+    {
+        printf("redis async client init failed\n");
+        return false;
+    }
+    std::promise<void> exited;
+    if (!redis_async_client.execute({ "PING" }, [&redis_async_client, &exited](bool, const RedisResult &) {
+        redis_async_client.exit();
+        exited.set_value();
+    }))
+    {
+        printf("redis async client callback exit failed\n");
+        return false;
+    }
+    exited.get_future().wait();
+    if (RedisReplyType::error != redis_async_client.execute({ "PING" }).get().type)
+    {
+        printf("redis async client callback exit failed\n");
+        return false;
+    }
+    if (!redis_async_client.init(SERVER, USERNAME, PASSWORD, 0, 5000) || RedisReplyType::status != redis_async_client.execute({ "PING" }).get().type)
+    {
+        printf("redis async client init after callback exit failed\n");
+        return false;
+    }
+
+    redis_async_client.exit();
+
+    // a client destroyed from its own callback still finishes the commands queued behind it
+    RedisAsyncClient * owned_async_client = new RedisAsyncClient;
+    if (!owned_async_client->init(SERVER, USERNAME, PASSWORD, 0, 5000))
+    {
+        printf("redis async client init failed\n");
+        delete owned_async_client;
+        return false;
+    }
+    std::promise<void> queued;
+    std::shared_future<void> queued_future(queued.get_future());
+    std::promise<void> destroyed;
+    const bool destroy_queued = owned_async_client->execute({ "PING" }, [owned_async_client, queued_future](bool, const RedisResult &) {
+        queued_future.wait();
+        delete owned_async_client;
+    });
+    const bool follow_queued = owned_async_client->execute({ "PING" }, [&destroyed](bool, const RedisResult &) {
+        destroyed.set_value();
+    });
+    queued.set_value();
+    if (!destroy_queued || !follow_queued || std::future_status::ready != destroyed.get_future().wait_for(std::chrono::seconds(10)))
+    {
+        printf("redis async client callback destroy failed\n");
+        return false;
+    }
+
+    return true;
+}
+
+static void test_command_allocations()
+{
+    RedisClient redis_client;
+    if (!redis_client.init(SERVER, USERNAME, PASSWORD, 1, 5000))
+    {
+        printf("redis client init failed\n");
+        return;
+    }
+
+    // the value buffer is warmed up first, so only the command path itself is counted
+    const std::string key("test-allocation-key");
+    const std::string value(256, 'v');
+    std::string result;
+    redis_client.set(key, value);
+    redis_client.get(key, result);
+
+    const uint32_t command_count = 10000;
+
+    {
+        const uint64_t allocations = s_allocations;
+        struct timeval time_beg = get_time();
+        for (uint32_t index = 0; index < command_count; ++index)
+        {
+            redis_client.set(key, value);
+        }
+        struct timeval time_end = get_time();
+        printf("set command count (%u) use time (%u) ms, (%.2f) allocations per command\n", command_count, static_cast<uint32_t>(get_time_delta(time_end, time_beg)), static_cast<double>(s_allocations - allocations) / command_count);
+    }
+
+    {
+        const uint64_t allocations = s_allocations;
+        struct timeval time_beg = get_time();
+        for (uint32_t index = 0; index < command_count; ++index)
+        {
+            redis_client.get(key, result);
+        }
+        struct timeval time_end = get_time();
+        printf("get command count (%u) use time (%u) ms, (%.2f) allocations per command\n", command_count, static_cast<uint32_t>(get_time_delta(time_end, time_beg)), static_cast<double>(s_allocations - allocations) / command_count);
+    }
+
+    redis_client.erase(key);
+    redis_client.exit();
+}
+
 static void test_performance()
 {
     const std::string folder("../..");
@@ -724,6 +1272,20 @@ static void test_performance()
         printf("set folder (%s) file count (%u) (with expire) use time (%u) ms\n", folder.c_str(), static_cast<uint32_t>(file_list.size()), static_cast<uint32_t>(get_time_delta(time_end, time_beg)));
     }
 
+    {
+        struct timeval time_beg = get_time();
+        set_file_to_redis_by_pipeline(file_list, 1, 0);
+        struct timeval time_end = get_time();
+        printf("set folder (%s) file count (%u) (without expire, pipeline) use time (%u) ms\n", folder.c_str(), static_cast<uint32_t>(file_list.size()), static_cast<uint32_t>(get_time_delta(time_end, time_beg)));
+    }
+
+    {
+        struct timeval time_beg = get_time();
+        set_file_to_redis_by_pipeline(file_list, 2, 36000);
+        struct timeval time_end = get_time();
+        printf("set folder (%s) file count (%u) (with expire, pipeline) use time (%u) ms\n", folder.c_str(), static_cast<uint32_t>(file_list.size()), static_cast<uint32_t>(get_time_delta(time_end, time_beg)));
+    }
+
     {
         struct timeval time_beg = get_time();
         get_file_from_redis(file_list, 1, 0);
@@ -738,6 +1300,20 @@ static void test_performance()
         printf("get folder (%s) file count (%u) (with expire) use time (%u) ms\n", folder.c_str(), static_cast<uint32_t>(file_list.size()), static_cast<uint32_t>(get_time_delta(time_end, time_beg)));
     }
 
+    {
+        struct timeval time_beg = get_time();
+        get_file_from_redis_by_mget(file_list, 1);
+        struct timeval time_end = get_time();
+        printf("get folder (%s) file count (%u) (mget) use time (%u) ms\n", folder.c_str(), static_cast<uint32_t>(file_list.size()), static_cast<uint32_t>(get_time_delta(time_end, time_beg)));
+    }
+
+    {
+        struct timeval time_beg = get_time();
+        get_file_from_redis_by_async(file_list, 1);
+        struct timeval time_end = get_time();
+        printf("get folder (%s) file count (%u) (async) use time (%u) ms\n", folder.c_str(), static_cast<uint32_t>(file_list.size()), static_cast<uint32_t>(get_time_delta(time_end, time_beg)));
+    }
+
     {
         struct timeval time_beg = get_time();
         find_file_from_redis(file_list, 1);
@@ -771,7 +1347,53 @@ int main(int argc, char * argv[])
         printf("redis client test correctness failure\n");
     }
 
+    if (test_pipeline())
+    {
+        printf("redis client test pipeline success\n");
+    }
+    else
+    {
+        printf("redis client test pipeline failure\n");
+    }
+
+    if (test_multi_key())
+    {
+        printf("redis client test multi key success\n");
+    }
+    else
+    {
+        printf("redis client test multi key failure\n");
+    }
+
+    if (test_scan())
+    {
+        printf("redis client test scan success\n");
+    }
+    else
+    {
+        printf("redis client test scan failure\n");
+    }
+
+    if (test_pool())
+    {
+        printf("redis client test pool success\n");
+    }
+    else
+    {
+        printf("redis client test pool failure\n");
+    }
+
+    if (test_async())
+    {
+        printf("redis client test async success\n");
+    }
+    else
+    {
+        printf("redis client test async failure\n");
+    }
+
     printf("redis client test performance begin\n");
+    test_command_allocations();
     test_performance();
     printf("redis client test performance end\n");
 
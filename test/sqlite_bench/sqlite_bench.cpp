@@ -0,0 +1,361 @@
+/********************************************************
+ * Description : benchmark of sqlite helper
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Version     : 2.0
+ * Copyright(C): 2025
+ ********************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <thread>
+#include <algorithm>
+#include "sqlite_helper.h"
+#include "base.h"
+
+struct bench_mode_t
+{
+    const char    * name;
+    SQLiteOptions   options;
+};
+
+struct bench_result_t
+{
+    std::string             workload;
+    uint32_t                threads;
+    std::string             latency_unit;   // what one latency sample times, "op" or "transaction"
+    uint64_t                ops;
+    uint64_t                elapsed_ns;
+    std::vector<uint64_t>   latencies;
+};
+
+static uint64_t percentile(const std::vector<uint64_t> & sorted_latencies, double ratio)
+{
+    if (sorted_latencies.empty())
+    {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(ratio * static_cast<double>(sorted_latencies.size() - 1) + 0.5);
+    return sorted_latencies[std::min(index, sorted_latencies.size() - 1)];
+}
+
+static void report(const bench_mode_t & mode, bench_result_t & result)
+{
+    std::sort(result.latencies.begin(), result.latencies.end());
+    double seconds = static_cast<double>(result.elapsed_ns) / 1000000000.0;
+    double ops_per_second = (seconds > 0.0 ? static_cast<double>(result.ops) / seconds : 0.0);
+    printf("{\"mode\":\"%s\",\"journal_mode\":\"%s\",\"synchronous\":%d,\"statement_cache\":%u,\"workload\":\"%s\",\"threads\":%u,\"ops\":" GOOFER_U64_FMT ",\"seconds\":%.6f,\"ops_per_second\":%.1f,\"latency_unit\":\"%s\",\"latency_samples\":%u,\"p50_ns\":" GOOFER_U64_FMT ",\"p99_ns\":" GOOFER_U64_FMT ",\"p999_ns\":" GOOFER_U64_FMT "}\n",
+        mode.name, mode.options.journal_mode.c_str(), mode.options.synchronous, static_cast<uint32_t>(mode.options.statement_cache),
+        result.workload.c_str(), result.threads, result.ops, seconds, ops_per_second, result.latency_unit.c_str(), static_cast<uint32_t>(result.latencies.size()),
+        percentile(result.latencies, 0.50), percentile(result.latencies, 0.99), percentile(result.latencies, 0.999));
+    fflush(stdout);
+}
+
+static void remove_db(const std::string & path)
+{
+    remove(path.c_str());
+    remove((path + "-wal").c_str());
+    remove((path + "-shm").c_str());
+    remove((path + "-journal").c_str());
+}
+
+static uint64_t next_random(uint64_t & seed)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+static bool bench_point_insert(SQLiteDB & db, uint64_t rows, bench_result_t & result)
+{
+    result.workload = "point_insert";
+    result.threads = 1;
+    result.latency_unit = "op";
+    result.latencies.reserve(rows);
+
+    const std::string name(32, 'n');
+    const uint64_t start_time = get_ns_time();
+    for (uint64_t id = 0; id < rows; ++id)
+    {
+        const uint64_t op_time = get_ns_time();
+        SQLiteWriter writer(db.create_writer("INSERT INTO BENCH (ID, NAME, SCORE) VALUES (?, ?, ?);"));
+        if (!writer.bind_row(id, name, static_cast<double>(id)) || !writer.write())
+        {
+            return false;
+        }
+        result.latencies.push_back(get_ns_time() - op_time);
+    }
+    result.elapsed_ns = get_ns_time() - start_time;
+    result.ops = rows;
+
+    return true;
+}
+
+static bool bench_batch_insert(SQLiteDB & db, uint64_t first_id, uint64_t rows, bench_result_t & result)
+{
+    result.workload = "batch_insert";
+    result.threads = 1;
+    result.latency_unit = "transaction";
+
+    const std::string name(32, 'n');
+    const size_t chunk_rows = 1000;
+    SQLiteWriter writer(db.create_writer("INSERT INTO BENCH (ID, NAME, SCORE) VALUES (?, ?, ?);"));
+    if (!writer.good())
+    {
+        return false;
+    }
+
+    const uint64_t start_time = get_ns_time();
+    for (uint64_t row = 0; row < rows; row += chunk_rows)
+    {
+        const size_t count = static_cast<size_t>(std::min<uint64_t>(chunk_rows, rows - row));
+        const uint64_t op_time = get_ns_time();
+        bool ret = writer.write_batch(count, [first_id, row, &name](SQLiteStatement & statement, size_t index) -> bool {
+            const uint64_t id = first_id + row + index;
+            return statement.set(id) && statement.set(name) && statement.set(static_cast<double>(id));
+        }, chunk_rows);
+        if (!ret)
+        {
+            return false;
+        }
+        // one sample per chunk transaction, rows inside a chunk are not timed one by one
+        result.latencies.push_back(get_ns_time() - op_time);
+    }
+    result.elapsed_ns = get_ns_time() - start_time;
+    result.ops = rows;
+
+    return true;
+}
+
+static bool bench_point_select(SQLiteDB & db, uint64_t rows, uint64_t ops, bench_result_t & result)
+{
+    result.workload = "point_select";
+    result.threads = 1;
+    result.latency_unit = "op";
+    result.latencies.reserve(ops);
+
+    uint64_t seed = 88172645463325252ULL;
+    const uint64_t start_time = get_ns_time();
+    for (uint64_t op = 0; op < ops; ++op)
+    {
+        const uint64_t op_time = get_ns_time();
+        SQLiteReader reader(db.create_reader("SELECT NAME, SCORE FROM BENCH WHERE ID = ?;"));
+        std::tuple<std::string, double> row;
+        if (!reader.bind_row(next_random(seed) % rows) || !reader.read_row(row))
+        {
+            return false;
+        }
+        result.latencies.push_back(get_ns_time() - op_time);
+    }
+    result.elapsed_ns = get_ns_time() - start_time;
+    result.ops = ops;
+
+    return true;
+}
+
+static bool bench_range_scan(SQLiteDB & db, uint64_t rows, uint64_t ops, bench_result_t & result)
+{
+    result.workload = "range_scan_100";
+    result.threads = 1;
+    result.latency_unit = "op";
+    result.latencies.reserve(ops);
+
+    uint64_t seed = 1181783497276652981ULL;
+    const uint64_t start_time = get_ns_time();
+    for (uint64_t op = 0; op < ops; ++op)
+    {
+        const uint64_t op_time = get_ns_time();
+        const uint64_t first = next_random(seed) % (rows > 100 ? rows - 100 : 1);
+        SQLiteReader reader(db.create_reader("SELECT ID, NAME, SCORE FROM BENCH WHERE ID BETWEEN ? AND ?;"));
+        double score = 0.0;
+        if (!reader.bind_row(first, first + 99) || !reader.for_each_row([&score](const SQLiteRow & row) -> bool { score += row.get_double(2); return true; }))
+        {
+            return false;
+        }
+        result.latencies.push_back(get_ns_time() - op_time);
+    }
+    result.elapsed_ns = get_ns_time() - start_time;
+    result.ops = ops;
+
+    return true;
+}
+
+static bool bench_mixed(SQLitePool & pool, uint64_t rows, uint64_t ops, uint32_t threads, bench_result_t & result)
+{
+    result.workload = "mixed_90r_10w";
+    result.threads = threads;
+    result.latency_unit = "op";
+
+    std::vector<std::vector<uint64_t>> thread_latencies(threads);
+    std::vector<char> thread_results(threads, 1);
+    std::vector<std::thread> workers;
+
+    const uint64_t ops_per_thread = ops / threads;
+    const uint64_t start_time = get_ns_time();
+    for (uint32_t thread_index = 0; thread_index < threads; ++thread_index)
+    {
+        workers.emplace_back([&pool, &thread_latencies, &thread_results, thread_index, rows, ops_per_thread]() {
+            std::vector<uint64_t> & latencies = thread_latencies[thread_index];
+            latencies.reserve(ops_per_thread);
+            uint64_t seed = 2463534242ULL + thread_index;
+            for (uint64_t op = 0; op < ops_per_thread; ++op)
+            {
+                const uint64_t op_time = get_ns_time();
+                const uint64_t id = next_random(seed) % rows;
+                bool ret = false;
+                if (0 == op % 10)
+                {
+                    SQLiteLease lease(pool.acquire_writer());
+                    SQLiteWriter writer(lease->create_writer("UPDATE BENCH SET SCORE = SCORE + 1 WHERE ID = ?;"));
+                    ret = writer.bind_row(id) && writer.write();
+                }
+                else
+                {
+                    SQLiteLease lease(pool.acquire_reader());
+                    SQLiteReader reader(lease->create_reader("SELECT NAME, SCORE FROM BENCH WHERE ID = ?;"));
+                    std::tuple<std::string, double> row;
+                    ret = reader.bind_row(id) && reader.read_row(row);
+                }
+                if (!ret)
+                {
+                    thread_results[thread_index] = 0;
+                    return;
+                }
+                latencies.push_back(get_ns_time() - op_time);
+            }
+        });
+    }
+
+    for (std::vector<std::thread>::iterator iter = workers.begin(); workers.end() != iter; ++iter)
+    {
+        iter->join();
+    }
+    result.elapsed_ns = get_ns_time() - start_time;
+    result.ops = ops_per_thread * threads;
+
+    for (uint32_t thread_index = 0; thread_index < threads; ++thread_index)
+    {
+        if (0 == thread_results[thread_index])
+        {
+            return false;
+        }
+        result.latencies.insert(result.latencies.end(), thread_latencies[thread_index].begin(), thread_latencies[thread_index].end());
+    }
+
+    return true;
+}
+
+static bool bench_mode(const std::string & path, const bench_mode_t & mode, uint64_t rows)
+{
+    remove_db(path);
+
+    SQLiteDB db;
+    if (!db.init(path, mode.options))
+    {
+        return false;
+    }
+
+    if (!db.execute("CREATE TABLE IF NOT EXISTS BENCH (ID BIGINT PRIMARY KEY NOT NULL, NAME TEXT NOT NULL, SCORE REAL);"))
+    {
+        return false;
+    }
+
+    const uint64_t point_rows = std::max<uint64_t>(rows / 100, 1);
+    const uint64_t ops = std::max<uint64_t>(rows / 2, 1);
+
+    bench_result_t point_insert;
+    if (!bench_point_insert(db, point_rows, point_insert))
+    {
+        return false;
+    }
+    report(mode, point_insert);
+
+    bench_result_t batch_insert;
+    if (!bench_batch_insert(db, point_rows, rows - point_rows, batch_insert))
+    {
+        return false;
+    }
+    report(mode, batch_insert);
+
+    bench_result_t point_select;
+    if (!bench_point_select(db, rows, ops, point_select))
+    {
+        return false;
+    }
+    report(mode, point_select);
+
+    bench_result_t range_scan;
+    if (!bench_range_scan(db, rows, ops / 100 + 1, range_scan))
+    {
+        return false;
+    }
+    report(mode, range_scan);
+
+    db.exit();
+
+    // the pool readers only run beside the writer in wal mode
+    const uint32_t thread_counts[] = { 1, 2, 4, 8 };
+    for (size_t index = 0; "WAL" == mode.options.journal_mode && index < sizeof(thread_counts) / sizeof(thread_counts[0]); ++index)
+    {
+        SQLitePool pool;
+        if (!pool.init(path, thread_counts[index], mode.options))
+        {
+            return false;
+        }
+        bench_result_t mixed;
+        if (!bench_mixed(pool, rows, ops, thread_counts[index], mixed))
+        {
+            return false;
+        }
+        report(mode, mixed);
+    }
+
+    remove_db(path);
+
+    return true;
+}
+
+// usage: sqlite_bench [path] [rows] [rollback | durable | fast-wal | fast-wal-no-cache]
+int main(int argc, char * argv[])
+{
+    const std::string path(argc > 1 ? argv[1] : "./bench.db");
+    const uint64_t rows = (argc > 2 ? std::max<uint64_t>(strtoull(argv[2], nullptr, 10), 200) : 100000);
+    const std::string only_mode(argc > 3 ? argv[3] : "");
+
+    std::vector<bench_mode_t> modes;
+
+    bench_mode_t rollback = { "rollback", SQLiteOptions() };
+    rollback.options.journal_mode = "DELETE";
+    rollback.options.synchronous = 2;
+    rollback.options.busy_timeout = 5000;
+    modes.push_back(rollback);
+
+    bench_mode_t durable = { "durable", SQLiteOptions::durable() };
+    modes.push_back(durable);
+
+    bench_mode_t fast_wal = { "fast-wal", SQLiteOptions::fast_wal() };
+    modes.push_back(fast_wal);
+
+    bench_mode_t fast_wal_no_cache = { "fast-wal-no-cache", SQLiteOptions::fast_wal() };
+    fast_wal_no_cache.options.statement_cache = 0;
+    modes.push_back(fast_wal_no_cache);
+
+    for (std::vector<bench_mode_t>::const_iterator iter = modes.begin(); modes.end() != iter; ++iter)
+    {
+        if (!only_mode.empty() && only_mode != iter->name)
+        {
+            continue;
+        }
+        if (!bench_mode(path, *iter, rows))
+        {
+            fprintf(stderr, "sqlite bench mode (%s) failure\n", iter->name);
+            return 1;
+        }
+    }
+
+    return 0;
+}
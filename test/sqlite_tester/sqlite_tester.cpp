@@ -7,7 +7,15 @@
  ********************************************************/
 
 #include <cstdio>
+#include <cstring>
+#include <algorithm>
 #include <string>
+#include <tuple>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <atomic>
 #include "sqlite_helper.h"
 
 struct table_row_t
@@ -27,6 +35,31 @@ static const table_row_t table_row[] =
     { 3, "Mark",  25, "Rich-Mond",  65000.00 }
 };
 
+static bool test_db_options(SQLiteDB & db, const SQLiteOptions & expect)
+{
+    printf("test db options ...\n");
+
+    SQLiteOptions options;
+    if (!db.get_options(options))
+    {
+        return false;
+    }
+
+    printf("    journal_mode: %s, synchronous: %d, mmap_size: " GOOFER_I64_FMT ", cache_size: " GOOFER_I64_FMT ", page_size: %d, temp_store: %d, busy_timeout: %d\n", options.journal_mode.c_str(), options.synchronous, options.mmap_size, options.cache_size, options.page_size, options.temp_store, options.busy_timeout);
+
+    if (options.journal_mode != expect.journal_mode)
+    {
+        return false;
+    }
+
+    if (options.synchronous != expect.synchronous || options.cache_size != expect.cache_size || options.temp_store != expect.temp_store || options.busy_timeout != expect.busy_timeout)
+    {
+        return false;
+    }
+
+    return true;
+}
+
 static bool test_table_create(SQLiteDB & db)
 {
     printf("test create table ...\n");
@@ -167,44 +200,1482 @@ static bool test_table_select(SQLiteDB & db)
     return true;
 }
 
-static bool test_sqlite()
+static bool test_statement_cache(SQLiteDB & db)
 {
-    SQLiteDB db;
+    printf("test statement cache ...\n");
 
-    const char * path = "./test.db";
-    if (!db.init(path))
+    SQLiteCacheStats before;
+    db.get_statement_cache_stats(before);
+
+    const char * count_sql = "SELECT COUNT(*) from COMPANY;";
+    for (uint32_t index = 0; index < 3; ++index)
+    {
+        SQLiteReader reader(db.create_reader(count_sql));
+        if (!reader.good() || !reader.read())
+        {
+            return false;
+        }
+    }
+
+    SQLiteCacheStats after;
+    db.get_statement_cache_stats(after);
+
+    printf("    hits: " GOOFER_U64_FMT ", misses: " GOOFER_U64_FMT ", evictions: " GOOFER_U64_FMT ", size: %u, capacity: %u\n", after.hits, after.misses, after.evictions, static_cast<uint32_t>(after.size), static_cast<uint32_t>(after.capacity));
+
+    if (after.misses != before.misses + 1 || after.hits != before.hits + 2 || 0 != after.borrowed)
     {
-        printf("sqlite db init failure\n");
         return false;
     }
 
-    if (!db.is_open())
+    // a statement that outlives exit() is finalized on release, not cached by the reopened connection
+    const char * cache_path = "./test_cache.db";
+    SQLiteDB cache_db;
+    if (!cache_db.init(cache_path))
     {
-        printf("sqlite db is not open\n");
         return false;
     }
+    {
+        SQLiteReader reader(cache_db.create_reader("SELECT 1;"));
+        cache_db.exit();
+        if (!reader.good() || !cache_db.init(cache_path))
+        {
+            return false;
+        }
+    }
+    SQLiteCacheStats reopened;
+    cache_db.get_statement_cache_stats(reopened);
+    cache_db.exit();
 
-    if (!test_table_create(db))
+    // a statement that outlives its db object only finalizes itself on release
+    {
+        SQLiteDB * owner_db = new SQLiteDB;
+        if (!owner_db->init(cache_path))
+        {
+            delete owner_db;
+            return false;
+        }
+        SQLiteReader reader(owner_db->create_reader("SELECT 1;"));
+        delete owner_db;
+        if (!reader.good())
+        {
+            return false;
+        }
+    }
+    remove(cache_path);
+
+    return 0 == reopened.borrowed && 0 == reopened.size;
+}
+
+static bool test_batch_insert(SQLiteDB & db)
+{
+    printf("test batch insert ...\n");
+
+    if (!db.execute("CREATE TABLE IF NOT EXISTS BATCH (ID BIGINT PRIMARY KEY NOT NULL, NAME TEXT NOT NULL, SCORE REAL);"))
     {
-        printf("sqlite test table create failure\n");
         return false;
     }
 
-    if (!test_table_delete(db))
+    if (!db.execute("DELETE FROM BATCH;"))
     {
-        printf("sqlite test table delete failure\n");
         return false;
     }
 
-    if (!test_table_insert(db))
+    SQLiteWriter writer(db.create_writer("INSERT INTO BATCH (ID, NAME, SCORE) VALUES (?, ?, ?);"));
+    if (!writer.good())
     {
-        printf("sqlite test table insert failure\n");
         return false;
     }
 
-    if (!test_table_select(db))
+    const size_t binder_rows = 200000;
+    SQLiteBatchStats stats;
+    bool ret = writer.write_batch(binder_rows, [](SQLiteStatement & statement, size_t row) -> bool {
+        return statement.set(static_cast<uint64_t>(row)) && statement.set(std::string("binder")) && statement.set(row * 0.5);
+    }, 50000, &stats);
+    if (!ret || binder_rows != stats.rows)
     {
-        printf("sqlite test table select failure\n");
+        return false;
+    }
+    printf("    binder: " GOOFER_U64_FMT " rows, " GOOFER_U64_FMT " statements, " GOOFER_U64_FMT " transactions, %.0f rows/s\n", stats.rows, stats.statements, stats.transactions, stats.rows_per_second);
+
+    std::vector<std::tuple<int64_t, std::string, double>> tuple_rows;
+    for (size_t index = 0; index < 1001; ++index)
+    {
+        tuple_rows.emplace_back(static_cast<int64_t>(binder_rows + index), "tuple", index * 2.0);
+    }
+    ret = writer.write_batch(tuple_rows.begin(), tuple_rows.end(), 500, &stats);
+    if (!ret || tuple_rows.size() != stats.rows)
+    {
+        return false;
+    }
+    printf("    tuple: " GOOFER_U64_FMT " rows, " GOOFER_U64_FMT " statements, " GOOFER_U64_FMT " transactions, %.0f rows/s\n", stats.rows, stats.statements, stats.transactions, stats.rows_per_second);
+
+    // bind_row() fills the next row group when the batch widens the statement to many rows
+    const size_t bind_row_rows = 1001;
+    const size_t bind_row_first = binder_rows + tuple_rows.size();
+    ret = writer.write_batch(bind_row_rows, [bind_row_first](SQLiteStatement & statement, size_t row) -> bool {
+        return statement.bind_row(static_cast<uint64_t>(bind_row_first + row), std::string("bind row"), row * 3.0);
+    }, 500, &stats);
+    if (!ret || bind_row_rows != stats.rows || stats.statements >= bind_row_rows)
+    {
+        return false;
+    }
+    printf("    bind row: " GOOFER_U64_FMT " rows, " GOOFER_U64_FMT " statements, " GOOFER_U64_FMT " transactions, %.0f rows/s\n", stats.rows, stats.statements, stats.transactions, stats.rows_per_second);
+
+    // a move assigned statement keeps the row shape bind_row() checks against
+    SQLiteWriter assigned;
+    assigned = db.create_writer("INSERT INTO BATCH (ID, NAME, SCORE) VALUES (?, ?, ?);");
+    if (!assigned.bind_row(static_cast<uint64_t>(bind_row_first + bind_row_rows), std::string("assigned"), 1.0) || !assigned.write())
+    {
+        return false;
+    }
+    assigned.clear();
+
+    SQLiteReader reader(db.create_reader("SELECT COUNT(*) FROM BATCH;"));
+    uint64_t count = 0;
+    if (!reader.read() || !reader.get(count) || binder_rows + tuple_rows.size() + bind_row_rows + 1 != count)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static bool test_zero_copy_scan(SQLiteDB & db)
+{
+    printf("test zero copy scan ...\n");
+
+    SQLiteReader reader(db.create_reader("SELECT ID, NAME, SCORE FROM BATCH;"));
+    if (!reader.good())
+    {
+        return false;
+    }
+
+    uint64_t rows = 0;
+    uint64_t bytes = 0;
+    double score = 0.0;
+    bool ret = reader.for_each_row([&bytes, &score](const SQLiteRow & row) -> bool {
+        bytes += row.get_text(1).size;
+        score += row.get_double(2);
+        return true;
+    }, &rows);
+    if (!ret || 0 == rows)
+    {
+        return false;
+    }
+    printf("    for each row: " GOOFER_U64_FMT " rows, " GOOFER_U64_FMT " bytes, %.1f score\n", rows, bytes, score);
+
+    SQLiteReader view_reader(db.create_reader("SELECT NAME, CAST(NAME AS BLOB) FROM COMPANY WHERE ID = 0;"));
+    SQLiteView text = { nullptr, 0 };
+    SQLiteView blob = { nullptr, 0 };
+    if (!view_reader.read() || !view_reader.get(text) || !view_reader.get_blob(blob))
+    {
+        return false;
+    }
+    printf("    view: [%.*s] [%.*s]\n", static_cast<int>(text.size), text.data, static_cast<int>(blob.size), blob.data);
+
+    return text.size == blob.size && 0 == memcmp(text.data, blob.data, text.size);
+}
+
+static bool test_parameter_binding(SQLiteDB & db)
+{
+    printf("test parameter binding ...\n");
+
+    if (!db.execute("CREATE TABLE IF NOT EXISTS PAYLOAD (ID BIGINT PRIMARY KEY NOT NULL, NAME TEXT, DATA BLOB);"))
+    {
+        return false;
+    }
+
+    if (!db.execute("DELETE FROM PAYLOAD;"))
+    {
+        return false;
+    }
+
+    SQLiteWriter writer(db.create_writer("INSERT INTO PAYLOAD (ID, NAME, DATA) VALUES (:id, :name, :data);"));
+    if (!writer.good())
+    {
+        return false;
+    }
+
+    const std::string payload("\x00\x01\x02\xff binary", 11);
+    const SQLiteView name = { "static", 6 };
+
+    writer.reset();
+    if (!writer.seek(":data") || !writer.set_blob(payload.data(), payload.size(), false) || !writer.seek(":name") || !writer.set(name, false) || !writer.seek(":id") || !writer.set(static_cast<int64_t>(1)) || !writer.write())
+    {
+        return false;
+    }
+
+    writer.reset();
+    if (!writer.set(static_cast<int64_t>(2)) || !writer.set_null() || !writer.set_zeroblob(16) || !writer.write())
+    {
+        return false;
+    }
+
+    SQLiteReader reader(db.create_reader("SELECT ID, NAME IS NULL, DATA FROM PAYLOAD ORDER BY ID;"));
+    uint64_t id = 0;
+    bool name_null = false;
+    std::string data;
+
+    if (!reader.read() || !reader.get(id) || !reader.get(name_null) || !reader.get_blob(data) || 1 != id || name_null || payload != data)
+    {
+        return false;
+    }
+    printf("    row " GOOFER_U64_FMT ": %u bytes blob\n", id, static_cast<uint32_t>(data.size()));
+
+    if (!reader.read() || !reader.get(id) || !reader.get(name_null) || !reader.get_blob(data) || 2 != id || !name_null || std::string(16, '\0') != data)
+    {
+        return false;
+    }
+    printf("    row " GOOFER_U64_FMT ": null name, %u bytes zeroblob\n", id, static_cast<uint32_t>(data.size()));
+
+    return true;
+}
+
+static bool test_blob_stream(SQLiteDB & db)
+{
+    printf("test blob stream ...\n");
+
+    const size_t blob_size = 1024 * 1024 + 123;
+    const size_t chunk_size = 64 * 1024;
+
+    if (!db.execute("CREATE TABLE IF NOT EXISTS STREAM (ID INTEGER PRIMARY KEY NOT NULL, DATA BLOB);"))
+    {
+        return false;
+    }
+
+    if (!db.execute("DELETE FROM STREAM;"))
+    {
+        return false;
+    }
+
+    SQLiteWriter writer(db.create_writer("INSERT INTO STREAM (ID, DATA) VALUES (?, ?);"));
+    for (int64_t id = 10; id < 12; ++id)
+    {
+        writer.reset();
+        if (!writer.set(id) || !writer.set_zeroblob(blob_size) || !writer.write())
+        {
+            return false;
+        }
+    }
+
+    SQLiteBlob blob(db.open_blob("STREAM", "DATA", 10, true));
+    if (!blob.good() || blob_size != blob.size())
+    {
+        return false;
+    }
+
+    std::vector<char> chunk(chunk_size);
+    for (int64_t id = 10; id < 12; ++id)
+    {
+        if (!blob.reopen(id))
+        {
+            return false;
+        }
+        for (size_t offset = 0; offset < blob_size; offset += chunk_size)
+        {
+            const size_t size = std::min(chunk_size, blob_size - offset);
+            for (size_t index = 0; index < size; ++index)
+            {
+                chunk[index] = static_cast<char>((offset + index + id) & 0xff);
+            }
+            if (!blob.write(offset, chunk.data(), size))
+            {
+                return false;
+            }
+        }
+    }
+
+    if (blob.write(blob_size - 1, chunk.data(), 2) || blob.reopen(99))
+    {
+        return false;
+    }
+
+    SQLiteBlob reader(db.open_blob("STREAM", "DATA", 11));
+    if (!reader.good() || reader.write(0, chunk.data(), 1))
+    {
+        return false;
+    }
+
+    for (int64_t id = 10; id < 12; ++id)
+    {
+        if (!reader.reopen(id))
+        {
+            return false;
+        }
+        for (size_t offset = 0; offset < blob_size; offset += chunk_size)
+        {
+            const size_t size = std::min(chunk_size, blob_size - offset);
+            if (!reader.read(offset, chunk.data(), size))
+            {
+                return false;
+            }
+            for (size_t index = 0; index < size; ++index)
+            {
+                if (static_cast<char>((offset + index + id) & 0xff) != chunk[index])
+                {
+                    return false;
+                }
+            }
+        }
+        printf("    row %d: %u bytes streamed in %u bytes chunks\n", static_cast<int>(id), static_cast<uint32_t>(reader.size()), static_cast<uint32_t>(chunk_size));
+    }
+
+    return true;
+}
+
+static bool test_backup(SQLiteDB & db)
+{
+    printf("test backup ...\n");
+
+    const char * backup_path = "./test_backup.db";
+    remove(backup_path);
+
+    uint64_t count = 0;
+    SQLiteReader reader(db.create_reader("SELECT COUNT(*) FROM BATCH;"));
+    if (!reader.read() || !reader.get(count) || 0 == count)
+    {
+        return false;
+    }
+    reader.clear();
+
+    uint32_t steps = 0;
+    int total_pages = 0;
+    SQLiteBackupProgress progress = [&steps, &total_pages](int remaining_pages, int total) {
+        ++steps;
+        total_pages = total;
+        return remaining_pages >= 0;
+    };
+    if (!db.backup_to(backup_path, 16, 0, progress) || steps < 2)
+    {
+        return false;
+    }
+    printf("    backup %d pages to file in %u steps\n", total_pages, steps);
+
+    SQLiteDB memory;
+    if (!memory.load(backup_path))
+    {
+        return false;
+    }
+
+    uint64_t memory_count = 0;
+    SQLiteReader memory_reader(memory.create_reader("SELECT COUNT(*) FROM BATCH;"));
+    if (!memory_reader.read() || !memory_reader.get(memory_count) || count != memory_count)
+    {
+        return false;
+    }
+    memory_reader.clear();
+    printf("    load " GOOFER_U64_FMT " rows into memory\n", memory_count);
+
+    if (!memory.execute("DELETE FROM BATCH WHERE ID % 2 = 0;") || !memory.backup_to(backup_path, 16))
+    {
+        return false;
+    }
+
+    memory_reader = memory.create_reader("SELECT COUNT(*) FROM BATCH;");
+    if (!memory_reader.read() || !memory_reader.get(memory_count) || count == memory_count)
+    {
+        return false;
+    }
+    memory_reader.clear();
+
+    SQLiteDB snapshot;
+    if (!snapshot.init(":memory:") || !snapshot.restore_from(memory) || memory.backup_to(snapshot, 16, 0, [](int, int) { return false; }))
+    {
+        return false;
+    }
+
+    SQLiteDB file;
+    uint64_t file_count = 0;
+    if (!file.init(backup_path))
+    {
+        return false;
+    }
+    SQLiteReader file_reader(file.create_reader("SELECT COUNT(*) FROM BATCH;"));
+    if (!file_reader.read() || !file_reader.get(file_count) || memory_count != file_count)
+    {
+        return false;
+    }
+    printf("    snapshot " GOOFER_U64_FMT " rows from memory to file\n", file_count);
+    file_reader.clear();
+    file.exit();
+
+    remove(backup_path);
+
+    return true;
+}
+
+static bool test_profile(SQLiteDB & db)
+{
+    printf("test profile ...\n");
+
+    const char * scan_sql = "SELECT COUNT(*) FROM BATCH WHERE NAME LIKE ?;";
+    const char * point_sql = "SELECT NAME FROM BATCH WHERE ID = ?;";
+
+    if (db.is_profiling() || !db.set_profile(true) || !db.is_profiling())
+    {
+        return false;
+    }
+
+    for (uint64_t times = 0; times < 100; ++times)
+    {
+        SQLiteReader reader(db.create_reader(0 == times % 10 ? scan_sql : point_sql));
+        uint64_t count = 0;
+        std::string name;
+        if (0 == times % 10 ? !reader.set("name 1%") || !reader.read() || !reader.get(count) : !reader.set(times) || !reader.read() || !reader.get(name))
+        {
+            return false;
+        }
+    }
+
+    std::vector<SQLiteProfileEntry> entries;
+    db.get_profile(entries, 2);
+    if (2 != entries.size() || scan_sql != entries[0].sql || 10 != entries[0].calls || 0 == entries[0].fullscan_steps || point_sql != entries[1].sql || 90 != entries[1].calls || 0 != entries[1].fullscan_steps)
+    {
+        return false;
+    }
+    for (size_t index = 0; index < entries.size(); ++index)
+    {
+        const SQLiteProfileEntry & entry = entries[index];
+        uint64_t histogram_calls = 0;
+        for (size_t bucket = 0; bucket < SQLiteProfileEntry::histogram_size; ++bucket)
+        {
+            histogram_calls += entry.histogram[bucket];
+        }
+        if (histogram_calls != entry.calls)
+        {
+            return false;
+        }
+        printf("    %s: calls " GOOFER_U64_FMT ", total " GOOFER_U64_FMT "us, max " GOOFER_U64_FMT "us, fullscan steps " GOOFER_U64_FMT ", vm steps " GOOFER_U64_FMT "\n", entry.sql.c_str(), entry.calls, entry.total_ns / 1000, entry.max_ns / 1000, entry.fullscan_steps, entry.vm_steps);
+    }
+
+    if (!db.set_profile(false) || !db.execute("SELECT COUNT(*) FROM BATCH;"))
+    {
+        return false;
+    }
+    db.get_profile(entries, 100);
+    for (size_t index = 0; index < entries.size(); ++index)
+    {
+        if ("SELECT COUNT(*) FROM BATCH;" == entries[index].sql)
+        {
+            return false;
+        }
+    }
+
+    db.clear_profile();
+    db.get_profile(entries);
+
+    return entries.empty();
+}
+
+class sum_square_t : public SQLiteAggregate
+{
+public:
+    sum_square_t()
+        : m_sum(0)
+    {
+
+    }
+
+public:
+    virtual void step(const SQLiteFunctionArgs & args) override
+    {
+        int64_t value = 0;
+        if (args.get(0, value))
+        {
+            m_sum += value * value;
+        }
+    }
+
+    virtual void inverse(const SQLiteFunctionArgs & args) override
+    {
+        int64_t value = 0;
+        if (args.get(0, value))
+        {
+            m_sum -= value * value;
+        }
+    }
+
+    virtual void value(SQLiteFunctionResult & result) override
+    {
+        result.set(m_sum);
+    }
+
+private:
+    int64_t                                 m_sum;
+};
+
+static bool test_functions(SQLiteDB & db)
+{
+    printf("test functions ...\n");
+
+    std::function<int64_t (const std::string &, int64_t)> name_hash = [](const std::string & name, int64_t seed) {
+        uint64_t hash = static_cast<uint64_t>(seed) ^ 14695981039346656037ULL;
+        for (size_t index = 0; index < name.size(); ++index)
+        {
+            hash = (hash ^ static_cast<uint8_t>(name[index])) * 1099511628211ULL;
+        }
+        return static_cast<int64_t>(hash & 0xffff);
+    };
+
+    if (!db.register_function("name_hash", name_hash) || !db.register_aggregate("sum_square", 1, []() -> SQLiteAggregate * { return new sum_square_t; }))
+    {
+        return false;
+    }
+
+    if (!db.register_function("checked_div", 2, [](const SQLiteFunctionArgs & args, SQLiteFunctionResult & result) {
+        if (2 != args.count() || args.is_null(0) || args.is_null(1))
+        {
+            result.set_null();
+            return;
+        }
+        int64_t divisor = 0;
+        double dividend = 0.0;
+        if (!args.get(0, dividend) || !args.get(1, divisor) || 0 == divisor)
+        {
+            result.set_error("division by zero");
+            return;
+        }
+        result.set(dividend / static_cast<double>(divisor));
+    }))
+    {
+        return false;
+    }
+
+    uint64_t matched = 0;
+    uint64_t expected = 0;
+    SQLiteReader scan(db.create_reader("SELECT ID, NAME FROM BATCH WHERE ID < 1000;"));
+    if (!scan.for_each_row([&expected, &name_hash](const SQLiteRow & row) {
+        const SQLiteView name = row.get_text(1);
+        expected += (0 == name_hash(std::string(name.data, name.size), row.get_int64(0)) % 16 ? 1 : 0);
+        return true;
+    }))
+    {
+        return false;
+    }
+
+    SQLiteReader reader(db.create_reader("SELECT COUNT(*) FROM BATCH WHERE ID < 1000 AND name_hash(NAME, ID) % 16 = 0;"));
+    if (!reader.read() || !reader.get(matched) || expected != matched)
+    {
+        return false;
+    }
+    reader.clear();
+    printf("    name_hash matches " GOOFER_U64_FMT " of 1000 rows inside the engine\n", matched);
+
+    int64_t sum = 0;
+    reader = db.create_reader("SELECT sum_square(ID) FROM BATCH WHERE ID < 10;");
+    if (!reader.read() || !reader.get(sum) || 285 != sum)
+    {
+        return false;
+    }
+    reader.clear();
+
+    reader = db.create_reader("SELECT sum_square(ID) FROM BATCH WHERE ID < 0;");
+    if (!reader.read() || !reader.get(sum) || 0 != sum)
+    {
+        return false;
+    }
+    reader.clear();
+
+    double quotient = 0.0;
+    reader = db.create_reader("SELECT checked_div(7, 2);");
+    if (!reader.read() || !reader.get(quotient) || 3.5 != quotient)
+    {
+        return false;
+    }
+    reader.clear();
+
+    if (db.execute("SELECT checked_div(7, 0);"))
+    {
+        return false;
+    }
+
+    if (db.register_window("sum_square", 1, []() -> SQLiteAggregate * { return new sum_square_t; }))
+    {
+        reader = db.create_reader("SELECT sum_square(ID) OVER (ORDER BY ID ROWS BETWEEN 1 PRECEDING AND CURRENT ROW) FROM BATCH WHERE ID < 4 ORDER BY ID;");
+        const int64_t windows[] = { 0, 1, 5, 13 };
+        for (size_t index = 0; index < sizeof(windows) / sizeof(windows[0]); ++index)
+        {
+            if (!reader.read() || !reader.get(sum) || windows[index] != sum)
+            {
+                return false;
+            }
+        }
+        reader.clear();
+        printf("    sum_square runs as a window function\n");
+    }
+
+    return db.unregister_function("checked_div", 2) && !db.execute("SELECT checked_div(7, 2);");
+}
+
+class map_store_t : public SQLiteKVStore
+{
+public:
+    class cursor_t : public SQLiteKVCursor
+    {
+    public:
+        cursor_t(map_store_t & store)
+            : m_store(store)
+            , m_iter(store.m_map.end())
+        {
+
+        }
+
+    public:
+        virtual void seek(const SQLiteView & key) override
+        {
+            m_iter = m_store.m_map.lower_bound(std::string(key.data, key.size));
+            ++m_store.m_seeks;
+        }
+
+        virtual bool valid() const override
+        {
+            return m_store.m_map.end() != m_iter;
+        }
+
+        virtual void next() override
+        {
+            ++m_iter;
+            ++m_store.m_steps;
+        }
+
+        virtual SQLiteView key() const override
+        {
+            SQLiteView view = { m_iter->first.data(), m_iter->first.size() };
+            return view;
+        }
+
+        virtual SQLiteView value() const override
+        {
+            SQLiteView view = { m_iter->second.data(), m_iter->second.size() };
+            return view;
+        }
+
+    private:
+        map_store_t                                       & m_store;
+        std::map<std::string, std::string>::const_iterator  m_iter;
+    };
+
+public:
+    map_store_t()
+        : m_map()
+        , m_seeks(0)
+        , m_steps(0)
+    {
+
+    }
+
+public:
+    virtual SQLiteKVCursor * open_cursor() override
+    {
+        return new cursor_t(*this);
+    }
+
+public:
+    std::map<std::string, std::string>      m_map;
+    uint64_t                                m_seeks;
+    uint64_t                                m_steps;
+};
+
+static bool test_kv_table(SQLiteDB & db)
+{
+    printf("test kv table ...\n");
+
+    map_store_t store;
+    for (uint32_t index = 0; index < 10000; ++index)
+    {
+        char key[32] = { 0x0 };
+        snprintf(key, sizeof(key), "key:%05u", index);
+        store.m_map[key] = std::to_string(index * 3);
+    }
+
+    if (!db.register_kv_table("KV", store))
+    {
+        return false;
+    }
+
+    std::string value;
+    SQLiteReader reader(db.create_reader("SELECT CAST(value AS TEXT) FROM KV WHERE key = ?;"));
+    if (!reader.set("key:01234") || !reader.read() || !reader.get(value) || "3702" != value || reader.read() || store.m_steps > 1)
+    {
+        return false;
+    }
+    reader.clear();
+
+    uint64_t count = 0;
+    store.m_steps = 0;
+    reader = db.create_reader("SELECT COUNT(*) FROM KV WHERE key BETWEEN 'key:00100' AND 'key:00199';");
+    if (!reader.read() || !reader.get(count) || 100 != count || store.m_steps > 100)
+    {
+        return false;
+    }
+    reader.clear();
+
+    store.m_steps = 0;
+    reader = db.create_reader("SELECT COUNT(*) FROM KV WHERE key > 'key:09990' AND key < 'key:09995';");
+    if (!reader.read() || !reader.get(count) || 4 != count || store.m_steps > 5)
+    {
+        return false;
+    }
+    reader.clear();
+    printf("    range queries touch %u keys of %u\n", static_cast<uint32_t>(store.m_steps), static_cast<uint32_t>(store.m_map.size()));
+
+    reader = db.create_reader("SELECT COUNT(*) FROM BATCH JOIN KV ON KV.key = printf('key:%05d', BATCH.ID) WHERE BATCH.ID < 50;");
+    if (!reader.read() || !reader.get(count) || 50 != count)
+    {
+        return false;
+    }
+    reader.clear();
+
+    store.m_steps = 0;
+    reader = db.create_reader("SELECT COUNT(*) FROM KV;");
+    if (!reader.read() || !reader.get(count) || store.m_map.size() != count || store.m_map.size() != store.m_steps)
+    {
+        return false;
+    }
+    reader.clear();
+
+    // a quote inside the table name is escaped in the generated statements
+    if (!db.register_kv_table("K\"V", store))
+    {
+        return false;
+    }
+    reader = db.create_reader("SELECT COUNT(*) FROM \"K\"\"V\";");
+    if (!reader.read() || !reader.get(count) || store.m_map.size() != count)
+    {
+        return false;
+    }
+    reader.clear();
+
+    // the same name registers again after unregister, a table created by hand finds no store once it is gone
+    if (!db.unregister_kv_table("K\"V") || !db.register_kv_table("K\"V", store) || !db.unregister_kv_table("k\"v"))
+    {
+        return false;
+    }
+    if (db.execute("CREATE VIRTUAL TABLE temp.\"K\"\"V\" USING kv_store;"))
+    {
+        return false;
+    }
+
+    return db.unregister_kv_table("KV") && !db.execute("SELECT COUNT(*) FROM KV;");
+}
+
+static SQLiteMemoryConfig memory_config()
+{
+    SQLiteMemoryConfig config;
+    config.page_cache_page_size = 4096;
+    config.page_cache_pages = 256;
+    config.lookaside_slot_size = 128;
+    config.lookaside_slots = 256;
+    return config;
+}
+
+static SQLiteMemoryInit s_memory_init(memory_config());
+
+static bool test_memory(SQLiteDB & db)
+{
+    printf("test memory ...\n");
+
+    if (!s_memory_init.good() || SQLiteDB::configure_memory(SQLiteMemoryConfig()))
+    {
+        return false;
+    }
+
+    SQLiteMemoryStats stats;
+    if (!db.get_memory_stats(stats))
+    {
+        return false;
+    }
+    printf("    memory used " GOOFER_I64_FMT " (highwater " GOOFER_I64_FMT "), mallocs " GOOFER_I64_FMT "\n", stats.memory_used, stats.memory_highwater, stats.malloc_count);
+    printf("    page cache used " GOOFER_I64_FMT " pages, overflow " GOOFER_I64_FMT " bytes\n", stats.page_cache_used, stats.page_cache_overflow);
+    printf("    lookaside used " GOOFER_I64_FMT ", hits " GOOFER_I64_FMT ", misses " GOOFER_I64_FMT ", connection cache " GOOFER_I64_FMT " bytes\n", stats.lookaside_used, stats.lookaside_hits, stats.lookaside_misses, stats.cache_used);
+
+    return stats.memory_used > 0 && stats.page_cache_used > 0;
+}
+
+static bool test_checkpoint(const char * path)
+{
+    printf("test checkpoint ...\n");
+
+    SQLitePool pool;
+    if (!pool.init(path, 2))
+    {
+        return false;
+    }
+
+    SQLiteCheckpointConfig config;
+    config.poll_ms = 5;
+    config.interval_ms = 20;
+    config.wal_size_trigger = 256 * 1024;
+    if (!pool.start_checkpointer(config))
+    {
+        return false;
+    }
+
+    {
+        SQLiteLease writer(pool.acquire_writer());
+        SQLiteOptions options;
+        if (!writer.good() || !writer->get_options(options) || 0 != options.wal_autocheckpoint)
+        {
+            return false;
+        }
+        if (!writer->execute("CREATE TABLE IF NOT EXISTS CHECKPOINT (ID INTEGER PRIMARY KEY, DATA BLOB);") || !writer->execute("DELETE FROM CHECKPOINT;"))
+        {
+            return false;
+        }
+    }
+
+    for (int64_t round = 0; round < 20; ++round)
+    {
+        SQLiteLease writer(pool.acquire_writer());
+        SQLiteWriter insert(writer->create_writer("INSERT INTO CHECKPOINT (ID, DATA) VALUES (?, ?);"));
+        if (!writer->transaction_begin())
+        {
+            return false;
+        }
+        for (int64_t index = 0; index < 100; ++index)
+        {
+            insert.reset();
+            if (!insert.set(round * 100 + index) || !insert.set_zeroblob(1024) || !insert.write())
+            {
+                return false;
+            }
+        }
+        insert.clear();
+        if (!writer->transaction_end())
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    SQLiteCheckpointStats stats;
+    if (!pool.get_checkpoint_stats(stats) || 0 == stats.checkpoints || 0 == stats.max_wal_bytes || 0 != stats.failures)
+    {
+        return false;
+    }
+    printf("    checkpoints " GOOFER_U64_FMT " (restart " GOOFER_U64_FMT ", truncate " GOOFER_U64_FMT ", busy " GOOFER_U64_FMT "), max wal " GOOFER_U64_FMT " bytes, duration avg " GOOFER_U64_FMT "us max " GOOFER_U64_FMT "us\n", stats.checkpoints, stats.restarts, stats.truncates, stats.busy, stats.max_wal_bytes, stats.average_duration_ns / 1000, stats.max_duration_ns / 1000);
+
+    {
+        SQLiteLease writer(pool.acquire_writer());
+        if (!writer->execute("DROP TABLE CHECKPOINT;"))
+        {
+            return false;
+        }
+    }
+
+    pool.exit();
+
+    return true;
+}
+
+static bool test_upsert(SQLiteDB & db)
+{
+    printf("test upsert ...\n");
+
+    if (!db.execute("CREATE TABLE IF NOT EXISTS COUNTER (NAME TEXT PRIMARY KEY, HITS INTEGER NOT NULL, NOTE TEXT);") || !db.execute("DELETE FROM COUNTER;"))
+    {
+        return false;
+    }
+
+    SQLiteUpsert upsert(db.create_upsert("COUNTER", { "NAME", "HITS", "NOTE" }, { "NAME" }));
+    if (!upsert.good())
+    {
+        return false;
+    }
+
+    std::vector<std::tuple<std::string, int64_t, std::string>> rows;
+    for (int64_t index = 0; index < 100; ++index)
+    {
+        rows.emplace_back("name_" + std::to_string(index), index, "first");
+    }
+
+    SQLiteBatchStats stats;
+    if (!upsert.upsert_batch(rows.begin(), rows.end(), 64, &stats) || 100 != upsert.changes() || 100 != stats.rows)
+    {
+        return false;
+    }
+
+    rows.clear();
+    for (int64_t index = 50; index < 150; ++index)
+    {
+        rows.emplace_back("name_" + std::to_string(index), index * 10, "second");
+    }
+    if (!upsert.upsert_batch(rows.begin(), rows.end(), 64, &stats) || 100 != upsert.changes())
+    {
+        return false;
+    }
+    printf("    %s upsert: " GOOFER_U64_FMT " rows, " GOOFER_U64_FMT " statements, " GOOFER_U64_FMT " transactions\n", upsert.is_native() ? "native" : "fallback", stats.rows, stats.statements, stats.transactions);
+
+    if (!upsert.upsert_row(std::string("name_0"), static_cast<int64_t>(-1), std::string("third")) || 1 != upsert.changes())
+    {
+        return false;
+    }
+
+    int64_t count = 0;
+    int64_t hits = 0;
+    SQLiteReader reader(db.create_reader("SELECT COUNT(*), SUM(HITS) FROM COUNTER;"));
+    if (!reader.read() || !reader.get(count) || !reader.get(hits))
+    {
+        return false;
+    }
+    reader.clear();
+
+    // 0..49 keep their hits except name_0, 50..149 were updated or inserted with ten times the index
+    if (150 != count || (1225 - 1) + 10 * (50 + 149) * 100 / 2 != hits)
+    {
+        return false;
+    }
+
+    SQLiteUpsert ignore(db.create_upsert("COUNTER", { "NAME", "HITS", "NOTE" }, { }, SQLiteConflict::ignore));
+    if (!ignore.good() || !ignore.upsert_row(std::string("name_1"), static_cast<int64_t>(0), std::string("ignored")) || 0 != ignore.changes())
+    {
+        return false;
+    }
+
+    SQLiteUpsert replace(db.create_upsert("COUNTER", { "NAME", "HITS", "NOTE" }, { }, SQLiteConflict::replace));
+    if (!replace.good() || !replace.upsert_row(std::string("name_1"), static_cast<int64_t>(0), std::string("replaced")) || 1 != replace.changes())
+    {
+        return false;
+    }
+
+    std::string note;
+    reader = db.create_reader("SELECT NOTE FROM COUNTER WHERE NAME = 'name_1';");
+    if (!reader.read() || !reader.get(note) || "replaced" != note)
+    {
+        return false;
+    }
+    reader.clear();
+
+    SQLiteUpsert invalid(db.create_upsert("COUNTER", { "NAME", "HITS" }, { "NOTE" }));
+    if (invalid.good() || !db.execute("DROP TABLE COUNTER;"))
+    {
+        return false;
+    }
+
+    // quotes inside table and column names are escaped in the generated statements
+    if (!db.execute("CREATE TABLE \"QUO\"\"TED\" (\"K\"\"EY\" TEXT PRIMARY KEY, \"VA\"\"LUE\" INTEGER);"))
+    {
+        return false;
+    }
+    SQLiteUpsert quoted(db.create_upsert("QUO\"TED", { "K\"EY", "VA\"LUE" }, { "K\"EY" }));
+    if (!quoted.good() || !quoted.upsert_row(std::string("key"), static_cast<int64_t>(1)) || !quoted.upsert_row(std::string("key"), static_cast<int64_t>(2)))
+    {
+        return false;
+    }
+    reader = db.create_reader("SELECT \"VA\"\"LUE\" FROM \"QUO\"\"TED\";");
+    if (!reader.read() || !reader.get(hits) || 2 != hits || reader.read())
+    {
+        return false;
+    }
+    reader.clear();
+
+    return db.execute("DROP TABLE \"QUO\"\"TED\";");
+}
+
+static bool test_changes(SQLiteDB & db)
+{
+    printf("test changes ...\n");
+
+    if (!db.execute("CREATE TABLE IF NOT EXISTS WATCH (ID INTEGER PRIMARY KEY, VALUE INTEGER);") || !db.execute("CREATE TABLE IF NOT EXISTS OTHER (ID INTEGER PRIMARY KEY);"))
+    {
+        return false;
+    }
+
+    std::vector<std::vector<SQLiteChange>> all_batches;
+    std::vector<std::vector<SQLiteChange>> watch_batches;
+    const uint32_t all = db.subscribe_changes([&all_batches](const std::vector<SQLiteChange> & changes) {
+        all_batches.push_back(changes);
+    });
+    const uint32_t watch = db.subscribe_changes([&watch_batches](const std::vector<SQLiteChange> & changes) {
+        watch_batches.push_back(changes);
+    }, "WATCH");
+    if (0 == all || 0 == watch)
+    {
+        return false;
+    }
+
+    if (!db.transaction_begin() || !db.execute("INSERT INTO WATCH (ID, VALUE) VALUES (1, 10), (2, 20), (3, 30);") || !db.execute("UPDATE WATCH SET VALUE = 21 WHERE ID = 2;") || !db.execute("DELETE FROM WATCH WHERE ID = 3;") || !db.execute("INSERT INTO OTHER (ID) VALUES (7);") || !db.transaction_end())
+    {
+        return false;
+    }
+    if (1 != all_batches.size() || 6 != all_batches[0].size() || 1 != watch_batches.size() || 5 != watch_batches[0].size())
+    {
+        return false;
+    }
+
+    const std::vector<SQLiteChange> & changes = watch_batches[0];
+    if (SQLiteChangeOp::insert != changes[0].op || SQLiteChangeOp::update != changes[3].op || 2 != changes[3].rowid || SQLiteChangeOp::remove != changes[4].op || 3 != changes[4].rowid || "OTHER" != all_batches[0][5].table)
+    {
+        return false;
+    }
+
+    if (!db.execute("BEGIN TRANSACTION;") || !db.execute("INSERT INTO WATCH (ID, VALUE) VALUES (4, 40);") || !db.execute("ROLLBACK TRANSACTION;"))
+    {
+        return false;
+    }
+    if (1 != all_batches.size())
+    {
+        return false;
+    }
+
+    if (!db.execute("INSERT INTO OTHER (ID) VALUES (8);") || 2 != all_batches.size() || 1 != watch_batches.size())
+    {
+        return false;
+    }
+
+    // rows undone by savepoint_rollback() never reach the listeners, rows kept by savepoint_release() do
+    if (!db.execute("BEGIN TRANSACTION;") || !db.execute("INSERT INTO WATCH (ID, VALUE) VALUES (5, 50);") || !db.savepoint_begin("outer \"task\"") || !db.execute("INSERT INTO WATCH (ID, VALUE) VALUES (6, 60);") || !db.savepoint_begin("inner_task") || !db.execute("INSERT INTO WATCH (ID, VALUE) VALUES (7, 70);") || !db.savepoint_release("inner_task") || !db.savepoint_rollback("outer \"task\"") || !db.execute("INSERT INTO WATCH (ID, VALUE) VALUES (8, 80);") || !db.savepoint_release("outer \"task\"") || !db.execute("COMMIT TRANSACTION;"))
+    {
+        return false;
+    }
+    if (3 != all_batches.size() || 2 != all_batches[2].size() || 5 != all_batches[2][0].rowid || 8 != all_batches[2][1].rowid)
+    {
+        return false;
+    }
+
+    // a statement that fails inside the transaction undoes the rows it already reported, an OR FAIL conflict keeps them
+    SQLiteWriter batch_writer(db.create_writer("INSERT INTO WATCH (ID, VALUE) VALUES (?, ?);"));
+    std::vector<std::tuple<int64_t, int64_t>> batch_rows = { std::make_tuple(12, 120), std::make_tuple(13, 130), std::make_tuple(9, 0) };
+    if (!db.execute("BEGIN TRANSACTION;") || !db.execute("INSERT INTO WATCH (ID, VALUE) VALUES (9, 90);") || db.execute("INSERT INTO WATCH (ID, VALUE) VALUES (10, 100), (9, 0);") || batch_writer.write_batch(batch_rows.begin(), batch_rows.end()) || db.execute("INSERT OR FAIL INTO WATCH (ID, VALUE) VALUES (11, 110), (9, 0);") || !db.execute("COMMIT TRANSACTION;"))
+    {
+        return false;
+    }
+    if (4 != all_batches.size() || 2 != all_batches[3].size() || 9 != all_batches[3][0].rowid || 11 != all_batches[3][1].rowid)
+    {
+        return false;
+    }
+
+    if (!db.unsubscribe_changes(all) || db.unsubscribe_changes(all) || !db.execute("UPDATE WATCH SET VALUE = 11 WHERE ID = 1;"))
+    {
+        return false;
+    }
+    printf("    " GOOFER_U64_FMT " + " GOOFER_U64_FMT " batches delivered\n", static_cast<uint64_t>(all_batches.size()), static_cast<uint64_t>(watch_batches.size()));
+
+    if (4 != all_batches.size() || 4 != watch_batches.size() || 1 != watch_batches[3].size() || !db.unsubscribe_changes(watch))
+    {
+        return false;
+    }
+
+    return db.execute("DROP TABLE WATCH;") && db.execute("DROP TABLE OTHER;");
+}
+
+static bool test_changes_busy_commit(const char * path)
+{
+    printf("test changes busy commit ...\n");
+
+    // a rollback journal lets an open reader block the COMMIT of the other connection
+    remove(path);
+    SQLiteDB writer_db;
+    SQLiteDB reader_db;
+    if (!writer_db.init(path) || !reader_db.init(path) || !writer_db.execute("PRAGMA journal_mode = DELETE;") || !writer_db.execute("CREATE TABLE IF NOT EXISTS BUSY (ID INTEGER PRIMARY KEY);") || !writer_db.execute("DELETE FROM BUSY;") || !writer_db.execute("INSERT INTO BUSY (ID) VALUES (1), (2);"))
+    {
+        return false;
+    }
+
+    std::vector<std::vector<SQLiteChange>> batches;
+    const uint32_t subscription = writer_db.subscribe_changes([&batches](const std::vector<SQLiteChange> & changes) {
+        batches.push_back(changes);
+    });
+    if (0 == subscription)
+    {
+        return false;
+    }
+
+    bool ret = false;
+    {
+        SQLiteReader reader(reader_db.create_reader("SELECT ID FROM BUSY;"));
+        if (!reader.read() || !writer_db.execute("BEGIN TRANSACTION;") || !writer_db.execute("INSERT INTO BUSY (ID) VALUES (3);"))
+        {
+            return false;
+        }
+        ret = writer_db.execute("COMMIT TRANSACTION;");
+    }
+    if (ret || !batches.empty())
+    {
+        return false;
+    }
+
+    if (!writer_db.execute("COMMIT TRANSACTION;") || 1 != batches.size() || 1 != batches[0].size() || 3 != batches[0][0].rowid)
+    {
+        return false;
+    }
+
+    return writer_db.unsubscribe_changes(subscription) && writer_db.execute("DROP TABLE BUSY;");
+}
+
+static bool test_pool(const char * path)
+{
+    printf("test pool ...\n");
+
+    SQLitePool pool;
+    if (!pool.init(path, 4))
+    {
+        return false;
+    }
+
+    std::atomic<uint64_t> reads(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> readers;
+    for (size_t index = 0; index < pool.reader_count(); ++index)
+    {
+        readers.emplace_back([&pool, &reads, &failed]() {
+            for (size_t times = 0; times < 200; ++times)
+            {
+                SQLiteLease lease(pool.acquire_reader(1000));
+                if (!lease.good())
+                {
+                    failed = true;
+                    return;
+                }
+                SQLiteReader reader(lease->create_reader("SELECT COUNT(*) FROM BATCH WHERE ID < ?;"));
+                uint64_t count = 0;
+                if (!reader.set(static_cast<uint64_t>(times * 100)) || !reader.read() || !reader.get(count))
+                {
+                    failed = true;
+                    return;
+                }
+                ++reads;
+            }
+        });
+    }
+
+    for (size_t times = 0; times < 10; ++times)
+    {
+        SQLiteLease lease(pool.acquire_writer());
+        SQLiteWriter writer(lease->create_writer("UPDATE BATCH SET SCORE = SCORE + 1 WHERE ID = ?;"));
+        if (!lease.good() || !writer.set(static_cast<uint64_t>(times)) || !writer.write())
+        {
+            failed = true;
+            break;
+        }
+    }
+
+    for (std::vector<std::thread>::iterator iter = readers.begin(); readers.end() != iter; ++iter)
+    {
+        iter->join();
+    }
+
+    printf("    %u readers, " GOOFER_U64_FMT " reads\n", static_cast<uint32_t>(pool.reader_count()), static_cast<uint64_t>(reads));
+
+    pool.exit();
+
+    return !failed;
+}
+
+struct batch_row_t
+{
+    int64_t         id;
+    std::string     name;
+    double          score;
+
+    SQLITE_ROW_FIELDS(id, name, score)
+};
+
+static bool test_typed_row(SQLiteDB & db)
+{
+    printf("test typed row ...\n");
+
+    SQLiteWriter writer(db.create_writer("INSERT OR REPLACE INTO BATCH (ID, NAME, SCORE) VALUES (?, ?, ?);"));
+    if (!writer.good())
+    {
+        return false;
+    }
+
+    writer.reset();
+    if (!writer.bind_row(static_cast<int64_t>(-1), "typed", 1.5) || !writer.write())
+    {
+        return false;
+    }
+
+    const batch_row_t fields_row = { -2, "fields", 2.5 };
+    writer.reset();
+    if (!writer.bind_fields(fields_row) || !writer.write())
+    {
+        return false;
+    }
+
+    SQLiteReader reader(db.create_reader("SELECT ID, NAME, SCORE FROM BATCH WHERE ID < ? ORDER BY ID DESC;"));
+    if (!reader.bind_row(static_cast<int64_t>(0)))
+    {
+        return false;
+    }
+
+    std::tuple<int64_t, std::string, double> tuple_row;
+    if (!reader.read_row(tuple_row) || -1 != std::get<0>(tuple_row) || "typed" != std::get<1>(tuple_row))
+    {
+        return false;
+    }
+    printf("    tuple: [" GOOFER_I64_FMT " %s %.1f]\n", std::get<0>(tuple_row), std::get<1>(tuple_row).c_str(), std::get<2>(tuple_row));
+
+    batch_row_t struct_row;
+    if (!reader.read_fields(struct_row) || fields_row.id != struct_row.id || fields_row.name != struct_row.name)
+    {
+        return false;
+    }
+    printf("    fields: [" GOOFER_I64_FMT " %s %.1f]\n", struct_row.id, struct_row.name.c_str(), struct_row.score);
+
+    return !reader.read_fields(struct_row);
+}
+
+static bool test_column_batch(SQLiteDB & db)
+{
+    printf("test column batch ...\n");
+
+    SQLiteReader reader(db.create_reader("SELECT ID, NAME, SCORE FROM BATCH ORDER BY ID;"));
+    if (!reader.good())
+    {
+        return false;
+    }
+
+    SQLiteColumnBatch batch;
+    uint64_t batches = 0;
+    uint64_t rows = 0;
+    uint64_t bytes = 0;
+    int64_t id_sum = 0;
+    double score_sum = 0.0;
+    while (reader.read_batch(4096, batch))
+    {
+        if (nullptr == batch.integers(0) || nullptr == batch.offsets(1) || nullptr == batch.doubles(2))
+        {
+            return false;
+        }
+        const int64_t * ids = batch.integers(0);
+        const size_t * offsets = batch.offsets(1);
+        const double * scores = batch.doubles(2);
+        for (size_t index = 0; index < batch.rows(); ++index)
+        {
+            id_sum += ids[index];
+            score_sum += scores[index];
+        }
+        bytes += offsets[batch.rows()];
+        rows += batch.rows();
+        ++batches;
+    }
+    printf("    " GOOFER_U64_FMT " batches, " GOOFER_U64_FMT " rows, " GOOFER_U64_FMT " bytes, " GOOFER_I64_FMT " id sum, %.1f score sum\n", batches, rows, bytes, id_sum, score_sum);
+
+    return 0 != rows;
+}
+
+static bool test_write_queue(const char * path)
+{
+    printf("test write queue ...\n");
+
+    SQLiteDB db;
+    if (!db.init(path, SQLiteOptions::fast_wal()))
+    {
+        return false;
+    }
+
+    if (!db.execute("CREATE TABLE IF NOT EXISTS QUEUE (ID BIGINT PRIMARY KEY NOT NULL, THREAD INT NOT NULL);") || !db.execute("DELETE FROM QUEUE;"))
+    {
+        return false;
+    }
+
+    SQLiteWriteQueue queue;
+    if (!queue.init(db, 256, 128, 2))
+    {
+        return false;
+    }
+
+    const size_t thread_count = 8;
+    const size_t task_count = 500;
+    std::atomic<uint64_t> succeeded(0);
+    std::vector<std::thread> producers;
+    for (size_t thread_index = 0; thread_index < thread_count; ++thread_index)
+    {
+        producers.emplace_back([&queue, &succeeded, thread_index, task_count]() {
+            std::vector<std::future<bool>> futures;
+            for (size_t task_index = 0; task_index < task_count; ++task_index)
+            {
+                const uint64_t id = thread_index * task_count + task_index;
+                futures.push_back(queue.submit([id, thread_index](SQLiteDB & db) -> bool {
+                    SQLiteWriter writer(db.create_writer("INSERT INTO QUEUE (ID, THREAD) VALUES (?, ?);"));
+                    return writer.bind_row(id, static_cast<uint32_t>(thread_index)) && writer.write();
+                }));
+            }
+            for (std::vector<std::future<bool>>::iterator iter = futures.begin(); futures.end() != iter; ++iter)
+            {
+                succeeded += iter->get() ? 1 : 0;
+            }
+        });
+    }
+
+    for (std::vector<std::thread>::iterator iter = producers.begin(); producers.end() != iter; ++iter)
+    {
+        iter->join();
+    }
+
+    queue.exit();
+
+    SQLiteWriteQueueStats stats;
+    queue.get_stats(stats);
+    printf("    " GOOFER_U64_FMT " succeeded, " GOOFER_U64_FMT " failed, " GOOFER_U64_FMT " transactions, %.1f average batch, " GOOFER_U64_FMT " max batch, " GOOFER_U64_FMT " us average latency, " GOOFER_U64_FMT " us max latency\n", stats.succeeded, stats.failed, stats.transactions, stats.average_batch, stats.max_batch, stats.average_latency_ns / 1000, stats.max_latency_ns / 1000);
+
+    SQLiteReader reader(db.create_reader("SELECT COUNT(*) FROM QUEUE;"));
+    uint64_t count = 0;
+    if (!reader.read() || !reader.get(count) || thread_count * task_count != count || count != succeeded)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static bool test_sqlite()
+{
+    SQLiteDB db;
+
+    const char * path = "./test.db";
+    const SQLiteOptions options = SQLiteOptions::profile("fast-wal");
+    if (!db.init(path, options))
+    {
+        printf("sqlite db init failure\n");
+        return false;
+    }
+
+    if (!db.is_open())
+    {
+        printf("sqlite db is not open\n");
+        return false;
+    }
+
+    if (!test_db_options(db, options))
+    {
+        printf("sqlite test db options failure\n");
+        return false;
+    }
+
+    if (!test_table_create(db))
+    {
+        printf("sqlite test table create failure\n");
+        return false;
+    }
+
+    if (!test_table_delete(db))
+    {
+        printf("sqlite test table delete failure\n");
+        return false;
+    }
+
+    if (!test_table_insert(db))
+    {
+        printf("sqlite test table insert failure\n");
+        return false;
+    }
+
+    if (!test_table_select(db))
+    {
+        printf("sqlite test table select failure\n");
+        return false;
+    }
+
+    if (!test_statement_cache(db))
+    {
+        printf("sqlite test statement cache failure\n");
+        return false;
+    }
+
+    if (!test_batch_insert(db))
+    {
+        printf("sqlite test batch insert failure\n");
+        return false;
+    }
+
+    if (!test_zero_copy_scan(db))
+    {
+        printf("sqlite test zero copy scan failure\n");
+        return false;
+    }
+
+    if (!test_parameter_binding(db))
+    {
+        printf("sqlite test parameter binding failure\n");
+        return false;
+    }
+
+    if (!test_blob_stream(db))
+    {
+        printf("sqlite test blob stream failure\n");
+        return false;
+    }
+
+    if (!test_backup(db))
+    {
+        printf("sqlite test backup failure\n");
+        return false;
+    }
+
+    if (!test_profile(db))
+    {
+        printf("sqlite test profile failure\n");
+        return false;
+    }
+
+    if (!test_functions(db))
+    {
+        printf("sqlite test functions failure\n");
+        return false;
+    }
+
+    if (!test_kv_table(db))
+    {
+        printf("sqlite test kv table failure\n");
+        return false;
+    }
+
+    if (!test_memory(db))
+    {
+        printf("sqlite test memory failure\n");
+        return false;
+    }
+
+    if (!test_typed_row(db))
+    {
+        printf("sqlite test typed row failure\n");
+        return false;
+    }
+
+    if (!test_column_batch(db))
+    {
+        printf("sqlite test column batch failure\n");
+        return false;
+    }
+
+    if (!test_upsert(db))
+    {
+        printf("sqlite test upsert failure\n");
+        return false;
+    }
+
+    if (!test_changes(db))
+    {
+        printf("sqlite test changes failure\n");
+        return false;
+    }
+
+    if (!test_changes_busy_commit("./test_changes.db"))
+    {
+        printf("sqlite test changes busy commit failure\n");
+        return false;
+    }
+
+    if (!test_pool(path))
+    {
+        printf("sqlite test pool failure\n");
+        return false;
+    }
+
+    // a "file:" URI name checks that the wal size is read from the real wal file
+    if (!test_checkpoint((std::string("file:") + path).c_str()))
+    {
+        printf("sqlite test checkpoint failure\n");
+        return false;
+    }
+
+    if (!test_write_queue(path))
+    {
+        printf("sqlite test write queue failure\n");
         return false;
     }
 